@@ -1,31 +1,123 @@
 #ifndef DM_CONTEXT_H
 #define DM_CONTEXT_H
 
+#include <stdatomic.h>
 #include "../dmkernel.h"
 
+// Reference-counted object header. Object types embed it as their first
+// member; destroy runs when the last value referring to the object is freed.
+// Iterable objects (generators, streaming readers) also set next, which
+// produces one item per call and sets *done once they are exhausted.
+struct dm_object {
+    size_t refcount;
+    void (*destroy)(dm_context_t *ctx, dm_object_t *object);
+    dm_error_t (*next)(dm_context_t *ctx, dm_object_t *object, dm_value_t *item, bool *done);
+};
+
 // Symbol table entry
 typedef struct dm_symbol {
-    char *name;
+    const char *name;           // Atom (see core/intern.h), shared, not owned
     dm_value_t value;
     struct dm_symbol *next;
 } dm_symbol_t;
 
 // Symbol table (scope)
 typedef struct dm_scope {
-    dm_symbol_t **symbols;
+    dm_symbol_t **symbols;      // Named symbols, allocated on first define
     size_t size;
-    struct dm_scope *parent;
+    dm_value_t *slots;          // Resolved locals, indexed by slot
+    size_t slot_count;
+    size_t slot_capacity;
+    struct dm_scope *parent;    // Enclosing scope (next free scope while pooled)
 } dm_scope_t;
 
+// Maximum number of released scopes kept for reuse
+#define DM_SCOPE_POOL_MAX 256
+
+// Default limit on nested user function calls
+#define DM_DEFAULT_MAX_CALL_DEPTH 1000
+
+// Active user function call, kept on the context's call stack
+typedef struct dm_call_frame {
+    const char *name;           // Function being run
+    dm_scope_t *scope;          // Its parameter scope
+    void *tail_function;        // Callee of a pending tail call, or NULL
+    dm_scope_t *tail_scope;     // Arguments bound for the pending tail call
+} dm_call_frame_t;
+
+// Code that function values point into, such as a parsed program or a
+// bytecode module. Every function value holds a reference; the code is
+// released with the last one (see dm_code_create).
+typedef struct dm_code {
+    dm_object_t object;
+    void *data;
+    void (*release)(dm_context_t *ctx, void *data);
+    bool dead;                  // Unreferenced, waiting for its run to end
+    struct dm_code *prev;
+    struct dm_code *next;
+} dm_code_t;
+
 // Execution context
 struct dm_context {
     // Memory management
     void *memory_impl;
+    struct dm_arena *arena;     // Scratch regions (see dm_arena_begin)
     
     // Current scope
     dm_scope_t *global_scope;
     dm_scope_t *current_scope;
     
+    // Released block/call scopes waiting for reuse
+    dm_scope_t *scope_pool;
+    size_t scope_pool_size;
+    
+    // User function calls being evaluated, innermost last
+    dm_call_frame_t *call_stack;
+    size_t call_depth;
+    size_t call_capacity;
+    size_t max_call_depth;      // Deeper calls fail with DM_ERROR_STACK_OVERFLOW
+    
+    // Bumped whenever a named binding may resolve differently (a symbol is
+    // added, a function symbol is replaced or a scope's symbols are freed).
+    // Call sites cache their callee for the epoch they looked it up in.
+    size_t definition_epoch;
+    
+    // Interned identifiers and string literals (see core/intern.h)
+    struct dm_intern_table *interns;
+    
+    // Calls to memo functions answered from / added to their result caches
+    size_t memo_hits;
+    size_t memo_misses;
+    
+    // Evaluation profile being recorded, or NULL (see lang/profile.h)
+    struct dm_profiler *profiler;
+    
+    // Cooperative preemption (see core/kernel.h). Loop back-edges and calls
+    // count down poll_countdown and take the slow path at zero, where the
+    // step budget, time limit and interrupt flag are checked.
+    uint64_t max_steps;         // Steps allowed per run, 0 for no limit
+    uint64_t steps_left;        // Steps not yet handed to poll_countdown
+    uint32_t poll_countdown;
+    unsigned time_limit_ms;     // Wall-clock limit per run, 0 for none
+    atomic_int interrupt;       // Error to stop the run with, or DM_SUCCESS
+    atomic_bool watchdog_due;   // Set by the timer when a health check is due
+    size_t run_depth;           // Nested dm_kernel_begin_run calls
+    struct dm_kernel_timer *timer;
+    
+    // Parallel loops (see lang/parallel.h). A worker context runs loop
+    // iterations on another thread for parent, sharing its globals and
+    // interned names; scopes from shared_scope outwards belong to the
+    // parent's thread and are read-only to the worker.
+    dm_context_t *parent;       // NULL except in workers
+    dm_scope_t *shared_scope;
+    size_t max_threads;         // Threads for parallel loops, 0 for one per CPU
+    struct dm_thread_pool *thread_pool;   // Started by the first parallel loop
+    
+    // Live code of the context, and the code of the program being run
+    // (owner of the functions it declares)
+    dm_code_t *code;
+    dm_object_t *program;
+    
     // Error handling
     dm_error_t last_error;
     char error_message[256];
@@ -39,6 +131,8 @@ struct dm_context {
     bool running;
     int exit_code;
     bool interactive;  // Whether we're in interactive mode
+    bool returning;    // Set while a return statement unwinds to its caller
+    bool threaded;     // Run source through the threaded bytecode VM instead of the AST walker
     
     // Command history
     char **history;
@@ -48,18 +142,53 @@ struct dm_context {
 
 // Context management functions
 dm_error_t dm_context_create(dm_context_t **ctx);
+// Context for a parallel loop worker of parent (destroyed with dm_context_destroy)
+dm_error_t dm_context_create_worker(dm_context_t *parent, dm_scope_t *shared_scope, dm_context_t **worker);
 void dm_context_destroy(dm_context_t *ctx);
 void dm_context_set_error(dm_context_t *ctx, const char *message);
 
 // Scope management
 dm_scope_t* dm_scope_create(dm_context_t *ctx, dm_scope_t *parent);
+dm_scope_t* dm_scope_create_with_slots(dm_context_t *ctx, dm_scope_t *parent, size_t slot_count);
+dm_value_t* dm_scope_slot(dm_scope_t *scope, size_t depth, size_t slot);
+dm_scope_t* dm_scope_acquire(dm_context_t *ctx, dm_scope_t *parent, size_t slot_count);
+void dm_scope_release(dm_context_t *ctx, dm_scope_t *scope);
 void dm_scope_destroy(dm_context_t *ctx, dm_scope_t *scope);
+// Symbol names are atoms from dm_intern and are matched by pointer
 dm_error_t dm_scope_define(dm_context_t *ctx, dm_scope_t *scope, const char *name, dm_value_t value);
 dm_error_t dm_scope_lookup(dm_context_t *ctx, dm_scope_t *scope, const char *name, dm_value_t *value);
+dm_error_t dm_scope_lookup_ref(dm_context_t *ctx, dm_scope_t *scope, const char *name, const dm_value_t **value);
+dm_value_t* dm_scope_lookup_mutable(dm_context_t *ctx, dm_scope_t *scope, const char *name);
+dm_error_t dm_scope_assign(dm_context_t *ctx, dm_scope_t *scope, const char *name, dm_value_t value);
+dm_scope_t* dm_scope_owner(dm_scope_t *scope, const char *name);   // Innermost scope defining name, or NULL
 
 // Value management
 void dm_value_init(dm_value_t *value);
 void dm_value_copy(dm_context_t *ctx, dm_value_t *dest, const dm_value_t *src);
 void dm_value_free(dm_context_t *ctx, dm_value_t *value);
 
+// Reference-counted payloads. Strings, arrays, matrices and objects are
+// shared by dm_value_copy and duplicated on write by dm_value_make_unique.
+dm_error_t dm_value_set_string(dm_context_t *ctx, dm_value_t *value, const char *data, size_t length);
+dm_error_t dm_value_set_array(dm_context_t *ctx, dm_value_t *value, size_t capacity);
+// Compact arrays hold 8-byte NaN-boxed items instead of full values
+dm_error_t dm_value_set_compact_array(dm_context_t *ctx, dm_value_t *value, size_t capacity);
+dm_error_t dm_value_set_matrix(dm_context_t *ctx, dm_value_t *value, size_t rows, size_t cols,
+                               dm_value_type_t elem_type);
+dm_error_t dm_value_set_object(dm_context_t *ctx, dm_value_t *value, dm_object_t *object);
+dm_error_t dm_value_make_unique(dm_context_t *ctx, dm_value_t *value);
+dm_error_t dm_value_array_push(dm_context_t *ctx, dm_value_t *array, const dm_value_t *item);
+dm_error_t dm_value_array_get(dm_context_t *ctx, const dm_value_t *array, size_t index, dm_value_t *item);
+dm_error_t dm_value_string_append(dm_context_t *ctx, dm_value_t *string, const char *data, size_t length);
+size_t dm_value_refcount(const dm_value_t *value);
+
+// Objects are destroyed with their last reference
+void dm_object_retain(dm_object_t *object);
+void dm_object_release(dm_context_t *ctx, dm_object_t *object);
+
+// Wrap code in a holder with one reference, owned by the caller. Released
+// code still running is only freed by dm_code_collect when the run ends.
+dm_object_t* dm_code_create(dm_context_t *ctx, void *data, void (*release)(dm_context_t *ctx, void *data));
+void dm_code_collect(dm_context_t *ctx);
+
 #endif /* DM_CONTEXT_H */ 
\ No newline at end of file
@@ -53,6 +53,7 @@ typedef struct dm_vfs_entry {
 
 // Virtual filesystem
 typedef struct dm_vfs {
+    dm_object_t object;    // Refcount header; the VFS lives in a scope value
     dm_vfs_entry_t *mounts;
     char *working_dir;     // Current working directory
     char path_separator;   // Path separator character ('/' or '\\')
@@ -0,0 +1,21 @@
+#ifndef DM_INTERN_H
+#define DM_INTERN_H
+
+#include "../dmkernel.h"
+
+// Interned strings ("atoms"). Each distinct text is stored once per context
+// with its hash computed up front, so two atoms are equal exactly when their
+// pointers are. Atoms are null-terminated and live until the context is
+// destroyed; they must never be passed to dm_free.
+const char* dm_intern(dm_context_t *ctx, const char *text, size_t length);
+const char* dm_intern_find(dm_context_t *ctx, const char *text);  // NULL if never interned
+void dm_intern_destroy(dm_context_t *ctx);
+
+// Properties of an atom returned by dm_intern
+size_t dm_atom_hash(const char *atom);
+size_t dm_atom_length(const char *atom);
+
+// String value holding the atom's text, shared by every use of the atom
+const dm_value_t* dm_atom_value(dm_context_t *ctx, const char *atom);
+
+#endif /* DM_INTERN_H */
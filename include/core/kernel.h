@@ -35,9 +35,47 @@ dm_health_status_t dm_check_system_health(dm_context_t *ctx);
 // Auto-detect critical system conditions and trigger panic if necessary
 void dm_kernel_watchdog(dm_context_t *ctx);
 
-// Register watchdog to run periodically
+// Register watchdog to run periodically. The kernel timer thread marks a
+// check as due; running scripts perform it at their next poll.
 void dm_register_watchdog(dm_context_t *ctx, int interval_ms);
 
+// Steps between polls of the interrupt flag when no step budget is set
+#define DM_POLL_INTERVAL 1024
+
+// Count one step (a loop iteration or a call) of a running script. Cheap
+// on the fast path; every DM_POLL_INTERVAL steps it polls the kernel and
+// yields DM_ERROR_TIMEOUT or DM_ERROR_INTERRUPTED when the run must stop.
+#define DM_KERNEL_STEP(ctx) \
+    (--(ctx)->poll_countdown == 0 ? dm_kernel_poll(ctx) : DM_SUCCESS)
+
+// Slow path of DM_KERNEL_STEP: check the interrupt flag and the step budget
+dm_error_t dm_kernel_poll(dm_context_t *ctx);
+
+// Stack kept free below the deepest script call for the work a call does
+// before it reaches the next check (builtins, printing, error reporting)
+#define DM_STACK_RESERVE (256 * 1024)
+
+// Whether the calling thread's C stack is within DM_STACK_RESERVE of its
+// end. Recursive evaluators check this per call and fail with
+// DM_ERROR_STACK_OVERFLOW instead of crashing.
+bool dm_kernel_stack_low(void);
+
+// Ask the running script to stop with reason at its next poll. Safe to
+// call from other threads and from signal handlers; the first reason wins.
+void dm_kernel_interrupt(dm_context_t *ctx, dm_error_t reason);
+
+// Bracket a script run. Only the outermost pair counts: it resets the step
+// budget and interrupt flag and arms the timer for ctx->time_limit_ms.
+dm_error_t dm_kernel_begin_run(dm_context_t *ctx);
+void dm_kernel_end_run(dm_context_t *ctx);
+
+// Turn SIGINT into an interrupt of the run in progress (a SIGINT with
+// nothing running keeps its default effect)
+void dm_kernel_catch_interrupts(dm_context_t *ctx);
+
+// Stop the timer thread, if any (called by dm_context_destroy)
+void dm_kernel_timer_stop(dm_context_t *ctx);
+
 // Simplified macro to call kernel panic
 #define DM_PANIC(ctx, fmt, ...) \
     dm_kernel_panic(ctx, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
@@ -29,7 +29,9 @@ typedef struct {
 dm_error_t dm_memory_init(dm_context_t *ctx);
 void dm_memory_cleanup(dm_context_t *ctx);
 
-// Memory allocation functions optimized for data mining workloads
+// Memory allocation functions optimized for data mining workloads. Blocks of
+// up to 4 KB come from thread-cached size-class slabs, larger ones from libc;
+// either way they must be released with dm_free, never free().
 void* dm_malloc(dm_context_t *ctx, size_t size);
 void* dm_calloc(dm_context_t *ctx, size_t nmemb, size_t size);
 void* dm_realloc(dm_context_t *ctx, void *ptr, size_t size);
@@ -49,16 +51,59 @@ void* dm_realloc_debug(dm_context_t *ctx, void *ptr, size_t size, const char *fi
 // Memory statistics
 dm_error_t dm_memory_get_stats(dm_context_t *ctx, dm_memory_stats_t *stats);
 
-// Memory pool for efficient allocation of many small objects
+// Memory pool for efficient allocation of many small objects. Freed objects
+// are reused before new ones are carved, and dm_pool_reset makes the objects
+// of every block available again. A concurrent pool may be allocated from
+// and freed to by several threads at once (lock-free except when it grows);
+// resetting or destroying it needs the other threads to be done with it.
 typedef struct dm_memory_pool dm_memory_pool_t;
 
 dm_memory_pool_t* dm_pool_create(dm_context_t *ctx, size_t block_size);
+dm_memory_pool_t* dm_pool_create_concurrent(dm_context_t *ctx, size_t block_size);
 void* dm_pool_alloc(dm_memory_pool_t *pool);
+void dm_pool_free(dm_memory_pool_t *pool, void *ptr);
 void dm_pool_reset(dm_memory_pool_t *pool);
 void dm_pool_destroy(dm_memory_pool_t *pool);
 
-// Matrix memory allocation (aligned for SIMD operations)
-void* dm_matrix_alloc(dm_context_t *ctx, size_t rows, size_t cols, size_t elem_size);
+// Scratch regions. dm_arena_begin marks the context's arena and
+// dm_arena_end rewinds it to the mark, releasing everything dm_arena_alloc
+// handed out in between at once. Regions nest; a block must not be used
+// after its region ends, so anything that escapes is copied out first.
+typedef struct {
+    struct dm_arena_chunk *chunk;
+    size_t offset;
+} dm_arena_mark_t;
+
+dm_arena_mark_t dm_arena_begin(dm_context_t *ctx);
+void* dm_arena_alloc(dm_context_t *ctx, size_t size);
+void dm_arena_end(dm_context_t *ctx, dm_arena_mark_t mark);
+void dm_arena_destroy(dm_context_t *ctx);
+
+// Reference-counted blocks. The count lives in a header in front of the
+// returned pointer; a new block starts with one reference.
+void* dm_rc_alloc(dm_context_t *ctx, size_t size);
+void* dm_rc_realloc(dm_context_t *ctx, void *ptr, size_t size);  // Only for unshared blocks
+void dm_rc_retain(void *ptr);
+size_t dm_rc_release(void *ptr);   // Returns the remaining reference count
+size_t dm_rc_count(const void *ptr);
+void dm_rc_free(dm_context_t *ctx, void *ptr);
+
+// Reference counts of blocks and objects. Between dm_rc_begin_shared and
+// dm_rc_end_shared (bracketing a parallel region) values can be shared by
+// several threads and counts are updated atomically; otherwise they are
+// plain increments.
+void dm_refcount_retain(size_t *count);
+size_t dm_refcount_release(size_t *count);   // Returns the remaining count
+void dm_rc_begin_shared(void);
+void dm_rc_end_shared(void);
+
+// Matrix memory allocation (aligned for SIMD operations). Every row starts
+// on a 64-byte boundary: rows are *stride bytes apart, cols * elem_size
+// rounded up to a multiple of 64. Matrices of 2 MB or more are mapped on
+// their own and advised to use transparent huge pages. The memory is zeroed.
+// Matrices are reference-counted (dm_rc_retain and dm_rc_count apply);
+// dm_matrix_free drops one reference.
+void* dm_matrix_alloc(dm_context_t *ctx, size_t rows, size_t cols, size_t elem_size, size_t *stride);
 void dm_matrix_free(dm_context_t *ctx, void *matrix);
 
 #endif /* DM_MEMORY_H */ 
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef DM_NANBOX_H
+#define DM_NANBOX_H
+
+#include <string.h>
+#include "../dmkernel.h"
+
+// NaN-boxed values: one 64-bit word per value. Numbers are stored as their
+// IEEE-754 bits (every NaN is canonicalized to a single quiet NaN), so the
+// negative quiet-NaN space is free to encode the other types:
+//
+//   1111 1111 1111 1ttt | 48-bit payload
+//
+// null and booleans carry no payload, integers that fit in 48 bits are
+// stored inline, and everything else (strings, arrays, matrices, objects,
+// functions and wide integers) lives in a reference-counted heap box holding
+// a full dm_value_t. Pointers must fit in 48 bits, as on x86-64 and AArch64.
+typedef uint64_t dm_boxed_t;
+
+#define DM_BOX_TAG_SHIFT   48
+#define DM_BOX_TAG_MIN     0xFFF9u     // Top 16 bits of the first tagged word
+#define DM_BOX_PAYLOAD     0x0000FFFFFFFFFFFFULL
+#define DM_BOX_CANONICAL_NAN 0x7FF8000000000000ULL
+
+// Tags (bits 48-50)
+#define DM_BOX_NULL     1
+#define DM_BOX_FALSE    2
+#define DM_BOX_TRUE     3
+#define DM_BOX_INTEGER  4   // Signed 48-bit integer
+#define DM_BOX_HEAP     5   // Pointer to a boxed dm_value_t
+
+#define DM_BOX_MAKE(tag, payload) \
+    (((dm_boxed_t)(0xFFF8u | (tag)) << DM_BOX_TAG_SHIFT) | ((dm_boxed_t)(payload) & DM_BOX_PAYLOAD))
+#define DM_BOX_TAG(boxed) ((unsigned)((boxed) >> DM_BOX_TAG_SHIFT) & 0x7u)
+
+// Hot-path helpers for numeric cells
+static inline bool dm_boxed_is_number(dm_boxed_t boxed) {
+    return (boxed >> DM_BOX_TAG_SHIFT) < DM_BOX_TAG_MIN;
+}
+
+static inline double dm_boxed_as_number(dm_boxed_t boxed) {
+    double number;
+    memcpy(&number, &boxed, sizeof(number));
+    return number;
+}
+
+static inline dm_boxed_t dm_box_number(double number) {
+    if (number != number) {
+        return DM_BOX_CANONICAL_NAN;
+    }
+    dm_boxed_t boxed;
+    memcpy(&boxed, &number, sizeof(boxed));
+    return boxed;
+}
+
+// Encode a value. Heap payloads are shared with value, as by dm_value_copy;
+// the result owns one reference and is released with dm_boxed_free.
+dm_error_t dm_box_value(dm_context_t *ctx, const dm_value_t *value, dm_boxed_t *boxed);
+
+// Decode into dest (freeing its previous contents), sharing heap payloads
+void dm_unbox_value(dm_context_t *ctx, dm_boxed_t boxed, dm_value_t *dest);
+
+dm_value_type_t dm_boxed_type(dm_boxed_t boxed);
+void dm_boxed_retain(dm_boxed_t boxed);     // Another owner for a heap box
+void dm_boxed_free(dm_context_t *ctx, dm_boxed_t boxed);
+
+#endif /* DM_NANBOX_H */
@@ -0,0 +1,27 @@
+#ifndef DM_THREADPOOL_H
+#define DM_THREADPOOL_H
+
+#include "../dmkernel.h"
+
+// Work-stealing thread pool. dm_thread_pool_for splits an index range into
+// one share per worker; a worker takes small batches from the front of its
+// own share and, once that runs out, steals the back half of another
+// worker's share. The calling thread works as worker 0.
+typedef struct dm_thread_pool dm_thread_pool_t;
+
+// Run the indices [begin, end) as worker; returning false stops all workers
+// at their next batch
+typedef bool (*dm_range_fn)(void *arg, size_t worker, size_t begin, size_t end);
+
+// Start a pool of threads workers (including the caller); 0 means one per CPU
+dm_error_t dm_thread_pool_create(dm_context_t *ctx, size_t threads, dm_thread_pool_t **pool);
+void dm_thread_pool_destroy(dm_context_t *ctx, dm_thread_pool_t *pool);
+
+// Number of workers, including the calling thread
+size_t dm_thread_pool_size(const dm_thread_pool_t *pool);
+
+// Run fn over [0, count) on all workers and wait for them to finish. Only
+// one range runs on a pool at a time.
+void dm_thread_pool_for(dm_thread_pool_t *pool, size_t count, dm_range_fn fn, void *arg);
+
+#endif /* DM_THREADPOOL_H */
@@ -65,22 +65,29 @@ struct dm_value {
         struct {
             char *data;
             size_t length;
+            size_t capacity;    // Bytes of data available before the terminator
         } string;
         struct {
-            dm_value_t *items;
+            union {
+                dm_value_t *items;
+                uint64_t *cells;    // Compact arrays: NaN-boxed items (see core/nanbox.h)
+            };
             size_t length;
             size_t capacity;
+            bool compact;
         } array;
         struct {
             void *data;
             size_t rows;
             size_t cols;
+            size_t stride;      // Bytes from one row to the next (a multiple of 64)
             dm_value_type_t elem_type;
         } matrix;
         dm_object_t *object;
         struct {
             dm_error_t (*func)(dm_context_t *ctx, int argc, dm_value_t *argv, dm_value_t *result);
             void *user_data;
+            dm_object_t *owner; // Keeps the code user_data points into alive, or NULL
         } function;
     } as;
 };
@@ -92,6 +99,8 @@ typedef dm_error_t (*dm_primitive_func_t)(dm_context_t *ctx, int argc, dm_value_
 #include "core/memory.h"
 #include "core/context.h"
 #include "core/utils.h"
+#include "core/intern.h"
+#include "core/nanbox.h"
 #include "core/kernel.h"
 #include "shell/shell.h"
 #include "lang/parser.h"
@@ -0,0 +1,202 @@
+#ifndef _DM_LANG_BYTECODE_H
+#define _DM_LANG_BYTECODE_H
+
+#include "../dmkernel.h"
+#include "parser.h"
+
+// Bytecode file magic and format version
+#define DM_BC_MAGIC "DMK\0"
+#define DM_BC_MAGIC_SIZE 4
+#define DM_BC_VERSION 7
+
+// Sentinel for "no constant" (e.g. the nameless top-level function)
+#define DM_BC_NO_NAME 0xFFFF
+
+// Instruction set of the stack VM.
+// Operands follow the opcode byte in little-endian order:
+//   u16 = constant, name, function index, scope depth or slot,
+//   u32 = absolute jump target
+typedef enum {
+    DM_BC_NOP,
+    DM_BC_CONST,          // u16 constant index
+    DM_BC_NULL,
+    DM_BC_TRUE,
+    DM_BC_FALSE,
+    DM_BC_POP,
+    DM_BC_PRINT,          // Pop and echo "=> value" (top-level expression statements)
+    DM_BC_GET,            // u16 name constant
+    DM_BC_SET,            // u16 name constant, assigns an existing variable
+    DM_BC_DEFINE,         // u16 name constant, declares in the current scope
+    DM_BC_GET_LOCAL,      // u16 depth, u16 slot
+    DM_BC_SET_LOCAL,      // u16 depth, u16 slot, stores without popping
+    DM_BC_CONCAT,         // u16 name constant, u8 part count; pops the variable's old value and the parts
+    DM_BC_CONCAT_LOCAL,   // u16 depth, u16 slot, u8 part count; as CONCAT for a resolved local
+    DM_BC_ADD,
+    DM_BC_SUB,
+    DM_BC_MUL,
+    DM_BC_DIV,
+    DM_BC_MOD,
+    DM_BC_EQ,
+    DM_BC_NEQ,
+    DM_BC_LT,
+    DM_BC_GT,
+    DM_BC_LTE,
+    DM_BC_GTE,
+    DM_BC_AND,
+    DM_BC_OR,
+    DM_BC_NEG,
+    DM_BC_NOT,
+    DM_BC_JUMP,           // u32 target
+    DM_BC_JUMP_IF_FALSE,  // u32 target, pops the condition
+    DM_BC_ENTER_SCOPE,    // u16 slot count
+    DM_BC_LEAVE_SCOPE,
+    DM_BC_FUNCTION,       // u16 function index, defines it and pushes its name
+    DM_BC_CALL,           // u16 name constant, u8 argument count
+    DM_BC_CALL_VALUE,     // u16 name constant (for messages), u8 argument count; callee below the arguments
+    DM_BC_RETURN,
+    DM_BC_HALT,           // Ends the run; a value left on the stack is its result
+    DM_BC_DUP,            // Push a copy of the top value
+    DM_BC_OPCODE_COUNT
+} dm_opcode_t;
+
+struct dm_bc_module;
+
+// A compiled function (index 0 of a module is the top-level script)
+typedef struct dm_bc_function {
+    uint16_t name;            // Name constant or DM_BC_NO_NAME
+    uint16_t *params;         // Parameter name constants (bound to slots 0..n-1)
+    size_t param_count;
+    bool named_params;        // Parameters are bound by name instead, as nested functions read them
+    uint8_t *code;
+    size_t code_length;
+    size_t code_capacity;
+    void *threaded;           // Pre-decoded dispatch data built by the VM, or NULL
+    struct dm_bc_module *module;  // Module the function belongs to
+} dm_bc_function_t;
+
+// A compiled module: shared constant pool plus its functions
+typedef struct dm_bc_module {
+    dm_value_t *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+    dm_bc_function_t **functions;
+    size_t function_count;
+    size_t function_capacity;
+    dm_object_t *owner;       // Holder while run (see dm_code_create), or NULL
+    const char **names;       // Atom of each string constant (NULL for others), set by the VM
+} dm_bc_module_t;
+
+/**
+ * @brief Creates an empty bytecode module
+ *
+ * @param ctx The DMKernel context
+ * @param module Pointer to store the new module
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_module_create(dm_context_t *ctx, dm_bc_module_t **module);
+
+/**
+ * @brief Frees a module, its constants and all of its functions
+ *
+ * @param ctx The DMKernel context
+ * @param module The module to free
+ */
+void dm_bc_module_free(dm_context_t *ctx, dm_bc_module_t *module);
+
+/**
+ * @brief Adds a constant to the pool, reusing an identical existing entry
+ *
+ * @param ctx The DMKernel context
+ * @param module The module
+ * @param value The constant (copied into the pool)
+ * @param index Pointer to store the constant index
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_add_constant(dm_context_t *ctx, dm_bc_module_t *module, const dm_value_t *value, uint16_t *index);
+
+/**
+ * @brief Adds a new empty function to the module
+ *
+ * @param ctx The DMKernel context
+ * @param module The module
+ * @param function Pointer to store the new function
+ * @param index Pointer to store the function index
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_add_function(dm_context_t *ctx, dm_bc_module_t *module, dm_bc_function_t **function, uint16_t *index);
+
+/**
+ * @brief Returns the size in bytes of an instruction including its operands
+ *
+ * @param opcode The opcode
+ * @return size_t Instruction size, or 0 for an invalid opcode
+ */
+size_t dm_bc_instruction_size(uint8_t opcode);
+
+/**
+ * @brief Checks whether a buffer starts with the bytecode file magic
+ *
+ * @param data The buffer
+ * @param length Length of the buffer
+ * @return bool True if the buffer holds bytecode
+ */
+bool dm_bc_is_bytecode(const void *data, size_t length);
+
+/**
+ * @brief Serializes a module into the .dmk file format
+ *
+ * @param ctx The DMKernel context
+ * @param module The module to serialize
+ * @param data Pointer to store the buffer (will be allocated)
+ * @param length Pointer to store the buffer length
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_serialize(dm_context_t *ctx, const dm_bc_module_t *module, uint8_t **data, size_t *length);
+
+/**
+ * @brief Loads and verifies a module from the .dmk file format
+ *
+ * @param ctx The DMKernel context
+ * @param data The serialized module
+ * @param length Length of the data
+ * @param module Pointer to store the loaded module
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_deserialize(dm_context_t *ctx, const uint8_t *data, size_t length, dm_bc_module_t **module);
+
+/**
+ * @brief Compiles an AST into a bytecode module
+ *
+ * @param ctx The DMKernel context
+ * @param root The program node to compile
+ * @param module Pointer to store the compiled module
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_bc_compile(dm_context_t *ctx, dm_node_t *root, dm_bc_module_t **module);
+
+/**
+ * @brief Runs the top-level function of a module on the stack VM
+ *
+ * The VM takes ownership of the module, even on failure. Functions the run
+ * defines refer to it, so it is freed once the run is over and none of
+ * them is referenced any more. Functions defined by earlier runs can be
+ * called like the module's own.
+ *
+ * @param ctx The DMKernel context
+ * @param module The module to run
+ * @param result Receives the value of the last statement (null on failure), or NULL
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_vm_execute(dm_context_t *ctx, dm_bc_module_t *module, dm_value_t *result);
+
+/**
+ * @brief Loads and runs a serialized module
+ *
+ * @param ctx The DMKernel context
+ * @param data The serialized module
+ * @param length Length of the data
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_execute_bytecode(dm_context_t *ctx, const uint8_t *data, size_t length);
+
+#endif /* _DM_LANG_BYTECODE_H */
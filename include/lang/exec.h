@@ -9,10 +9,10 @@
  * 
  * @param ctx The DMKernel context
  * @param node The AST node to evaluate
- * @param result Pointer to store the result (will be allocated)
+ * @param result Value slot to store the result (free with dm_value_free)
  * @return dm_error_t Error code
  */
-dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
+dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
 
 /**
  * @brief Executes code from a source string
@@ -20,10 +20,10 @@ dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
  * @param ctx The DMKernel context
  * @param source The source code to execute
  * @param source_len Length of the source code
- * @param result Pointer to store the result (will be allocated, can be NULL if not needed)
+ * @param result Value slot to store the result (free with dm_value_free, can be NULL if not needed)
  * @return dm_error_t Error code
  */
-dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_node_t **result);
+dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_value_t *result);
 
 /**
  * @brief Executes code from a file
@@ -44,4 +44,78 @@ dm_error_t dm_execute_file(dm_context_t *ctx, const char *filename);
  */
 dm_error_t dm_node_to_string(dm_context_t *ctx, dm_node_t *node, char **str);
 
+/**
+ * @brief Applies a binary operator to two values
+ * 
+ * @param ctx The DMKernel context
+ * @param op The operator
+ * @param left The left operand
+ * @param right The right operand
+ * @param result Pointer to store the result (must be freed with dm_value_free)
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_value_binary_op(dm_context_t *ctx, dm_operator_t op, const dm_value_t *left,
+                              const dm_value_t *right, dm_value_t *result);
+
+// Longest `x = x + a + b + ...` chain that is appended to x in place
+#define DM_CONCAT_MAX_PARTS 16
+
+/**
+ * @brief Matches an assignment of the form `x = x + a + b + ...`
+ * 
+ * @param node The assignment node
+ * @param parts Array of DM_CONCAT_MAX_PARTS nodes; receives the variable
+ *              reference followed by the added operands in order
+ * @return size_t Number of nodes stored (0 if the assignment does not match)
+ */
+size_t dm_concat_chain(dm_node_t *node, dm_node_t **parts);
+
+/**
+ * @brief Computes `base + parts[0] + ...` for an assignment to target
+ * 
+ * If target still holds base and every operand is a string, the parts are
+ * appended to target's buffer in place, which is amortized O(1) per byte.
+ * Otherwise the operands are added left to right and target is unchanged.
+ * The caller stores the result into target either way.
+ * 
+ * @param ctx The DMKernel context
+ * @param target The assigned variable's storage (may be NULL)
+ * @param base The variable's value read before the parts (ownership is taken)
+ * @param parts The added operands
+ * @param count Number of operands
+ * @param result Pointer to store the new value
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_value_concat(dm_context_t *ctx, dm_value_t *target, dm_value_t *base,
+                           const dm_value_t *parts, size_t count, dm_value_t *result);
+
+/**
+ * @brief Applies a unary operator to a value
+ * 
+ * @param ctx The DMKernel context
+ * @param op The operator
+ * @param operand The operand
+ * @param result Pointer to store the result
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_value_unary_op(dm_context_t *ctx, dm_operator_t op, const dm_value_t *operand, dm_value_t *result);
+
+/**
+ * @brief Checks whether a value counts as true in a condition
+ * 
+ * @param value The value to test
+ * @return bool Truthiness of the value
+ */
+bool dm_value_is_truthy(const dm_value_t *value);
+
+/**
+ * @brief Creates a string representation of a value
+ * 
+ * @param ctx The DMKernel context
+ * @param value The value to convert to string
+ * @param str Pointer to store the resulting string (will be allocated)
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_value_to_string(dm_context_t *ctx, const dm_value_t *value, char **str);
+
 #endif /* _DM_LANG_EXEC_H */ 
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef _DM_LANG_GENERATOR_H
+#define _DM_LANG_GENERATOR_H
+
+#include "../dmkernel.h"
+#include "parser.h"
+
+// Cursor of a `for (let x of ...)` loop. Arrays are walked by index and
+// strings byte by byte; objects are asked for their next item through
+// dm_object_t.next, so generators and streaming readers hand out one item
+// at a time instead of materializing the whole sequence.
+typedef struct {
+    dm_value_t source;      // The value being walked (a counted reference)
+    size_t index;           // Next array index or string byte
+} dm_iterator_t;
+
+/**
+ * @brief Starts iterating over a value
+ *
+ * @param ctx The DMKernel context
+ * @param iterator The cursor to initialize
+ * @param iterable Array, string or iterable object
+ * @return dm_error_t DM_ERROR_TYPE_MISMATCH if the value is not iterable
+ */
+dm_error_t dm_iterator_init(dm_context_t *ctx, dm_iterator_t *iterator, const dm_value_t *iterable);
+
+/**
+ * @brief Produces the next item
+ *
+ * @param ctx The DMKernel context
+ * @param iterator The cursor
+ * @param item Receives the item (null once done)
+ * @param done Set to true when there are no more items
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_iterator_next(dm_context_t *ctx, dm_iterator_t *iterator, dm_value_t *item, bool *done);
+
+/**
+ * @brief Releases the value an iterator walks
+ *
+ * @param ctx The DMKernel context
+ * @param iterator The cursor
+ */
+void dm_iterator_free(dm_context_t *ctx, dm_iterator_t *iterator);
+
+/**
+ * @brief Evaluates a `for (let x of iterable)` loop
+ *
+ * @param ctx The DMKernel context
+ * @param node The DM_NODE_FOR_EACH node
+ * @param result Receives the value of the last iteration
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_eval_for_each(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+
+/**
+ * @brief Creates the generator returned by a call of a generator function
+ *
+ * The body does not run yet. Each request for an item resumes it until the
+ * next `yield` statement; a `return` or the end of the body finishes it.
+ * The body's position is kept as a stack of statement frames rather than
+ * on the C stack, which is why `yield` is a statement and not an
+ * expression: a suspended generator never has a half-evaluated expression.
+ * Generator bodies see their parameters, their own locals and globals.
+ *
+ * @param ctx The DMKernel context
+ * @param function The generator function's node
+ * @param code The code function belongs to (a reference is taken), or NULL
+ * @param scope Its bound parameter scope (ownership is taken)
+ * @param result Receives the generator object
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_generator_create(dm_context_t *ctx, dm_node_t *function, dm_object_t *code, dm_scope_t *scope,
+                               dm_value_t *result);
+
+/**
+ * @brief Checks whether a value is a generator
+ *
+ * A generator can only be resumed by the context that created it.
+ *
+ * @param value The value to check
+ * @return bool True for generator objects
+ */
+bool dm_is_generator(const dm_value_t *value);
+
+#endif /* _DM_LANG_GENERATOR_H */
@@ -0,0 +1,65 @@
+#ifndef _DM_LANG_MEMO_H
+#define _DM_LANG_MEMO_H
+
+#include "../dmkernel.h"
+
+// Results kept per memo function before the least recently used is dropped
+#define DM_MEMO_CAPACITY 1024
+
+// Result cache of a `memo function`, keyed on its argument values
+typedef struct dm_memo dm_memo_t;
+
+/**
+ * @brief Creates an empty memo table
+ *
+ * @param ctx The DMKernel context
+ * @param arity Number of arguments in each key
+ * @param capacity Maximum number of cached results
+ * @param memo Pointer to store the new table
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_memo_create(dm_context_t *ctx, size_t arity, size_t capacity, dm_memo_t **memo);
+
+/**
+ * @brief Frees a memo table and every cached key and result
+ *
+ * @param ctx The DMKernel context
+ * @param memo The table to free (may be NULL)
+ */
+void dm_memo_free(dm_context_t *ctx, dm_memo_t *memo);
+
+/**
+ * @brief Checks whether argument values can be used as a key
+ *
+ * Null, boolean, number and string arguments are compared by value.
+ * Calls with any other argument type bypass the cache.
+ *
+ * @param args The argument values
+ * @param count Number of arguments
+ * @return bool True if the arguments can be cached
+ */
+bool dm_memo_cacheable(const dm_value_t *args, size_t count);
+
+/**
+ * @brief Looks up the result cached for an argument list
+ *
+ * A hit becomes the most recently used entry.
+ *
+ * @param memo The table to search
+ * @param args The argument values (as many as the table's arity)
+ * @return const dm_value_t* The cached result, or NULL on a miss
+ */
+const dm_value_t* dm_memo_lookup(dm_memo_t *memo, const dm_value_t *args);
+
+/**
+ * @brief Caches a result, evicting the least recently used entry when full
+ *
+ * @param ctx The DMKernel context
+ * @param memo The table to update
+ * @param args The argument values (copied into the table)
+ * @param result The result to cache (copied into the table)
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_memo_store(dm_context_t *ctx, dm_memo_t *memo, const dm_value_t *args, const dm_value_t *result);
+
+#endif /* _DM_LANG_MEMO_H */
@@ -0,0 +1,23 @@
+#ifndef _DM_LANG_OPTIMIZER_H
+#define _DM_LANG_OPTIMIZER_H
+
+#include "../dmkernel.h"
+#include "parser.h"
+
+/**
+ * @brief Simplifies a parsed program before it is resolved and run
+ *
+ * Unary and binary expressions whose operands are all literals are folded
+ * into a single literal, using the same operator semantics as evaluation.
+ * Expressions that would fail at runtime (e.g. division by zero) are left
+ * alone so the error still surfaces. `if` statements with a constant
+ * condition are replaced by the taken branch, and `while` loops whose
+ * condition is constantly false are removed.
+ *
+ * @param ctx The DMKernel context
+ * @param root The AST to rewrite in place
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_optimize(dm_context_t *ctx, dm_node_t *root);
+
+#endif /* _DM_LANG_OPTIMIZER_H */
@@ -0,0 +1,38 @@
+#ifndef _DM_LANG_PARALLEL_H
+#define _DM_LANG_PARALLEL_H
+
+#include "../dmkernel.h"
+#include "parser.h"
+
+// A `parallel for` counting loop, as worked out by the evaluator from the
+// loop's clauses
+typedef struct {
+    dm_node_t *body;            // Evaluated once per iteration
+    size_t slot_count;          // Locals of the loop scope
+    size_t counter_slot;        // Slot of the counter in the loop scope
+    int64_t start;              // Counter of the first iteration
+    int64_t step;
+    size_t count;               // Number of iterations
+    bool integer;               // The counter is an integer, not a whole float
+} dm_parallel_loop_t;
+
+/**
+ * @brief Runs the iterations of a parallel for loop
+ *
+ * Iterations are spread over the context's work-stealing thread pool (see
+ * core/threadpool.h). Each worker thread evaluates in a worker context of
+ * its own, with a private loop scope per iteration whose parent is the
+ * current scope: it reads the enclosing variables but may only assign its
+ * own. Reference counts are updated atomically while the loop runs; memo
+ * and call-site caches are not used by workers. A parallel loop inside
+ * another runs on the enclosing worker's thread.
+ *
+ * @param ctx The DMKernel context
+ * @param loop The loop
+ * @param result Receives the array of the iterations' values, in order
+ * @return dm_error_t Error code; on failure, that of the earliest failed
+ *         iteration that ran
+ */
+dm_error_t dm_parallel_for(dm_context_t *ctx, const dm_parallel_loop_t *loop, dm_value_t *result);
+
+#endif /* _DM_LANG_PARALLEL_H */
@@ -40,6 +40,8 @@ typedef struct {
     dm_lexer_t lexer;
     dm_token_t current;
     char error_message[256];
+    size_t function_depth;      // Function bodies being parsed
+    size_t yield_count;         // `yield` statements seen so far
 } dm_parser_t;
 
 // AST node types
@@ -57,12 +59,15 @@ typedef enum {
     DM_NODE_CALL,
     DM_NODE_FUNCTION,
     DM_NODE_RETURN,
-    DM_NODE_IMPORT
+    DM_NODE_IMPORT,
+    DM_NODE_YIELD,
+    DM_NODE_FOR_EACH
 } dm_node_type_t;
 
 // Literal types
 typedef enum {
-    DM_LITERAL_NUMBER,
+    DM_LITERAL_NUMBER,      // Floating-point number (has a '.' or does not fit in int64)
+    DM_LITERAL_INTEGER,
     DM_LITERAL_STRING,
     DM_LITERAL_BOOLEAN,
     DM_LITERAL_NULL
@@ -97,6 +102,14 @@ typedef enum {
 // Forward declaration for dm_node
 typedef struct dm_node dm_node_t;
 
+// Storage of a local resolved at compile time: `slot` in the scope `depth`
+// levels out from the current one. Unresolved names are looked up by name.
+typedef struct {
+    bool resolved;
+    size_t depth;
+    size_t slot;
+} dm_local_ref_t;
+
 // Node structures for different node types
 typedef struct {
     dm_node_t **statements;
@@ -108,7 +121,8 @@ typedef struct {
     dm_literal_type_t type;
     union {
         double number;
-        char *string;
+        int64_t integer;
+        const char *string;     // Atom (see core/intern.h)
         bool boolean;
     } value;
 } dm_literal_node_t;
@@ -125,19 +139,23 @@ typedef struct {
 } dm_unary_node_t;
 
 typedef struct {
-    char *name;
+    const char *name;       // Atom (see core/intern.h)
+    dm_local_ref_t local;
 } dm_variable_node_t;
 
 typedef struct {
-    char *name;
+    const char *name;       // Atom
     dm_node_t *value;
     bool is_declaration;
+    dm_local_ref_t local;
+    bool stores_string;     // Last value assigned was a string (tries appending in place)
 } dm_assignment_node_t;
 
 typedef struct {
     dm_node_t **statements;
     size_t count;
     size_t capacity;
+    size_t slot_count;      // Locals declared directly in this block
 } dm_block_node_t;
 
 typedef struct {
@@ -156,25 +174,48 @@ typedef struct {
     dm_node_t *condition;
     dm_node_t *increment;
     dm_node_t *body;
+    size_t slot_count;          // Resolved locals of the loop scope (the init's `let`)
+    bool parallel;              // `parallel for`: iterations run on worker threads
 } dm_for_node_t;
 
+// `for (let name of iterable) body` (see lang/generator.h)
 typedef struct {
-    char *name;
+    const char *name;           // Atom; the loop variable
+    dm_node_t *iterable;
+    dm_node_t *body;
+    dm_local_ref_t local;       // Slot of the loop variable in the loop scope
+    size_t slot_count;
+} dm_for_each_node_t;
+
+typedef struct {
+    const char *name;           // Atom
     dm_node_t **args;
     size_t arg_count;
+    dm_local_ref_t local;
+    dm_node_t *cached_function; // Inline cache: callee of the last named lookup
+    dm_object_t *cached_owner;  // and the code it belongs to (not referenced)
+    size_t cache_epoch;         // Definition epoch the cached callee is valid for
 } dm_call_node_t;
 
 typedef struct {
-    char *name;
-    char **params;
+    const char *name;       // Atom
+    const char **params;    // Atoms; only the array is owned by the node
     size_t param_count;
     dm_node_t *body;
+    bool resolved;          // Parameters are bound to slots instead of names
+    bool memoize;           // Declared `memo function`: results are cached per argument list
+    bool generator;         // Body contains `yield`: calls return a generator
+    struct dm_memo *memo;   // Result cache, created on the first call
 } dm_function_node_t;
 
 typedef struct {
     dm_node_t *value;
 } dm_return_node_t;
 
+typedef struct {
+    dm_node_t *value;       // NULL yields null
+} dm_yield_node_t;
+
 typedef struct {
     char *module;
 } dm_import_node_t;
@@ -196,10 +237,12 @@ struct dm_node {
         dm_if_node_t if_stmt;
         dm_while_node_t while_loop;
         dm_for_node_t for_loop;
+        dm_for_each_node_t for_each;
         dm_call_node_t call;
         dm_function_node_t function;
         dm_return_node_t return_stmt;
         dm_import_node_t import;
+        dm_yield_node_t yield_stmt;
     };
 };
 
@@ -213,8 +256,8 @@ dm_error_t dm_parser_parse(dm_parser_t *parser, dm_node_t **root);
 void dm_node_free(dm_context_t *ctx, dm_node_t *node);
 
 // Execution functions
-dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_node_t **result);
+dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_value_t *result);
 dm_error_t dm_node_to_string(dm_context_t *ctx, dm_node_t *node, char **str);
 
 // Helper function
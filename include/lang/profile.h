@@ -0,0 +1,86 @@
+#ifndef _DM_LANG_PROFILE_H
+#define _DM_LANG_PROFILE_H
+
+#include "../dmkernel.h"
+
+// Rows printed per section of a profile report by default
+#define DM_PROFILE_REPORT_ROWS 20
+
+// Evaluation profile of the tree-walking evaluator. While ctx->profiler is
+// set, every dm_eval_node call is counted and timed per node, per source
+// line and per user function, and self time is attributed to the stack of
+// user functions it ran under.
+typedef struct dm_profiler dm_profiler_t;
+
+/**
+ * @brief Starts profiling evaluation in a context
+ *
+ * Discards the data of any earlier profile.
+ *
+ * @param ctx The DMKernel context
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_profile_start(dm_context_t *ctx);
+
+/**
+ * @brief Stops profiling and frees the collected data
+ *
+ * @param ctx The DMKernel context
+ */
+void dm_profile_stop(dm_context_t *ctx);
+
+/**
+ * @brief Marks the start of a node evaluation
+ *
+ * @param profiler The active profiler
+ * @return uint64_t Start timestamp to pass to dm_profile_node_end
+ */
+uint64_t dm_profile_node_begin(dm_profiler_t *profiler);
+
+/**
+ * @brief Records a finished node evaluation
+ *
+ * @param profiler The active profiler
+ * @param node The node that was evaluated
+ * @param start Timestamp returned by the matching dm_profile_node_begin
+ */
+void dm_profile_node_end(dm_profiler_t *profiler, const dm_node_t *node, uint64_t start);
+
+/**
+ * @brief Records entry into a user function (a new or tail-reused frame)
+ *
+ * @param profiler The active profiler
+ * @param name The function's name (an atom)
+ */
+void dm_profile_call_begin(dm_profiler_t *profiler, const char *name);
+
+/**
+ * @brief Records return from the innermost user function
+ *
+ * @param profiler The active profiler
+ */
+void dm_profile_call_end(dm_profiler_t *profiler);
+
+/**
+ * @brief Prints the functions, lines and nodes with the most time
+ *
+ * @param ctx The DMKernel context
+ * @param out Stream to print to
+ * @param rows Maximum number of rows per section
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_profile_report(dm_context_t *ctx, FILE *out, size_t rows);
+
+/**
+ * @brief Writes self time per call stack in the collapsed stack format
+ *
+ * Each line is `script;caller;callee <microseconds>`, as read by
+ * flamegraph.pl and compatible tools.
+ *
+ * @param ctx The DMKernel context
+ * @param out Stream to write to
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_profile_write_collapsed(dm_context_t *ctx, FILE *out);
+
+#endif /* _DM_LANG_PROFILE_H */
@@ -0,0 +1,23 @@
+#ifndef _DM_LANG_RESOLVER_H
+#define _DM_LANG_RESOLVER_H
+
+#include "../dmkernel.h"
+#include "parser.h"
+
+/**
+ * @brief Resolves local variables of a parsed program to (depth, slot) pairs
+ *
+ * Locals declared with `let` inside blocks, and function parameters, are
+ * assigned slots in flat per-scope arrays. References that cannot be
+ * resolved within the enclosing function (globals, names introduced by
+ * function declarations) keep their name-based lookup. So do locals that
+ * functions declared in their scope read, as called functions see the
+ * caller's variables by name.
+ *
+ * @param ctx The DMKernel context
+ * @param root The AST to annotate in place
+ * @return dm_error_t Error code
+ */
+dm_error_t dm_resolve(dm_context_t *ctx, dm_node_t *root);
+
+#endif /* _DM_LANG_RESOLVER_H */
@@ -1,20 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h> // For isatty
 #include "../../include/core/context.h"
 #include "../../include/core/memory.h"
+#include "../../include/core/intern.h"
+#include "../../include/core/nanbox.h"
+#include "../../include/core/threadpool.h"
 
-// Hash function for symbol table
-static size_t hash_string(const char *str, size_t size) {
-    size_t hash = 5381;
-    int c;
-    
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
-    }
-    
-    return hash % size;
+// Symbol tables have a power-of-two size; atoms carry their hash
+static size_t symbol_bucket(const char *name, size_t size) {
+    return dm_atom_hash(name) & (size - 1);
 }
 
 // Create a new execution context
@@ -57,22 +54,88 @@ dm_error_t dm_context_create(dm_context_t **ctx) {
     // Set up running state
     (*ctx)->running = true;
     (*ctx)->exit_code = 0;
+    (*ctx)->max_call_depth = DM_DEFAULT_MAX_CALL_DEPTH;
+    (*ctx)->poll_countdown = 1;
+    atomic_init(&(*ctx)->interrupt, DM_SUCCESS);
+    atomic_init(&(*ctx)->watchdog_due, false);
     (*ctx)->interactive = isatty(fileno(stdin));  // Set interactive mode based on whether stdin is a TTY
     
     return DM_SUCCESS;
 }
 
+// Create a context that runs parallel loop iterations for parent. Nested
+// workers report to the outermost context, which owns the run.
+dm_error_t dm_context_create_worker(dm_context_t *parent, dm_scope_t *shared_scope, dm_context_t **worker) {
+    if (parent == NULL || shared_scope == NULL || worker == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_context_t *ctx = calloc(1, sizeof(dm_context_t));
+    if (ctx == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    dm_context_t *root = parent->parent != NULL ? parent->parent : parent;
+    
+    // Allocations are untracked; the memory tracker is not thread-safe
+    ctx->input = root->input;
+    ctx->output = root->output;
+    ctx->error = root->error;
+    ctx->global_scope = root->global_scope;
+    ctx->current_scope = shared_scope;
+    ctx->interns = root->interns;
+    ctx->max_call_depth = root->max_call_depth;
+    ctx->max_steps = root->max_steps;
+    ctx->time_limit_ms = root->time_limit_ms;
+    ctx->poll_countdown = 1;
+    atomic_init(&ctx->interrupt, DM_SUCCESS);
+    atomic_init(&ctx->watchdog_due, false);
+    ctx->running = true;
+    ctx->parent = root;
+    ctx->shared_scope = shared_scope;
+    ctx->program = root->program;
+    
+    *worker = ctx;
+    return DM_SUCCESS;
+}
+
 // Destroy an execution context
 void dm_context_destroy(dm_context_t *ctx) {
     if (ctx == NULL) {
         return;
     }
     
-    // Free scopes
-    if (ctx->global_scope != NULL) {
+    // Stop the timer thread before the context goes away under it
+    dm_kernel_timer_stop(ctx);
+    dm_thread_pool_destroy(ctx, ctx->thread_pool);
+    ctx->thread_pool = NULL;
+    
+    // Free scopes (a worker's global scope is its parent's)
+    if (ctx->global_scope != NULL && ctx->parent == NULL) {
         dm_scope_destroy(ctx, ctx->global_scope);
     }
     
+    // Free pooled scopes
+    while (ctx->scope_pool != NULL) {
+        dm_scope_t *next = ctx->scope_pool->parent;
+        dm_scope_destroy(ctx, ctx->scope_pool);
+        ctx->scope_pool = next;
+    }
+    ctx->scope_pool_size = 0;
+    
+    // Free the call stack
+    dm_free(ctx, ctx->call_stack);
+    ctx->call_stack = NULL;
+    ctx->call_depth = 0;
+    ctx->call_capacity = 0;
+    
+    dm_arena_destroy(ctx);
+    
+    if (ctx->parent != NULL) {
+        free(ctx);
+        return;
+    }
+    
     // Free command history
     if (ctx->history != NULL) {
         for (size_t i = 0; i < ctx->history_size; i++) {
@@ -81,6 +144,24 @@ void dm_context_destroy(dm_context_t *ctx) {
         free(ctx->history);
     }
     
+    // Code still alive is only referenced from cycles (such as a memo table
+    // holding a function of its own program). Pin all of it so releasing
+    // one piece cannot free another, then release the code, then the holders.
+    for (dm_code_t *code = ctx->code; code != NULL; code = code->next) {
+        code->object.refcount++;
+    }
+    for (dm_code_t *code = ctx->code; code != NULL; code = code->next) {
+        code->release(ctx, code->data);
+    }
+    while (ctx->code != NULL) {
+        dm_code_t *next = ctx->code->next;
+        dm_free(ctx, ctx->code);
+        ctx->code = next;
+    }
+    
+    // Free interned names once nothing can refer to them
+    dm_intern_destroy(ctx);
+    
     // Cleanup memory tracking last (after all other resources are freed)
     dm_memory_cleanup(ctx);
     
@@ -90,6 +171,11 @@ void dm_context_destroy(dm_context_t *ctx) {
 
 // Create a new scope
 dm_scope_t* dm_scope_create(dm_context_t *ctx, dm_scope_t *parent) {
+    return dm_scope_create_with_slots(ctx, parent, 0);
+}
+
+// Create a new scope with a fixed number of resolved local slots
+dm_scope_t* dm_scope_create_with_slots(dm_context_t *ctx, dm_scope_t *parent, size_t slot_count) {
     if (ctx == NULL) {
         return NULL;
     }
@@ -99,24 +185,81 @@ dm_scope_t* dm_scope_create(dm_context_t *ctx, dm_scope_t *parent) {
         return NULL;
     }
     
-    // Initialize symbol table with 64 buckets
-    const size_t table_size = 64;
-    scope->symbols = dm_calloc(ctx, table_size, sizeof(dm_symbol_t*));
-    if (scope->symbols == NULL) {
-        dm_free(ctx, scope);
+    // The symbol table is only allocated once a name is defined
+    scope->symbols = NULL;
+    scope->size = 0;
+    scope->slots = NULL;
+    scope->slot_count = slot_count;
+    scope->slot_capacity = slot_count;
+    scope->parent = parent;
+    
+    if (slot_count > 0) {
+        scope->slots = dm_malloc(ctx, slot_count * sizeof(dm_value_t));
+        if (scope->slots == NULL) {
+            dm_free(ctx, scope);
+            return NULL;
+        }
+        
+        for (size_t i = 0; i < slot_count; i++) {
+            dm_value_init(&scope->slots[i]);
+        }
+    }
+    
+    return scope;
+}
+
+// Get a resolved local slot `depth` scopes out from the given one
+dm_value_t* dm_scope_slot(dm_scope_t *scope, size_t depth, size_t slot) {
+    while (scope != NULL && depth > 0) {
+        scope = scope->parent;
+        depth--;
+    }
+    
+    if (scope == NULL || slot >= scope->slot_count) {
         return NULL;
     }
     
-    scope->size = table_size;
+    return &scope->slots[slot];
+}
+
+// Take a scope from the context's pool (or allocate one if it is empty)
+dm_scope_t* dm_scope_acquire(dm_context_t *ctx, dm_scope_t *parent, size_t slot_count) {
+    if (ctx == NULL) {
+        return NULL;
+    }
+    
+    dm_scope_t *scope = ctx->scope_pool;
+    if (scope == NULL) {
+        return dm_scope_create_with_slots(ctx, parent, slot_count);
+    }
+    
+    // Grow the slot array if this scope needs more than it had before
+    if (slot_count > scope->slot_capacity) {
+        dm_value_t *slots = dm_realloc(ctx, scope->slots, slot_count * sizeof(dm_value_t));
+        if (slots == NULL) {
+            return NULL;
+        }
+        scope->slots = slots;
+        scope->slot_capacity = slot_count;
+    }
+    
+    ctx->scope_pool = scope->parent;
+    ctx->scope_pool_size--;
+    
+    for (size_t i = 0; i < slot_count; i++) {
+        dm_value_init(&scope->slots[i]);
+    }
+    scope->slot_count = slot_count;
     scope->parent = parent;
     
     return scope;
 }
 
-// Destroy a scope
-void dm_scope_destroy(dm_context_t *ctx, dm_scope_t *scope) {
-    if (ctx == NULL || scope == NULL) {
-        return;
+// Free the contents of a scope, keeping the slot array
+static void scope_clear(dm_context_t *ctx, dm_scope_t *scope) {
+    // Names defined here stop resolving
+    if (scope->symbols != NULL) {
+        ctx->definition_epoch++;
     }
     
     // Free all symbols in the table
@@ -125,9 +268,6 @@ void dm_scope_destroy(dm_context_t *ctx, dm_scope_t *scope) {
         while (symbol != NULL) {
             dm_symbol_t *next = symbol->next;
             
-            // Free symbol name
-            dm_free(ctx, symbol->name);
-            
             // Free symbol value
             dm_value_free(ctx, &symbol->value);
             
@@ -140,6 +280,44 @@ void dm_scope_destroy(dm_context_t *ctx, dm_scope_t *scope) {
     
     // Free symbol table
     dm_free(ctx, scope->symbols);
+    scope->symbols = NULL;
+    scope->size = 0;
+    
+    // Free resolved locals
+    for (size_t i = 0; i < scope->slot_count; i++) {
+        dm_value_free(ctx, &scope->slots[i]);
+    }
+    scope->slot_count = 0;
+}
+
+// Return a scope to the context's pool
+void dm_scope_release(dm_context_t *ctx, dm_scope_t *scope) {
+    if (ctx == NULL || scope == NULL) {
+        return;
+    }
+    
+    if (ctx->scope_pool_size >= DM_SCOPE_POOL_MAX) {
+        dm_scope_destroy(ctx, scope);
+        return;
+    }
+    
+    scope_clear(ctx, scope);
+    
+    scope->parent = ctx->scope_pool;
+    ctx->scope_pool = scope;
+    ctx->scope_pool_size++;
+}
+
+// Destroy a scope
+void dm_scope_destroy(dm_context_t *ctx, dm_scope_t *scope) {
+    if (ctx == NULL || scope == NULL) {
+        return;
+    }
+    
+    scope_clear(ctx, scope);
+    
+    // Free slot array
+    dm_free(ctx, scope->slots);
     
     // Free scope struct
     dm_free(ctx, scope);
@@ -151,15 +329,27 @@ dm_error_t dm_scope_define(dm_context_t *ctx, dm_scope_t *scope, const char *nam
         return DM_ERROR_INVALID_ARGUMENT;
     }
     
+    // Allocate the symbol table with 64 buckets on first use
+    if (scope->symbols == NULL) {
+        const size_t table_size = 64;
+        scope->symbols = dm_calloc(ctx, table_size, sizeof(dm_symbol_t*));
+        if (scope->symbols == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        scope->size = table_size;
+    }
+    
     // Calculate hash bucket
-    size_t hash = hash_string(name, scope->size);
+    size_t hash = symbol_bucket(name, scope->size);
     
     // Check if symbol already exists
     dm_symbol_t *symbol = scope->symbols[hash];
     while (symbol != NULL) {
-        if (strcmp(symbol->name, name) == 0) {
-            // Symbol exists, free old value and update
-            dm_value_free(ctx, &symbol->value);
+        if (symbol->name == name) {
+            // Symbol exists, replace its value
+            if (symbol->value.type == DM_TYPE_FUNCTION) {
+                ctx->definition_epoch++;
+            }
             dm_value_copy(ctx, &symbol->value, &value);
             return DM_SUCCESS;
         }
@@ -172,27 +362,40 @@ dm_error_t dm_scope_define(dm_context_t *ctx, dm_scope_t *scope, const char *nam
         return DM_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Copy name
-    symbol->name = dm_malloc(ctx, strlen(name) + 1);
-    if (symbol->name == NULL) {
-        dm_free(ctx, symbol);
-        return DM_ERROR_MEMORY_ALLOCATION;
-    }
-    strcpy(symbol->name, name);
+    // Atoms outlive every scope, so the name is shared rather than copied
+    symbol->name = name;
     
     // Copy value
     dm_value_init(&symbol->value);
     dm_value_copy(ctx, &symbol->value, &value);
     
-    // Insert at head of bucket
+    // Insert at head of bucket; the new name may shadow an outer one
     symbol->next = scope->symbols[hash];
     scope->symbols[hash] = symbol;
+    ctx->definition_epoch++;
     
     return DM_SUCCESS;
 }
 
-// Look up a symbol in a scope and its parents
+// Look up a symbol in a scope and its parents, copying its value
 dm_error_t dm_scope_lookup(dm_context_t *ctx, dm_scope_t *scope, const char *name, dm_value_t *value) {
+    if (value == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    const dm_value_t *stored = NULL;
+    dm_error_t err = dm_scope_lookup_ref(ctx, scope, name, &stored);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    dm_value_copy(ctx, value, stored);
+    return DM_SUCCESS;
+}
+
+// Look up a symbol and borrow its stored value. The pointer stays valid
+// until the symbol is redefined or its scope is released.
+dm_error_t dm_scope_lookup_ref(dm_context_t *ctx, dm_scope_t *scope, const char *name, const dm_value_t **value) {
     if (ctx == NULL || scope == NULL || name == NULL || value == NULL) {
         return DM_ERROR_INVALID_ARGUMENT;
     }
@@ -201,15 +404,21 @@ dm_error_t dm_scope_lookup(dm_context_t *ctx, dm_scope_t *scope, const char *nam
     dm_scope_t *current = scope;
     
     while (current != NULL) {
+        // Scopes holding only resolved locals have no named symbols
+        if (current->symbols == NULL) {
+            current = current->parent;
+            continue;
+        }
+        
         // Calculate hash bucket
-        size_t hash = hash_string(name, current->size);
+        size_t hash = symbol_bucket(name, current->size);
         
         // Search in this scope
         dm_symbol_t *symbol = current->symbols[hash];
         while (symbol != NULL) {
-            if (strcmp(symbol->name, name) == 0) {
-                // Found symbol, copy value
-                dm_value_copy(ctx, value, &symbol->value);
+            if (symbol->name == name) {
+                // Found symbol
+                *value = &symbol->value;
                 return DM_SUCCESS;
             }
             symbol = symbol->next;
@@ -223,6 +432,77 @@ dm_error_t dm_scope_lookup(dm_context_t *ctx, dm_scope_t *scope, const char *nam
     return DM_ERROR_INVALID_ARGUMENT;
 }
 
+// Find the innermost scope in the chain that defines a named symbol
+dm_scope_t* dm_scope_owner(dm_scope_t *scope, const char *name) {
+    for (dm_scope_t *current = scope; current != NULL; current = current->parent) {
+        if (current->symbols == NULL) {
+            continue;
+        }
+        
+        for (dm_symbol_t *symbol = current->symbols[symbol_bucket(name, current->size)];
+             symbol != NULL; symbol = symbol->next) {
+            if (symbol->name == name) {
+                return current;
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+// Look up a symbol's stored value for updating it in place (NULL if undefined)
+dm_value_t* dm_scope_lookup_mutable(dm_context_t *ctx, dm_scope_t *scope, const char *name) {
+    const dm_value_t *value = NULL;
+    if (dm_scope_lookup_ref(ctx, scope, name, &value) != DM_SUCCESS) {
+        return NULL;
+    }
+    
+    // Symbols are owned by their scope; only the borrow API is read-only
+    return (dm_value_t*)value;
+}
+
+// Update an existing symbol in the innermost scope that defines it
+dm_error_t dm_scope_assign(dm_context_t *ctx, dm_scope_t *scope, const char *name, dm_value_t value) {
+    if (ctx == NULL || scope == NULL || name == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // Start at current scope
+    dm_scope_t *current = scope;
+    
+    while (current != NULL) {
+        // Scopes holding only resolved locals have no named symbols
+        if (current->symbols == NULL) {
+            current = current->parent;
+            continue;
+        }
+        
+        // Calculate hash bucket
+        size_t hash = symbol_bucket(name, current->size);
+        
+        // Search in this scope
+        dm_symbol_t *symbol = current->symbols[hash];
+        while (symbol != NULL) {
+            if (symbol->name == name) {
+                // Found symbol, replace its value
+                if (symbol->value.type == DM_TYPE_FUNCTION) {
+                    ctx->definition_epoch++;
+                }
+                dm_value_free(ctx, &symbol->value);
+                dm_value_copy(ctx, &symbol->value, &value);
+                return DM_SUCCESS;
+            }
+            symbol = symbol->next;
+        }
+        
+        // Not found in this scope, check parent
+        current = current->parent;
+    }
+    
+    // Symbol not found
+    return DM_ERROR_NOT_FOUND;
+}
+
 // Initialize a value to null
 void dm_value_init(dm_value_t *value) {
     if (value == NULL) {
@@ -233,77 +513,59 @@ void dm_value_init(dm_value_t *value) {
     memset(&value->as, 0, sizeof(value->as));
 }
 
-// Copy a value
+// Size of one matrix element of the given type
+static size_t matrix_elem_size(dm_value_type_t elem_type) {
+    switch (elem_type) {
+        case DM_TYPE_BOOLEAN:
+            return sizeof(bool);
+        case DM_TYPE_INTEGER:
+            return sizeof(int64_t);
+        case DM_TYPE_FLOAT:
+            return sizeof(double);
+        default:
+            return 0;
+    }
+}
+
+// Copy a value. Heap payloads are shared, not duplicated.
 void dm_value_copy(dm_context_t *ctx, dm_value_t *dest, const dm_value_t *src) {
-    if (ctx == NULL || dest == NULL || src == NULL) {
+    if (ctx == NULL || dest == NULL || src == NULL || dest == src) {
         return;
     }
     
-    // Free any existing value in dest
-    dm_value_free(ctx, dest);
-    
-    // Copy type
-    dest->type = src->type;
-    
-    // Copy contents based on type
+    // Take the new reference before dropping dest, which may share it
     switch (src->type) {
-        case DM_TYPE_NULL:
-            // Nothing to copy
-            break;
-            
-        case DM_TYPE_BOOLEAN:
-            dest->as.boolean = src->as.boolean;
-            break;
-            
-        case DM_TYPE_INTEGER:
-            dest->as.integer = src->as.integer;
-            break;
-            
-        case DM_TYPE_FLOAT:
-            dest->as.floating = src->as.floating;
-            break;
-            
         case DM_TYPE_STRING:
-            // Copy string
-            dest->as.string.length = src->as.string.length;
-            dest->as.string.data = dm_malloc(ctx, src->as.string.length + 1);
-            if (dest->as.string.data != NULL) {
-                memcpy(dest->as.string.data, src->as.string.data, src->as.string.length + 1);
-            }
+            dm_rc_retain(src->as.string.data);
             break;
             
         case DM_TYPE_ARRAY:
-            // Copy array
-            dest->as.array.length = src->as.array.length;
-            dest->as.array.capacity = src->as.array.length;
-            
-            if (src->as.array.length > 0) {
-                dest->as.array.items = dm_malloc(ctx, sizeof(dm_value_t) * src->as.array.length);
-                if (dest->as.array.items != NULL) {
-                    for (size_t i = 0; i < src->as.array.length; i++) {
-                        dm_value_init(&dest->as.array.items[i]);
-                        dm_value_copy(ctx, &dest->as.array.items[i], &src->as.array.items[i]);
-                    }
-                }
-            } else {
-                dest->as.array.items = NULL;
-            }
+            dm_rc_retain(src->as.array.items);
             break;
             
         case DM_TYPE_MATRIX:
-            // Copy matrix (shallow copy for now)
-            dest->as.matrix = src->as.matrix;
+            dm_rc_retain(src->as.matrix.data);
             break;
             
         case DM_TYPE_OBJECT:
+            dm_object_retain(src->as.object);
+            break;
+            
         case DM_TYPE_FUNCTION:
-            // Simple copy for now
-            dest->as = src->as;
+            dm_object_retain(src->as.function.owner);
+            break;
+            
+        default:
             break;
     }
+    
+    // Free any existing value in dest
+    dm_value_free(ctx, dest);
+    
+    *dest = *src;
 }
 
-// Free a value's resources
+// Free a value's resources (drops its reference to a shared payload)
 void dm_value_free(dm_context_t *ctx, dm_value_t *value) {
     if (ctx == NULL || value == NULL) {
         return;
@@ -319,45 +581,417 @@ void dm_value_free(dm_context_t *ctx, dm_value_t *value) {
             break;
             
         case DM_TYPE_STRING:
-            // Free string data
-            if (value->as.string.data != NULL) {
-                dm_free(ctx, value->as.string.data);
-                value->as.string.data = NULL;
+            // Free string data with its last reference
+            if (value->as.string.data != NULL && dm_rc_release(value->as.string.data) == 0) {
+                dm_rc_free(ctx, value->as.string.data);
             }
             break;
             
         case DM_TYPE_ARRAY:
-            // Free array items
-            if (value->as.array.items != NULL) {
+            // Free array items with the last reference
+            if (value->as.array.items != NULL && dm_rc_release(value->as.array.items) == 0) {
                 for (size_t i = 0; i < value->as.array.length; i++) {
-                    dm_value_free(ctx, &value->as.array.items[i]);
+                    if (value->as.array.compact) {
+                        dm_boxed_free(ctx, value->as.array.cells[i]);
+                    } else {
+                        dm_value_free(ctx, &value->as.array.items[i]);
+                    }
                 }
-                dm_free(ctx, value->as.array.items);
-                value->as.array.items = NULL;
+                dm_rc_free(ctx, value->as.array.items);
             }
-            value->as.array.length = 0;
-            value->as.array.capacity = 0;
             break;
             
         case DM_TYPE_MATRIX:
-            // Free matrix data
-            if (value->as.matrix.data != NULL) {
-                dm_matrix_free(ctx, value->as.matrix.data);
-                value->as.matrix.data = NULL;
-            }
+            // Matrices are refcounted by the allocator
+            dm_matrix_free(ctx, value->as.matrix.data);
             break;
             
         case DM_TYPE_OBJECT:
-            // TODO: Implement object freeing
+            dm_object_release(ctx, value->as.object);
             break;
             
         case DM_TYPE_FUNCTION:
-            // Nothing to free for primitive functions
+            // Primitive functions have no owner
+            dm_object_release(ctx, value->as.function.owner);
             break;
     }
     
     // Reset to NULL type
-    value->type = DM_TYPE_NULL;
+    dm_value_init(value);
+}
+
+// Make value a string holding a copy of data
+dm_error_t dm_value_set_string(dm_context_t *ctx, dm_value_t *value, const char *data, size_t length) {
+    if (ctx == NULL || value == NULL || (data == NULL && length > 0)) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    char *buffer = dm_rc_alloc(ctx, length + 1);
+    if (buffer == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    if (length > 0) {
+        memcpy(buffer, data, length);
+    }
+    buffer[length] = '\0';
+    
+    dm_value_free(ctx, value);
+    value->type = DM_TYPE_STRING;
+    value->as.string.data = buffer;
+    value->as.string.length = length;
+    value->as.string.capacity = length;
+    return DM_SUCCESS;
+}
+
+// Bytes per item of an array
+static size_t array_item_size(const dm_value_t *array) {
+    return array->as.array.compact ? sizeof(dm_boxed_t) : sizeof(dm_value_t);
+}
+
+static dm_error_t set_array(dm_context_t *ctx, dm_value_t *value, size_t capacity, bool compact) {
+    size_t item_size = compact ? sizeof(dm_boxed_t) : sizeof(dm_value_t);
+    if (ctx == NULL || value == NULL || capacity > SIZE_MAX / item_size) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    void *items = dm_rc_alloc(ctx, (capacity > 0 ? capacity : 1) * item_size);
+    if (items == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    dm_value_free(ctx, value);
+    value->type = DM_TYPE_ARRAY;
+    value->as.array.items = items;
+    value->as.array.length = 0;
+    value->as.array.capacity = capacity > 0 ? capacity : 1;
+    value->as.array.compact = compact;
+    return DM_SUCCESS;
+}
+
+// Make value an empty array with room for capacity items
+dm_error_t dm_value_set_array(dm_context_t *ctx, dm_value_t *value, size_t capacity) {
+    return set_array(ctx, value, capacity, false);
+}
+
+// Make value an empty compact array. Items take 8 bytes instead of a full
+// dm_value_t; numbers, booleans, null and 48-bit integers are stored inline
+// and other values in shared heap boxes.
+dm_error_t dm_value_set_compact_array(dm_context_t *ctx, dm_value_t *value, size_t capacity) {
+    return set_array(ctx, value, capacity, true);
+}
+
+// Make value a zero-filled rows x cols matrix
+dm_error_t dm_value_set_matrix(dm_context_t *ctx, dm_value_t *value, size_t rows, size_t cols,
+                               dm_value_type_t elem_type) {
+    size_t elem_size = matrix_elem_size(elem_type);
+    if (ctx == NULL || value == NULL || elem_size == 0) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // Rows are padded to aligned boundaries; the memory comes zeroed
+    size_t stride = 0;
+    void *data = dm_matrix_alloc(ctx, rows, cols, elem_size, &stride);
+    if (data == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    dm_value_free(ctx, value);
+    value->type = DM_TYPE_MATRIX;
+    value->as.matrix.data = data;
+    value->as.matrix.rows = rows;
+    value->as.matrix.cols = cols;
+    value->as.matrix.stride = stride;
+    value->as.matrix.elem_type = elem_type;
+    return DM_SUCCESS;
+}
+
+// Make value refer to object, taking over the caller's reference
+dm_error_t dm_value_set_object(dm_context_t *ctx, dm_value_t *value, dm_object_t *object) {
+    if (ctx == NULL || value == NULL || object == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_value_free(ctx, value);
+    value->type = DM_TYPE_OBJECT;
+    value->as.object = object;
+    return DM_SUCCESS;
+}
+
+// Give value its own copy of a shared payload before it is modified.
+// Objects are shared by identity and never duplicated.
+dm_error_t dm_value_make_unique(dm_context_t *ctx, dm_value_t *value) {
+    if (ctx == NULL || value == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (dm_value_refcount(value) <= 1 || value->type == DM_TYPE_OBJECT) {
+        return DM_SUCCESS;
+    }
+    
+    dm_value_t copy;
+    dm_value_init(&copy);
+    dm_error_t err = DM_SUCCESS;
+    
+    switch (value->type) {
+        case DM_TYPE_STRING:
+            err = dm_value_set_string(ctx, &copy, value->as.string.data, value->as.string.length);
+            break;
+            
+        case DM_TYPE_ARRAY:
+            // Items are copied shallowly; they share their own payloads
+            err = set_array(ctx, &copy, value->as.array.capacity, value->as.array.compact);
+            if (err == DM_SUCCESS) {
+                for (size_t i = 0; i < value->as.array.length; i++) {
+                    if (value->as.array.compact) {
+                        dm_boxed_retain(value->as.array.cells[i]);
+                        copy.as.array.cells[i] = value->as.array.cells[i];
+                    } else {
+                        dm_value_init(&copy.as.array.items[i]);
+                        dm_value_copy(ctx, &copy.as.array.items[i], &value->as.array.items[i]);
+                    }
+                }
+                copy.as.array.length = value->as.array.length;
+            }
+            break;
+            
+        case DM_TYPE_MATRIX:
+            err = dm_value_set_matrix(ctx, &copy, value->as.matrix.rows, value->as.matrix.cols,
+                                      value->as.matrix.elem_type);
+            if (err == DM_SUCCESS) {
+                memcpy(copy.as.matrix.data, value->as.matrix.data,
+                       value->as.matrix.rows * value->as.matrix.stride);
+            }
+            break;
+            
+        default:
+            break;
+    }
+    
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Drop the shared reference and keep the private copy
+    dm_value_free(ctx, value);
+    *value = copy;
+    return DM_SUCCESS;
+}
+
+// Append a copy of item to an array, growing it if needed
+dm_error_t dm_value_array_push(dm_context_t *ctx, dm_value_t *array, const dm_value_t *item) {
+    if (ctx == NULL || array == NULL || item == NULL || array->type != DM_TYPE_ARRAY) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_error_t err = dm_value_make_unique(ctx, array);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    size_t item_size = array_item_size(array);
+    if (array->as.array.length >= array->as.array.capacity) {
+        size_t new_capacity = array->as.array.capacity * 2;
+        if (new_capacity > SIZE_MAX / item_size) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        void *items = dm_rc_realloc(ctx, array->as.array.items, new_capacity * item_size);
+        if (items == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        array->as.array.items = items;
+        array->as.array.capacity = new_capacity;
+    }
+    
+    if (array->as.array.compact) {
+        err = dm_box_value(ctx, item, &array->as.array.cells[array->as.array.length]);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+        array->as.array.length++;
+        return DM_SUCCESS;
+    }
+    
+    dm_value_t *slot = &array->as.array.items[array->as.array.length++];
+    dm_value_init(slot);
+    dm_value_copy(ctx, slot, item);
+    return DM_SUCCESS;
+}
+
+// Copy the item at index out of an array of either layout
+dm_error_t dm_value_array_get(dm_context_t *ctx, const dm_value_t *array, size_t index, dm_value_t *item) {
+    if (ctx == NULL || array == NULL || item == NULL || array->type != DM_TYPE_ARRAY) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (index >= array->as.array.length) {
+        return DM_ERROR_INDEX_OUT_OF_BOUNDS;
+    }
+    
+    if (array->as.array.compact) {
+        dm_unbox_value(ctx, array->as.array.cells[index], item);
+    } else {
+        dm_value_copy(ctx, item, &array->as.array.items[index]);
+    }
+    return DM_SUCCESS;
+}
+
+// Append bytes to a string. The buffer grows geometrically, so building a
+// string by repeated appends costs amortized O(1) per byte.
+dm_error_t dm_value_string_append(dm_context_t *ctx, dm_value_t *string, const char *data, size_t length) {
+    if (ctx == NULL || string == NULL || string->type != DM_TYPE_STRING || (data == NULL && length > 0)) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (length == 0) {
+        return DM_SUCCESS;
+    }
+    
+    dm_error_t err = dm_value_make_unique(ctx, string);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    size_t old_length = string->as.string.length;
+    if (length > SIZE_MAX / 2 - old_length) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    if (old_length + length > string->as.string.capacity) {
+        // data may point into this buffer, which the resize can move
+        char *buffer = string->as.string.data;
+        bool aliased = data >= buffer && data < buffer + old_length;
+        size_t offset = aliased ? (size_t)(data - buffer) : 0;
+        
+        size_t new_capacity = string->as.string.capacity * 2;
+        if (new_capacity < old_length + length) {
+            new_capacity = old_length + length;
+        }
+        if (new_capacity < 16) {
+            new_capacity = 16;
+        }
+        
+        buffer = dm_rc_realloc(ctx, buffer, new_capacity + 1);
+        if (buffer == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        string->as.string.data = buffer;
+        string->as.string.capacity = new_capacity;
+        if (aliased) {
+            data = buffer + offset;
+        }
+    }
+    
+    memcpy(string->as.string.data + old_length, data, length);
+    string->as.string.length = old_length + length;
+    string->as.string.data[string->as.string.length] = '\0';
+    return DM_SUCCESS;
+}
+
+// Number of values sharing this value's payload (0 for immediate values)
+size_t dm_value_refcount(const dm_value_t *value) {
+    if (value == NULL) {
+        return 0;
+    }
+    
+    switch (value->type) {
+        case DM_TYPE_STRING:
+            return dm_rc_count(value->as.string.data);
+        case DM_TYPE_ARRAY:
+            return dm_rc_count(value->as.array.items);
+        case DM_TYPE_MATRIX:
+            return dm_rc_count(value->as.matrix.data);
+        case DM_TYPE_OBJECT:
+            return value->as.object != NULL ? __atomic_load_n(&value->as.object->refcount, __ATOMIC_RELAXED) : 0;
+        default:
+            return 0;
+    }
+}
+
+// Add a reference to an object
+void dm_object_retain(dm_object_t *object) {
+    if (object != NULL) {
+        dm_refcount_retain(&object->refcount);
+    }
+}
+
+// Drop a reference to an object, destroying it with the last one
+void dm_object_release(dm_context_t *ctx, dm_object_t *object) {
+    if (object != NULL && dm_refcount_release(&object->refcount) == 0 && object->destroy != NULL) {
+        object->destroy(ctx, object);
+    }
+}
+
+static void free_code(dm_context_t *ctx, dm_code_t *code) {
+    // Unlink first: releasing the code can free other code
+    if (code->prev != NULL) {
+        code->prev->next = code->next;
+    } else {
+        ctx->code = code->next;
+    }
+    if (code->next != NULL) {
+        code->next->prev = code->prev;
+    }
+    
+    code->release(ctx, code->data);
+    dm_free(ctx, code);
+}
+
+// Last reference to code dropped. Call sites may have cached its functions.
+// Until the run ends, frames and tail calls may still be running it; the
+// worker threads of a parallel loop only ever get here during a run.
+static void code_destroy(dm_context_t *ctx, dm_object_t *object) {
+    dm_code_t *code = (dm_code_t*)object;
+    dm_context_t *root = ctx->parent != NULL ? ctx->parent : ctx;
+    
+    __atomic_fetch_add(&root->definition_epoch, 1, __ATOMIC_RELAXED);
+    if (root->run_depth > 0) {
+        code->dead = true;
+        return;
+    }
+    
+    free_code(root, code);
+}
+
+// Wrap code that function values will point into
+dm_object_t* dm_code_create(dm_context_t *ctx, void *data, void (*release)(dm_context_t *ctx, void *data)) {
+    if (ctx == NULL || ctx->parent != NULL || data == NULL || release == NULL) {
+        return NULL;
+    }
+    
+    dm_code_t *code = dm_calloc(ctx, 1, sizeof(dm_code_t));
+    if (code == NULL) {
+        return NULL;
+    }
+    
+    code->object.refcount = 1;
+    code->object.destroy = code_destroy;
+    code->data = data;
+    code->release = release;
+    code->next = ctx->code;
+    if (ctx->code != NULL) {
+        ctx->code->prev = code;
+    }
+    ctx->code = code;
+    return &code->object;
+}
+
+// Free code released during the run that just ended
+void dm_code_collect(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->run_depth > 0) {
+        return;
+    }
+    
+    dm_code_t *code = ctx->code;
+    while (code != NULL) {
+        if (!code->dead) {
+            code = code->next;
+            continue;
+        }
+        
+        // Freeing can release other code, so start over
+        free_code(ctx, code);
+        code = ctx->code;
+    }
 }
 
 // Set error message in context
@@ -10,16 +10,16 @@
 #include "../../include/core/filesystem.h"
 
 // VFS key in context
-#define DM_VFS_KEY "dm_vfs"
+#define DM_VFS_KEY "dm_vfs"  // Interned before use as a symbol name
 
 // Helper to get VFS from context
 static dm_vfs_t* get_vfs(dm_context_t *ctx) {
-    dm_value_t vfs_val;
-    dm_error_t err = dm_scope_lookup(ctx, ctx->global_scope, DM_VFS_KEY, &vfs_val);
-    if (err != DM_SUCCESS || vfs_val.type != DM_TYPE_OBJECT) {
+    const dm_value_t *vfs_val = NULL;
+    dm_error_t err = dm_scope_lookup_ref(ctx, ctx->global_scope, dm_intern(ctx, DM_VFS_KEY, strlen(DM_VFS_KEY)), &vfs_val);
+    if (err != DM_SUCCESS || vfs_val->type != DM_TYPE_OBJECT) {
         return NULL;
     }
-    return (dm_vfs_t*)vfs_val.as.object;
+    return (dm_vfs_t*)vfs_val->as.object;
 }
 
 // Join two paths
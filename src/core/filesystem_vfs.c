@@ -11,7 +11,7 @@
 #include "../../include/core/filesystem.h"
 
 // VFS key in context
-#define DM_VFS_KEY "dm_vfs"
+#define DM_VFS_KEY "dm_vfs"  // Interned before use as a symbol name
 
 // Helper functions
 
@@ -21,17 +21,65 @@ dm_vfs_t* get_vfs(dm_context_t *ctx) {
         return NULL;
     }
     
-    dm_value_t vfs_val;
-    dm_error_t err = dm_scope_lookup(ctx, ctx->global_scope, DM_VFS_KEY, &vfs_val);
+    const dm_value_t *vfs_val = NULL;
+    dm_error_t err = dm_scope_lookup_ref(ctx, ctx->global_scope, dm_intern(ctx, DM_VFS_KEY, strlen(DM_VFS_KEY)), &vfs_val);
     if (err != DM_SUCCESS) {
         return NULL;
     }
     
-    if (vfs_val.type != DM_TYPE_OBJECT) {
+    if (vfs_val->type != DM_TYPE_OBJECT) {
         return NULL;
     }
     
-    return (dm_vfs_t*)vfs_val.as.object;
+    return (dm_vfs_t*)vfs_val->as.object;
+}
+
+// Free a VFS once the last value referring to it is gone
+static void vfs_destroy(dm_context_t *ctx, dm_object_t *object) {
+    dm_vfs_t *vfs = (dm_vfs_t*)object;
+    
+    // Free mount points
+    dm_vfs_entry_t *entry = vfs->mounts;
+    while (entry != NULL) {
+        dm_vfs_entry_t *next = entry->next;
+        
+        // Free name and path
+        if (entry->name != NULL) {
+            dm_free(ctx, entry->name);
+        }
+        if (entry->real_path != NULL) {
+            dm_free(ctx, entry->real_path);
+        }
+        
+        // Free entry
+        dm_free(ctx, entry);
+        
+        entry = next;
+    }
+    
+    // Free working directory
+    if (vfs->working_dir != NULL) {
+        dm_free(ctx, vfs->working_dir);
+    }
+    
+    // Free VFS
+    dm_free(ctx, vfs);
+}
+
+// Store a VFS in the global scope, which then owns it
+static dm_error_t vfs_store(dm_context_t *ctx, dm_vfs_t *vfs) {
+    vfs->object.refcount = 1;
+    vfs->object.destroy = vfs_destroy;
+    vfs->object.next = NULL;
+    
+    dm_value_t vfs_val;
+    dm_value_init(&vfs_val);
+    dm_value_set_object(ctx, &vfs_val, &vfs->object);
+    
+    // On failure dropping our reference frees the VFS
+    dm_error_t err = dm_scope_define(ctx, ctx->global_scope, dm_intern(ctx, DM_VFS_KEY, strlen(DM_VFS_KEY)), vfs_val);
+    dm_value_free(ctx, &vfs_val);
+    return err;
 }
 
 // Initialize VFS
@@ -77,16 +125,10 @@ dm_error_t dm_vfs_init(dm_context_t *ctx) {
     }
     
     // Store VFS in context
-    dm_value_t vfs_val;
-    vfs_val.type = DM_TYPE_OBJECT;
-    vfs_val.as.object = (dm_object_t*)vfs;
-    
-    err = dm_scope_define(ctx, ctx->global_scope, DM_VFS_KEY, vfs_val);
+    err = vfs_store(ctx, vfs);
     if (err != DM_SUCCESS) {
         // Clean up
         dm_vfs_unmount(ctx, "/");
-        dm_free(ctx, vfs->working_dir);
-        dm_free(ctx, vfs);
         return err;
     }
     
@@ -105,34 +147,10 @@ dm_error_t dm_vfs_cleanup(dm_context_t *ctx) {
         return DM_ERROR_INVALID_ARGUMENT;
     }
     
-    // Free mount points
-    dm_vfs_entry_t *entry = vfs->mounts;
-    while (entry != NULL) {
-        dm_vfs_entry_t *next = entry->next;
-        
-        // Free name and path
-        if (entry->name != NULL) {
-            dm_free(ctx, entry->name);
-        }
-        if (entry->real_path != NULL) {
-            dm_free(ctx, entry->real_path);
-        }
-        
-        // Free entry
-        dm_free(ctx, entry);
-        
-        entry = next;
-    }
-    
-    // Free working directory
-    if (vfs->working_dir != NULL) {
-        dm_free(ctx, vfs->working_dir);
-    }
-    
-    // Free VFS
-    dm_free(ctx, vfs);
-    
-    return DM_SUCCESS;
+    // Dropping the context's reference frees the VFS
+    dm_value_t null_val;
+    dm_value_init(&null_val);
+    return dm_scope_assign(ctx, ctx->global_scope, dm_intern(ctx, DM_VFS_KEY, strlen(DM_VFS_KEY)), null_val);
 }
 
 // Mount a real path to a virtual path
@@ -198,17 +216,8 @@ dm_error_t dm_vfs_mount(dm_context_t *ctx, const char *mount_point, const char *
         vfs->path_separator = '/';
         #endif
         
-        // Create value for scope
-        dm_value_t vfs_val;
-        vfs_val.type = DM_TYPE_OBJECT;
-        vfs_val.as.object = (dm_object_t*)vfs;
-        
         // Store in context
-        dm_error_t err = dm_scope_define(ctx, ctx->global_scope, DM_VFS_KEY, vfs_val);
-        if (err != DM_SUCCESS) {
-            return err;
-        }
-        return err;
+        return vfs_store(ctx, vfs);
     }
     
     // Check if mount point already exists
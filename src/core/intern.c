@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "../../include/core/intern.h"
+#include "../../include/core/memory.h"
+
+// An interned string; atoms point at its text
+typedef struct dm_atom {
+    struct dm_atom *next;       // Next atom in the same bucket
+    size_t hash;
+    size_t length;
+    dm_value_t value;           // Shared string value, made on first use
+    atomic_bool has_value;      // Set once value is made
+    char text[];
+} dm_atom_t;
+
+// Per-context table of atoms
+struct dm_intern_table {
+    dm_atom_t **buckets;
+    size_t bucket_count;        // Power of two
+    size_t count;
+};
+
+#define DM_INTERN_INITIAL_BUCKETS 256
+
+// FNV-1a over the text
+static size_t hash_text(const char *text, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static dm_atom_t* atom_header(const char *atom) {
+    return (dm_atom_t*)(atom - offsetof(dm_atom_t, text));
+}
+
+static dm_atom_t* find_atom(const struct dm_intern_table *table, const char *text, size_t length, size_t hash) {
+    dm_atom_t *atom = table->buckets[hash & (table->bucket_count - 1)];
+    while (atom != NULL) {
+        if (atom->text == text ||
+            (atom->hash == hash && atom->length == length && memcmp(atom->text, text, length) == 0)) {
+            return atom;
+        }
+        atom = atom->next;
+    }
+    return NULL;
+}
+
+// Double the bucket array once the table is as full as it is wide
+static dm_error_t grow_table(dm_context_t *ctx, struct dm_intern_table *table) {
+    size_t new_count = table->bucket_count * 2;
+    dm_atom_t **buckets = dm_calloc(ctx, new_count, sizeof(dm_atom_t*));
+    if (buckets == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        dm_atom_t *atom = table->buckets[i];
+        while (atom != NULL) {
+            dm_atom_t *next = atom->next;
+            size_t index = atom->hash & (new_count - 1);
+            atom->next = buckets[index];
+            buckets[index] = atom;
+            atom = next;
+        }
+    }
+
+    dm_free(ctx, table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = new_count;
+    return DM_SUCCESS;
+}
+
+// Return the atom for a text, adding it on first sight
+const char* dm_intern(dm_context_t *ctx, const char *text, size_t length) {
+    if (ctx == NULL || (text == NULL && length > 0)) {
+        return NULL;
+    }
+
+    struct dm_intern_table *table = ctx->interns;
+    if (table == NULL) {
+        table = dm_calloc(ctx, 1, sizeof(struct dm_intern_table));
+        if (table == NULL) {
+            return NULL;
+        }
+        table->buckets = dm_calloc(ctx, DM_INTERN_INITIAL_BUCKETS, sizeof(dm_atom_t*));
+        if (table->buckets == NULL) {
+            dm_free(ctx, table);
+            return NULL;
+        }
+        table->bucket_count = DM_INTERN_INITIAL_BUCKETS;
+        ctx->interns = table;
+    }
+
+    size_t hash = hash_text(text, length);
+    dm_atom_t *atom = find_atom(table, text, length, hash);
+    if (atom != NULL) {
+        return atom->text;
+    }
+
+    if (table->count >= table->bucket_count && grow_table(ctx, table) != DM_SUCCESS) {
+        return NULL;
+    }
+
+    atom = dm_malloc(ctx, sizeof(dm_atom_t) + length + 1);
+    if (atom == NULL) {
+        return NULL;
+    }
+
+    atom->hash = hash;
+    atom->length = length;
+    dm_value_init(&atom->value);
+    atomic_init(&atom->has_value, false);
+    if (length > 0) {
+        memcpy(atom->text, text, length);
+    }
+    atom->text[length] = '\0';
+
+    size_t index = hash & (table->bucket_count - 1);
+    atom->next = table->buckets[index];
+    table->buckets[index] = atom;
+    table->count++;
+
+    return atom->text;
+}
+
+// Find the atom for a null-terminated text without adding it
+const char* dm_intern_find(dm_context_t *ctx, const char *text) {
+    if (ctx == NULL || text == NULL || ctx->interns == NULL) {
+        return NULL;
+    }
+
+    size_t length = strlen(text);
+    dm_atom_t *atom = find_atom(ctx->interns, text, length, hash_text(text, length));
+    return atom != NULL ? atom->text : NULL;
+}
+
+// Free every atom of the context
+void dm_intern_destroy(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->interns == NULL) {
+        return;
+    }
+
+    struct dm_intern_table *table = ctx->interns;
+    for (size_t i = 0; i < table->bucket_count; i++) {
+        dm_atom_t *atom = table->buckets[i];
+        while (atom != NULL) {
+            dm_atom_t *next = atom->next;
+            dm_value_free(ctx, &atom->value);
+            dm_free(ctx, atom);
+            atom = next;
+        }
+    }
+
+    dm_free(ctx, table->buckets);
+    dm_free(ctx, table);
+    ctx->interns = NULL;
+}
+
+size_t dm_atom_hash(const char *atom) {
+    return atom_header(atom)->hash;
+}
+
+size_t dm_atom_length(const char *atom) {
+    return atom_header(atom)->length;
+}
+
+// Parallel loop workers may ask for the same atom's value at once
+static pthread_mutex_t atom_value_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// String value of an atom. Literals evaluate to this shared value instead
+// of allocating a new string each time.
+const dm_value_t* dm_atom_value(dm_context_t *ctx, const char *atom) {
+    dm_atom_t *header = atom_header(atom);
+    if (atomic_load_explicit(&header->has_value, memory_order_acquire)) {
+        return &header->value;
+    }
+
+    pthread_mutex_lock(&atom_value_lock);
+    bool made = header->value.type == DM_TYPE_STRING ||
+                dm_value_set_string(ctx, &header->value, header->text, header->length) == DM_SUCCESS;
+    if (made) {
+        atomic_store_explicit(&header->has_value, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&atom_value_lock);
+
+    return made ? &header->value : NULL;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE   // For pthread_getattr_np
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -6,6 +7,8 @@
 #include <unistd.h>
 #include <execinfo.h> // For backtrace support
 #include <signal.h>   // For signal handling
+#include <pthread.h>  // For the kernel timer thread
+#include <errno.h>
 #include <sys/resource.h> // For resource usage
 #include "../../include/core/kernel.h"
 #include "../../include/core/memory.h"
@@ -51,6 +54,115 @@ static struct {
     int watchdog_interval_ms;
 } health_state = {0};
 
+// Timer thread of a context. It never touches interpreter state: at a
+// run's deadline it raises the interrupt flag, and when a watchdog check is
+// due it sets ctx->watchdog_due; the running script acts on both when it
+// next polls.
+struct dm_kernel_timer {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // Signalled whenever the fields below change
+    dm_context_t *ctx;
+    bool stop;
+    bool armed;                 // Whether deadline applies
+    struct timespec deadline;
+    int watchdog_interval_ms;   // 0 while no watchdog is registered
+    struct timespec next_watchdog;
+};
+
+// CLOCK_MONOTONIC time interval_ms from now
+static struct timespec timespec_after(int interval_ms) {
+    struct timespec when;
+    clock_gettime(CLOCK_MONOTONIC, &when);
+    when.tv_sec += interval_ms / 1000;
+    when.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+    if (when.tv_nsec >= 1000000000L) {
+        when.tv_sec++;
+        when.tv_nsec -= 1000000000L;
+    }
+    return when;
+}
+
+static bool timespec_reached(const struct timespec *now, const struct timespec *when) {
+    return now->tv_sec > when->tv_sec ||
+           (now->tv_sec == when->tv_sec && now->tv_nsec >= when->tv_nsec);
+}
+
+static void* timer_main(void *arg) {
+    struct dm_kernel_timer *timer = arg;
+    
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->stop) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        
+        if (timer->armed && timespec_reached(&now, &timer->deadline)) {
+            timer->armed = false;
+            dm_kernel_interrupt(timer->ctx, DM_ERROR_TIMEOUT);
+        }
+        if (timer->watchdog_interval_ms > 0 && timespec_reached(&now, &timer->next_watchdog)) {
+            atomic_store(&timer->ctx->watchdog_due, true);
+            timer->next_watchdog = timespec_after(timer->watchdog_interval_ms);
+        }
+        
+        // Sleep until the earlier of the two events, or until woken
+        const struct timespec *wake_at = NULL;
+        if (timer->armed) {
+            wake_at = &timer->deadline;
+        }
+        if (timer->watchdog_interval_ms > 0 &&
+            (wake_at == NULL || !timespec_reached(&timer->next_watchdog, wake_at))) {
+            wake_at = &timer->next_watchdog;
+        }
+        if (wake_at == NULL) {
+            pthread_cond_wait(&timer->wake, &timer->lock);
+        } else {
+            struct timespec until = *wake_at;
+            pthread_cond_timedwait(&timer->wake, &timer->lock, &until);
+        }
+    }
+    pthread_mutex_unlock(&timer->lock);
+    
+    return NULL;
+}
+
+// Start the context's timer thread on first use
+static dm_error_t start_timer(dm_context_t *ctx) {
+    if (ctx->timer != NULL) {
+        return DM_SUCCESS;
+    }
+    
+    struct dm_kernel_timer *timer = dm_calloc(ctx, 1, sizeof(struct dm_kernel_timer));
+    if (timer == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    timer->ctx = ctx;
+    
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_cond_init(&timer->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    
+    // The timer must not take signals meant for the interpreter thread
+    sigset_t blocked, previous;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+    int rc = pthread_create(&timer->thread, NULL, timer_main, timer);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    if (rc != 0) {
+        pthread_cond_destroy(&timer->wake);
+        pthread_mutex_destroy(&timer->lock);
+        dm_free(ctx, timer);
+        return rc == EAGAIN ? DM_ERROR_BUSY : DM_ERROR_NOT_SUPPORTED;
+    }
+    
+    ctx->timer = timer;
+    return DM_SUCCESS;
+}
+
 // Forward declaration for signal handler
 static void kernel_signal_handler(int sig);
 
@@ -198,8 +310,230 @@ void dm_register_watchdog(dm_context_t *ctx, int interval_ms) {
     // Install signal handlers
     install_signal_handlers(ctx);
     
-    // TODO: In a real system, we would set up a timer here to call 
-    // dm_kernel_watchdog() periodically. For now, it's manual.
+    // Have the timer thread schedule the checks
+    if (ctx != NULL && start_timer(ctx) == DM_SUCCESS) {
+        pthread_mutex_lock(&ctx->timer->lock);
+        ctx->timer->watchdog_interval_ms = interval_ms;
+        ctx->timer->next_watchdog = timespec_after(interval_ms);
+        pthread_cond_signal(&ctx->timer->wake);
+        pthread_mutex_unlock(&ctx->timer->lock);
+    }
+}
+
+// Stop a run with reason, keeping the message for the error report
+static dm_error_t stop_run(dm_context_t *ctx, dm_error_t reason) {
+    // Parallel workers take part in their parent's run
+    dm_context_t *run = ctx->parent != NULL ? ctx->parent : ctx;
+    
+    char message[128];
+    if (reason == DM_ERROR_TIMEOUT && run->max_steps > 0 &&
+        __atomic_load_n(&run->steps_left, __ATOMIC_RELAXED) == 0) {
+        snprintf(message, sizeof(message), "Step limit of %llu exceeded",
+                 (unsigned long long)run->max_steps);
+    } else if (reason == DM_ERROR_TIMEOUT) {
+        snprintf(message, sizeof(message), "Time limit of %u ms exceeded", run->time_limit_ms);
+    } else {
+        snprintf(message, sizeof(message), "Execution interrupted");
+    }
+    dm_context_set_error(ctx, message);
+    
+    // Keep failing at every later step until the run has unwound
+    ctx->poll_countdown = 1;
+    return reason;
+}
+
+// Poll of a parallel worker. The interrupt flag and the step budget are
+// the parent's; workers take their slices of the budget concurrently.
+static dm_error_t poll_worker(dm_context_t *ctx) {
+    dm_context_t *run = ctx->parent;
+    dm_error_t reason = (dm_error_t)atomic_load_explicit(&run->interrupt, memory_order_relaxed);
+    if (reason != DM_SUCCESS) {
+        return stop_run(ctx, reason);
+    }
+    
+    if (run->max_steps == 0 || run->run_depth == 0) {
+        ctx->poll_countdown = DM_POLL_INTERVAL;
+        return DM_SUCCESS;
+    }
+    
+    uint64_t left = __atomic_load_n(&run->steps_left, __ATOMIC_RELAXED);
+    uint64_t slice;
+    do {
+        if (left == 0) {
+            return stop_run(ctx, DM_ERROR_TIMEOUT);
+        }
+        slice = left < DM_POLL_INTERVAL ? left : DM_POLL_INTERVAL;
+    } while (!__atomic_compare_exchange_n(&run->steps_left, &left, left - slice, false,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    ctx->poll_countdown = (uint32_t)slice;
+    return DM_SUCCESS;
+}
+
+// Slow path of DM_KERNEL_STEP
+dm_error_t dm_kernel_poll(dm_context_t *ctx) {
+    if (ctx->parent != NULL) {
+        return poll_worker(ctx);
+    }
+    
+    dm_error_t reason = (dm_error_t)atomic_load_explicit(&ctx->interrupt, memory_order_relaxed);
+    if (reason != DM_SUCCESS) {
+        return stop_run(ctx, reason);
+    }
+    
+    if (atomic_exchange_explicit(&ctx->watchdog_due, false, memory_order_relaxed)) {
+        dm_kernel_watchdog(ctx);
+    }
+    
+    if (ctx->max_steps == 0 || ctx->run_depth == 0) {
+        ctx->poll_countdown = DM_POLL_INTERVAL;
+        return DM_SUCCESS;
+    }
+    
+    // Hand out the budget in slices; this step is the first of the slice
+    if (ctx->steps_left == 0) {
+        return stop_run(ctx, DM_ERROR_TIMEOUT);
+    }
+    uint64_t slice = ctx->steps_left < DM_POLL_INTERVAL ? ctx->steps_left : DM_POLL_INTERVAL;
+    ctx->steps_left -= slice;
+    ctx->poll_countdown = (uint32_t)slice;
+    return DM_SUCCESS;
+}
+
+// Request that the running script stop
+void dm_kernel_interrupt(dm_context_t *ctx, dm_error_t reason) {
+    if (ctx == NULL || reason == DM_SUCCESS) {
+        return;
+    }
+    
+    int expected = DM_SUCCESS;
+    atomic_compare_exchange_strong(&ctx->interrupt, &expected, (int)reason);
+}
+
+// Lowest stack address the current thread lets scripts recurse down to,
+// found on its first check (1 when the stack bounds are unknown)
+static _Thread_local uintptr_t stack_floor;
+
+// Whether the current thread's C stack is nearly used up
+bool dm_kernel_stack_low(void) {
+    char marker;
+    
+    if (stack_floor == 0) {
+        stack_floor = 1;
+        
+        pthread_attr_t attr;
+        void *base;
+        size_t size;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            if (pthread_attr_getstack(&attr, &base, &size) == 0) {
+                // Small stacks (some helper threads) keep a quarter in reserve
+                size_t reserve = size / 4 < DM_STACK_RESERVE ? size / 4 : DM_STACK_RESERVE;
+                stack_floor = (uintptr_t)base + reserve;
+            }
+            pthread_attr_destroy(&attr);
+        }
+    }
+    
+    return (uintptr_t)&marker < stack_floor;
+}
+
+// Start the outermost run: fresh budget, no stale interrupt, armed deadline
+dm_error_t dm_kernel_begin_run(dm_context_t *ctx) {
+    if (ctx == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    if (ctx->run_depth++ > 0) {
+        return DM_SUCCESS;
+    }
+    
+    atomic_store(&ctx->interrupt, DM_SUCCESS);
+    ctx->steps_left = ctx->max_steps;
+    ctx->poll_countdown = 1;
+    
+    if (ctx->time_limit_ms == 0) {
+        return DM_SUCCESS;
+    }
+    
+    dm_error_t err = start_timer(ctx);
+    if (err != DM_SUCCESS) {
+        ctx->run_depth--;
+        return err;
+    }
+    
+    pthread_mutex_lock(&ctx->timer->lock);
+    ctx->timer->deadline = timespec_after((int)ctx->time_limit_ms);
+    ctx->timer->armed = true;
+    pthread_cond_signal(&ctx->timer->wake);
+    pthread_mutex_unlock(&ctx->timer->lock);
+    
+    return DM_SUCCESS;
+}
+
+// Finish a run, disarming the deadline once the outermost run is over
+void dm_kernel_end_run(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->run_depth == 0 || --ctx->run_depth > 0) {
+        return;
+    }
+    
+    ctx->poll_countdown = 1;
+    
+    if (ctx->timer != NULL) {
+        pthread_mutex_lock(&ctx->timer->lock);
+        ctx->timer->armed = false;
+        pthread_mutex_unlock(&ctx->timer->lock);
+    }
+    
+    // Code released while it could still be running can go now
+    dm_code_collect(ctx);
+}
+
+// Context whose runs SIGINT interrupts
+static dm_context_t *volatile interrupt_target = NULL;
+
+static void interrupt_signal_handler(int sig) {
+    dm_context_t *ctx = interrupt_target;
+    if (ctx != NULL && ctx->run_depth > 0) {
+        dm_kernel_interrupt(ctx, DM_ERROR_INTERRUPTED);
+        return;
+    }
+    
+    // Nothing to interrupt: behave as if the handler was never installed
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Route SIGINT to the runs of a context
+void dm_kernel_catch_interrupts(dm_context_t *ctx) {
+    interrupt_target = ctx;
+    
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupt_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, NULL);
+}
+
+// Stop and free the timer thread
+void dm_kernel_timer_stop(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->timer == NULL) {
+        return;
+    }
+    
+    struct dm_kernel_timer *timer = ctx->timer;
+    pthread_mutex_lock(&timer->lock);
+    timer->stop = true;
+    pthread_cond_signal(&timer->wake);
+    pthread_mutex_unlock(&timer->lock);
+    pthread_join(timer->thread, NULL);
+    
+    pthread_cond_destroy(&timer->wake);
+    pthread_mutex_destroy(&timer->lock);
+    dm_free(ctx, timer);
+    ctx->timer = NULL;
+    
+    if (interrupt_target == ctx) {
+        interrupt_target = NULL;
+    }
 }
 
 // Kernel panic - called when a fatal error occurs that cannot be recovered from
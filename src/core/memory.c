@@ -1,19 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "../../include/core/memory.h"
 
-// Memory pool structure
+// Memory pool structure. Block k holds (1 << items_shift) << k items, so
+// blocks never move once added and an item's index maps to its address
+// without a lock.
+#define DM_POOL_MAX_BLOCKS 32
+
 struct dm_memory_pool {
     dm_context_t *ctx;
-    size_t block_size;
-    void **blocks;
-    size_t block_count;
-    void *current_block;
-    size_t current_offset;
-    size_t items_per_block;
+    size_t block_size;              // Size of an item (room for a free-list link at least)
+    size_t items_shift;             // Items in the first block, as a power of two
+    void *blocks[DM_POOL_MAX_BLOCKS];
+    size_t next_item;               // Index of the first item never handed out
+    bool concurrent;
+    
+    // Freed items, linked through their first word. A plain pool links
+    // pointers; a concurrent one keeps a tag << 32 | (index + 1) head so a
+    // compare-and-swap cannot mistake a reused item for the one it saw.
+    void *free_list;
+    uint64_t free_head;
+    pthread_mutex_t grow_lock;      // Taken by concurrent pools to add a block
 };
 
+// Header in front of reference-counted blocks (padded to keep the payload
+// maximally aligned)
+typedef union {
+    size_t refcount;
+    max_align_t align;
+} dm_rc_header_t;
+
 // Memory tracking structure
 typedef struct dm_memory_tracker {
     // Allocation statistics
@@ -23,12 +44,21 @@ typedef struct dm_memory_tracker {
     size_t current_bytes_allocated;
     size_t peak_bytes_allocated;
     
-    // Allocation tracking
+    // Allocation tracking: an open-addressed table keyed by pointer, with
+    // linear probing. Empty slots have a NULL ptr; removal shifts the rest of
+    // the probe run back, so there are no tombstones.
     dm_memory_allocation_t *allocations;
-    size_t allocations_size;
-    size_t allocations_capacity;
+    size_t allocations_size;        // Occupied slots
+    size_t allocations_capacity;    // Power of two, kept at most half full
 } dm_memory_tracker_t;
 
+// Home slot of a pointer
+static size_t allocation_slot(const dm_memory_tracker_t *tracker, const void *ptr) {
+    // Low bits are alignment; Fibonacci hashing spreads the rest
+    uint64_t key = (uint64_t)(uintptr_t)ptr >> 4;
+    return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (tracker->allocations_capacity - 1);
+}
+
 // Initialize memory tracker
 static dm_memory_tracker_t* create_memory_tracker() {
     dm_memory_tracker_t *tracker = malloc(sizeof(dm_memory_tracker_t));
@@ -40,7 +70,7 @@ static dm_memory_tracker_t* create_memory_tracker() {
     
     // Initial capacity for allocation tracking
     tracker->allocations_capacity = 1024;
-    tracker->allocations = malloc(tracker->allocations_capacity * sizeof(dm_memory_allocation_t));
+    tracker->allocations = calloc(tracker->allocations_capacity, sizeof(dm_memory_allocation_t));
     if (tracker->allocations == NULL) {
         free(tracker);
         return NULL;
@@ -62,41 +92,46 @@ static void destroy_memory_tracker(dm_memory_tracker_t *tracker) {
     free(tracker);
 }
 
-// Track an allocation
-static void track_allocation(dm_memory_tracker_t *tracker, void *ptr, size_t size, const char *file, int line) {
-    if (tracker == NULL || ptr == NULL) {
-        return;
+// Place an entry in the table (its pointer must not be there yet)
+static void insert_allocation(dm_memory_tracker_t *tracker, const dm_memory_allocation_t *entry) {
+    size_t mask = tracker->allocations_capacity - 1;
+    size_t i = allocation_slot(tracker, entry->ptr);
+    while (tracker->allocations[i].ptr != NULL) {
+        i = (i + 1) & mask;
     }
     
-    // Resize allocation array if needed
-    if (tracker->allocations_size >= tracker->allocations_capacity) {
-        size_t new_capacity = tracker->allocations_capacity * 2;
-        dm_memory_allocation_t *new_allocations = realloc(tracker->allocations, 
-            new_capacity * sizeof(dm_memory_allocation_t));
-        
-        if (new_allocations == NULL) {
-            // Can't resize, just record stats without tracking this allocation
-            tracker->total_allocations++;
-            tracker->active_allocations++;
-            tracker->total_bytes_allocated += size;
-            tracker->current_bytes_allocated += size;
-            
-            if (tracker->current_bytes_allocated > tracker->peak_bytes_allocated) {
-                tracker->peak_bytes_allocated = tracker->current_bytes_allocated;
-            }
-            return;
+    tracker->allocations[i] = *entry;
+    tracker->allocations_size++;
+}
+
+// Double the table, rehashing every entry
+static bool grow_allocations(dm_memory_tracker_t *tracker) {
+    size_t old_capacity = tracker->allocations_capacity;
+    dm_memory_allocation_t *old_allocations = tracker->allocations;
+    
+    dm_memory_allocation_t *new_allocations = calloc(old_capacity * 2, sizeof(dm_memory_allocation_t));
+    if (new_allocations == NULL) {
+        return false;
+    }
+    
+    tracker->allocations = new_allocations;
+    tracker->allocations_capacity = old_capacity * 2;
+    tracker->allocations_size = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_allocations[i].ptr != NULL) {
+            insert_allocation(tracker, &old_allocations[i]);
         }
-        
-        tracker->allocations = new_allocations;
-        tracker->allocations_capacity = new_capacity;
     }
     
-    // Record allocation
-    dm_memory_allocation_t *alloc = &tracker->allocations[tracker->allocations_size++];
-    alloc->ptr = ptr;
-    alloc->size = size;
-    alloc->file = file;
-    alloc->line = line;
+    free(old_allocations);
+    return true;
+}
+
+// Track an allocation
+static void track_allocation(dm_memory_tracker_t *tracker, void *ptr, size_t size, const char *file, int line) {
+    if (tracker == NULL || ptr == NULL) {
+        return;
+    }
     
     // Update stats
     tracker->total_allocations++;
@@ -107,15 +142,27 @@ static void track_allocation(dm_memory_tracker_t *tracker, void *ptr, size_t siz
     if (tracker->current_bytes_allocated > tracker->peak_bytes_allocated) {
         tracker->peak_bytes_allocated = tracker->current_bytes_allocated;
     }
+    
+    // Keep the table at most half full so probe runs stay short
+    if ((tracker->allocations_size + 1) * 2 > tracker->allocations_capacity &&
+        !grow_allocations(tracker)) {
+        // Can't resize, just record stats without tracking this allocation
+        return;
+    }
+    
+    // Record allocation
+    dm_memory_allocation_t alloc = { ptr, size, file, line };
+    insert_allocation(tracker, &alloc);
 }
 
-// Find allocation index by pointer
+// Find allocation slot by pointer
 static int find_allocation(dm_memory_tracker_t *tracker, void *ptr) {
     if (tracker == NULL || ptr == NULL) {
         return -1;
     }
     
-    for (size_t i = 0; i < tracker->allocations_size; i++) {
+    size_t mask = tracker->allocations_capacity - 1;
+    for (size_t i = allocation_slot(tracker, ptr); tracker->allocations[i].ptr != NULL; i = (i + 1) & mask) {
         if (tracker->allocations[i].ptr == ptr) {
             return (int)i;
         }
@@ -137,10 +184,18 @@ static size_t untrack_allocation(dm_memory_tracker_t *tracker, void *ptr) {
     
     size_t size = tracker->allocations[index].size;
     
-    // Remove by swapping with the last element
-    if ((size_t)index < tracker->allocations_size - 1) {
-        tracker->allocations[index] = tracker->allocations[tracker->allocations_size - 1];
+    // Remove by shifting back the entries after it in the probe run that
+    // the hole would otherwise cut off from their home slot
+    size_t mask = tracker->allocations_capacity - 1;
+    size_t hole = (size_t)index;
+    for (size_t i = (hole + 1) & mask; tracker->allocations[i].ptr != NULL; i = (i + 1) & mask) {
+        size_t home = allocation_slot(tracker, tracker->allocations[i].ptr);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            tracker->allocations[hole] = tracker->allocations[i];
+            hole = i;
+        }
     }
+    tracker->allocations[hole].ptr = NULL;
     tracker->allocations_size--;
     
     // Update stats
@@ -150,19 +205,183 @@ static size_t untrack_allocation(dm_memory_tracker_t *tracker, void *ptr) {
     return size;
 }
 
+// Size-class slabs. Blocks of up to DM_SLAB_MAX_SIZE bytes are carved from
+// DM_SLAB_SIZE slabs and recycled through per-thread free lists, which trade
+// batches with a shared depot; larger blocks come from libc. Every block has
+// a header holding its class, so dm_free and dm_realloc need no lookup.
+// Building with DM_MEMORY_NO_SLABS sends everything to libc (handy under
+// sanitizers).
+#ifdef DM_MEMORY_NO_SLABS
+#define DM_SLABS_ENABLED 0
+#else
+#define DM_SLABS_ENABLED 1
+#endif
+
+#define DM_SLAB_SIZE (64 * 1024)
+#define DM_SLAB_MAX_SIZE 4096
+#define DM_SLAB_CLASS_COUNT 16
+#define DM_SLAB_LARGE DM_SLAB_CLASS_COUNT   // Class of blocks from libc
+#define DM_SLAB_BATCH 32                    // Blocks moved to or from the depot at a time
+
+static const size_t slab_class_sizes[DM_SLAB_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+
+// Header in front of every block from dm_malloc (padded to keep the payload
+// maximally aligned)
+typedef union dm_block_header {
+    size_t size_class;
+    union dm_block_header *next;    // While on a free list
+    max_align_t align;
+} dm_block_header_t;
+
+// A thread's free blocks, by class
+typedef struct {
+    dm_block_header_t *free[DM_SLAB_CLASS_COUNT];
+    size_t count[DM_SLAB_CLASS_COUNT];
+    bool registered;                // Gives its blocks back when the thread exits
+} dm_slab_cache_t;
+
+static _Thread_local dm_slab_cache_t slab_cache;
+
+// Free blocks shared by all threads, and every slab (linked through their
+// first header) so they stay reachable
+static pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER;
+static dm_block_header_t *slab_depot[DM_SLAB_CLASS_COUNT];
+static dm_block_header_t *slab_list;
+
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slab_key;
+
+// Class of a block of size bytes (1 to DM_SLAB_MAX_SIZE): steps of 16 up to
+// 64, then two classes per power of two
+static size_t slab_class(size_t size) {
+    if (size <= 64) {
+        return (size - 1) >> 4;
+    }
+    
+    size_t bits = (size_t)(8 * sizeof(unsigned long)) - 1 - (size_t)__builtin_clzl((unsigned long)(size - 1));
+    return 4 + (bits - 6) * 2 + (((size - 1) >> (bits - 1)) & 1);
+}
+
+// Move up to count blocks of a class from one list to another
+static size_t slab_move(dm_block_header_t **from, dm_block_header_t **to, size_t count) {
+    size_t moved = 0;
+    while (moved < count && *from != NULL) {
+        dm_block_header_t *block = *from;
+        *from = block->next;
+        block->next = *to;
+        *to = block;
+        moved++;
+    }
+    
+    return moved;
+}
+
+// Hand a thread's cached blocks back to the depot when it exits
+static void slab_cache_release(void *arg) {
+    dm_slab_cache_t *cache = arg;
+    
+    pthread_mutex_lock(&slab_lock);
+    for (size_t i = 0; i < DM_SLAB_CLASS_COUNT; i++) {
+        slab_move(&cache->free[i], &slab_depot[i], cache->count[i]);
+        cache->count[i] = 0;
+    }
+    pthread_mutex_unlock(&slab_lock);
+}
+
+static void slab_init(void) {
+    pthread_key_create(&slab_key, slab_cache_release);
+}
+
+// Refill a thread's empty list from the depot, carving a new slab when the
+// depot has none
+static bool slab_refill(dm_slab_cache_t *cache, size_t cls) {
+    if (!cache->registered) {
+        pthread_once(&slab_once, slab_init);
+        pthread_setspecific(slab_key, cache);
+        cache->registered = true;
+    }
+    
+    pthread_mutex_lock(&slab_lock);
+    if (slab_depot[cls] == NULL) {
+        dm_block_header_t *slab = malloc(DM_SLAB_SIZE);
+        if (slab == NULL) {
+            pthread_mutex_unlock(&slab_lock);
+            return false;
+        }
+        slab->next = slab_list;
+        slab_list = slab;
+        
+        size_t stride = sizeof(dm_block_header_t) + slab_class_sizes[cls];
+        char *end = (char*)slab + DM_SLAB_SIZE;
+        for (char *p = (char*)(slab + 1); p + stride <= end; p += stride) {
+            dm_block_header_t *block = (dm_block_header_t*)p;
+            block->next = slab_depot[cls];
+            slab_depot[cls] = block;
+        }
+    }
+    cache->count[cls] += slab_move(&slab_depot[cls], &cache->free[cls], DM_SLAB_BATCH);
+    pthread_mutex_unlock(&slab_lock);
+    
+    return true;
+}
+
+static dm_block_header_t* slab_alloc(size_t cls) {
+    dm_slab_cache_t *cache = &slab_cache;
+    if (cache->free[cls] == NULL && !slab_refill(cache, cls)) {
+        return NULL;
+    }
+    
+    dm_block_header_t *block = cache->free[cls];
+    cache->free[cls] = block->next;
+    cache->count[cls]--;
+    block->size_class = cls;
+    return block;
+}
+
+static void slab_free(dm_block_header_t *block, size_t cls) {
+    dm_slab_cache_t *cache = &slab_cache;
+    block->next = cache->free[cls];
+    cache->free[cls] = block;
+    
+    // A thread that frees more than it allocates passes blocks on
+    if (++cache->count[cls] >= 2 * DM_SLAB_BATCH) {
+        pthread_mutex_lock(&slab_lock);
+        cache->count[cls] -= slab_move(&cache->free[cls], &slab_depot[cls], DM_SLAB_BATCH);
+        pthread_mutex_unlock(&slab_lock);
+    }
+}
+
+// A block of at least size bytes from libc, outside the slabs
+static dm_block_header_t* large_alloc(size_t size, bool zeroed) {
+    if (size > SIZE_MAX - sizeof(dm_block_header_t)) {
+        return NULL;
+    }
+    
+    dm_block_header_t *header = zeroed ? calloc(1, sizeof(dm_block_header_t) + size)
+                                       : malloc(sizeof(dm_block_header_t) + size);
+    if (header != NULL) {
+        header->size_class = DM_SLAB_LARGE;
+    }
+    return header;
+}
+
 // Allocate memory
 void* dm_malloc(dm_context_t *ctx, size_t size) {
     if (size == 0) {
         return NULL;
     }
     
-    void *ptr = malloc(size);
-    if (ptr == NULL) {
+    dm_block_header_t *header = DM_SLABS_ENABLED && size <= DM_SLAB_MAX_SIZE
+                                ? slab_alloc(slab_class(size))
+                                : large_alloc(size, false);
+    if (header == NULL) {
         // Out of memory
         return NULL;
     }
     
-    return ptr;
+    return header + 1;
 }
 
 // Debug version with file/line tracking
@@ -187,13 +406,22 @@ void* dm_calloc(dm_context_t *ctx, size_t nmemb, size_t size) {
         return NULL;
     }
     
-    void *ptr = calloc(nmemb, size);
-    if (ptr == NULL) {
+    size_t total = nmemb * size;
+    if (DM_SLABS_ENABLED && total <= DM_SLAB_MAX_SIZE) {
+        void *ptr = dm_malloc(ctx, total);
+        if (ptr != NULL) {
+            memset(ptr, 0, total);
+        }
+        return ptr;
+    }
+    
+    dm_block_header_t *header = large_alloc(total, true);
+    if (header == NULL) {
         // Out of memory
         return NULL;
     }
     
-    return ptr;
+    return header + 1;
 }
 
 // Debug version with file/line tracking
@@ -218,12 +446,38 @@ void* dm_realloc(dm_context_t *ctx, void *ptr, size_t size) {
         return NULL;
     }
     
-    void *new_ptr = realloc(ptr, size);
+    dm_block_header_t *header = (dm_block_header_t*)ptr - 1;
+    size_t cls = header->size_class;
+    
+    // Large blocks that stay large are left to libc
+    if (cls == DM_SLAB_LARGE && (!DM_SLABS_ENABLED || size > DM_SLAB_MAX_SIZE)) {
+        if (size > SIZE_MAX - sizeof(dm_block_header_t)) {
+            return NULL;
+        }
+        header = realloc(header, sizeof(dm_block_header_t) + size);
+        if (header == NULL) {
+            // Out of memory, but original pointer is still valid
+            return NULL;
+        }
+        return header + 1;
+    }
+    
+    // A slab block is kept while the new size fits and uses at least half of it
+    if (cls != DM_SLAB_LARGE && size <= slab_class_sizes[cls] &&
+        (cls == 0 || size > slab_class_sizes[cls] / 2)) {
+        return ptr;
+    }
+    
+    void *new_ptr = dm_malloc(ctx, size);
     if (new_ptr == NULL) {
         // Out of memory, but original pointer is still valid
         return NULL;
     }
     
+    // A large block moving to a slab is shrinking
+    size_t keep = cls == DM_SLAB_LARGE || slab_class_sizes[cls] > size ? size : slab_class_sizes[cls];
+    memcpy(new_ptr, ptr, keep);
+    dm_free(ctx, ptr);
     return new_ptr;
 }
 
@@ -256,7 +510,12 @@ void dm_free(dm_context_t *ctx, void *ptr) {
         untrack_allocation((dm_memory_tracker_t*)ctx->memory_impl, ptr);
     }
     
-    free(ptr);
+    dm_block_header_t *header = (dm_block_header_t*)ptr - 1;
+    if (header->size_class == DM_SLAB_LARGE) {
+        free(header);
+    } else {
+        slab_free(header, header->size_class);
+    }
 }
 
 // Initialize memory subsystem
@@ -290,7 +549,10 @@ void dm_memory_cleanup(dm_context_t *ctx) {
         
         // Print leak details (up to 10)
         size_t leak_count = 0;
-        for (size_t i = 0; i < tracker->allocations_size && leak_count < 10; i++) {
+        for (size_t i = 0; i < tracker->allocations_capacity && leak_count < 10; i++) {
+            if (tracker->allocations[i].ptr == NULL) {
+                continue;
+            }
             fprintf(stderr, "  Leak: %zu bytes at %p (allocated in %s:%d)\n",
                    tracker->allocations[i].size,
                    tracker->allocations[i].ptr,
@@ -322,49 +584,27 @@ dm_error_t dm_memory_get_stats(dm_context_t *ctx, dm_memory_stats_t *stats) {
     // Find largest allocations
     stats->num_largest_allocations = 0;
     
-    // Simple bubble sort to find largest allocations (limited by MAX_LARGEST=10)
+    // Keep the largest allocations (limited by MAX_LARGEST=10)
     const size_t MAX_LARGEST = sizeof(stats->largest_allocations) / sizeof(stats->largest_allocations[0]);
     
     if (tracker->allocations_size > 0) {
-        // Copy allocations to temporary array for sorting
+        // Largest allocations seen so far, biggest first
         dm_memory_allocation_t sorted[MAX_LARGEST];
         memset(sorted, 0, sizeof(sorted));
+        size_t count = 0;
         
-        // Fill with first MAX_LARGEST allocations
-        size_t count = (tracker->allocations_size < MAX_LARGEST) ? 
-                        tracker->allocations_size : MAX_LARGEST;
-        
-        for (size_t i = 0; i < count; i++) {
-            sorted[i] = tracker->allocations[i];
-        }
-        
-        // Sort first MAX_LARGEST elements
-        for (size_t i = 0; i < count; i++) {
-            for (size_t j = i + 1; j < count; j++) {
-                if (sorted[j].size > sorted[i].size) {
-                    dm_memory_allocation_t temp = sorted[i];
-                    sorted[i] = sorted[j];
-                    sorted[j] = temp;
-                }
+        for (size_t i = 0; i < tracker->allocations_capacity; i++) {
+            const dm_memory_allocation_t *alloc = &tracker->allocations[i];
+            if (alloc->ptr == NULL || (count == MAX_LARGEST && alloc->size <= sorted[count-1].size)) {
+                continue;
             }
-        }
-        
-        // Update with rest of allocations if any are larger
-        for (size_t i = count; i < tracker->allocations_size; i++) {
-            if (tracker->allocations[i].size > sorted[count-1].size) {
-                sorted[count-1] = tracker->allocations[i];
-                
-                // Re-sort
-                for (size_t j = count - 1; j > 0; j--) {
-                    if (sorted[j].size > sorted[j-1].size) {
-                        dm_memory_allocation_t temp = sorted[j];
-                        sorted[j] = sorted[j-1];
-                        sorted[j-1] = temp;
-                    } else {
-                        break;
-                    }
-                }
+            
+            // Insert in order, dropping the smallest when full
+            size_t j = count < MAX_LARGEST ? count++ : count - 1;
+            for (; j > 0 && sorted[j-1].size < alloc->size; j--) {
+                sorted[j] = sorted[j-1];
             }
+            sorted[j] = *alloc;
         }
         
         // Copy back to stats
@@ -377,74 +617,192 @@ dm_error_t dm_memory_get_stats(dm_context_t *ctx, dm_memory_stats_t *stats) {
     return DM_SUCCESS;
 }
 
-// Create a memory pool
-dm_memory_pool_t* dm_pool_create(dm_context_t *ctx, size_t block_size) {
-    dm_memory_pool_t *pool = (dm_memory_pool_t*)dm_malloc(ctx, sizeof(dm_memory_pool_t));
+// Block of the item with the given index, and the item's offset in it
+static size_t pool_block_of(const dm_memory_pool_t *pool, size_t index, size_t *offset) {
+    size_t group = (index >> pool->items_shift) + 1;
+    size_t block = (size_t)(8 * sizeof(unsigned long long)) - 1 - (size_t)__builtin_clzll(group);
+    *offset = index - ((((size_t)1 << block) - 1) << pool->items_shift);
+    return block;
+}
+
+// Address of an item whose block exists
+static void* pool_item(const dm_memory_pool_t *pool, size_t index) {
+    size_t offset = 0;
+    size_t block = pool_block_of(pool, index, &offset);
+    char *base = __atomic_load_n(&pool->blocks[block], __ATOMIC_ACQUIRE);
+    return base + offset * pool->block_size;
+}
+
+// Index of an item, from the block that holds it
+static size_t pool_index_of(const dm_memory_pool_t *pool, const void *ptr) {
+    for (size_t block = 0; block < DM_POOL_MAX_BLOCKS; block++) {
+        const char *base = __atomic_load_n(&pool->blocks[block], __ATOMIC_ACQUIRE);
+        if (base == NULL) {
+            break;
+        }
+        
+        size_t items = ((size_t)1 << pool->items_shift) << block;
+        if ((const char*)ptr >= base && (const char*)ptr < base + items * pool->block_size) {
+            size_t first = (((size_t)1 << block) - 1) << pool->items_shift;
+            return first + (size_t)((const char*)ptr - base) / pool->block_size;
+        }
+    }
+    
+    return SIZE_MAX;
+}
+
+// Make sure the block holding a fresh item exists
+static bool pool_reserve(dm_memory_pool_t *pool, size_t index) {
+    size_t offset = 0;
+    size_t block = pool_block_of(pool, index, &offset);
+    if (block >= DM_POOL_MAX_BLOCKS) {
+        return false;
+    }
+    if (__atomic_load_n(&pool->blocks[block], __ATOMIC_ACQUIRE) != NULL) {
+        return true;
+    }
+    
+    size_t items = ((size_t)1 << pool->items_shift) << block;
+    if (items > SIZE_MAX / pool->block_size) {
+        return false;
+    }
+    
+    if (pool->concurrent) {
+        pthread_mutex_lock(&pool->grow_lock);
+    }
+    bool ok = true;
+    if (pool->blocks[block] == NULL) {
+        void *memory = dm_malloc(pool->ctx, items * pool->block_size);
+        if (memory == NULL) {
+            ok = false;
+        } else {
+            __atomic_store_n(&pool->blocks[block], memory, __ATOMIC_RELEASE);
+        }
+    }
+    if (pool->concurrent) {
+        pthread_mutex_unlock(&pool->grow_lock);
+    }
+    
+    return ok;
+}
+
+static dm_memory_pool_t* pool_create(dm_context_t *ctx, size_t block_size, bool concurrent) {
+    if (block_size == 0 || block_size > SIZE_MAX - sizeof(void*)) {
+        return NULL;
+    }
+    
+    dm_memory_pool_t *pool = (dm_memory_pool_t*)dm_calloc(ctx, 1, sizeof(dm_memory_pool_t));
     if (pool == NULL) {
         return NULL;
     }
 
     pool->ctx = ctx;
-    pool->block_size = block_size;
-    pool->items_per_block = 4096 / block_size; // Use 4KB blocks by default
-    if (pool->items_per_block < 8) {
-        pool->items_per_block = 8; // Ensure at least 8 items per block
+    // Round up so every item can hold a free-list link
+    pool->block_size = (block_size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+    size_t items_per_block = 4096 / pool->block_size; // Use 4KB blocks by default
+    if (items_per_block < 8) {
+        items_per_block = 8; // Ensure at least 8 items per block
     }
-
-    pool->blocks = NULL;
-    pool->block_count = 0;
-    pool->current_block = NULL;
-    pool->current_offset = 0;
+    while (((size_t)1 << pool->items_shift) < items_per_block) {
+        pool->items_shift++;
+    }
+    pool->concurrent = concurrent;
+    pthread_mutex_init(&pool->grow_lock, NULL);
 
     return pool;
 }
 
+// Create a memory pool
+dm_memory_pool_t* dm_pool_create(dm_context_t *ctx, size_t block_size) {
+    return pool_create(ctx, block_size, false);
+}
+
+// Create a memory pool that several threads can allocate from and free to
+dm_memory_pool_t* dm_pool_create_concurrent(dm_context_t *ctx, size_t block_size) {
+    return pool_create(ctx, block_size, true);
+}
+
+// Lock-free allocation: pop the free list, or claim a fresh index
+static void* pool_alloc_concurrent(dm_memory_pool_t *pool) {
+    uint64_t head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    while ((uint32_t)head != 0) {
+        // Another thread may pop the item and start using it before our
+        // swap; blocks stay mapped, and the tag then makes the swap fail
+        uint32_t *item = pool_item(pool, (uint32_t)head - 1);
+        uint64_t next = __atomic_load_n(item, __ATOMIC_RELAXED);
+        uint64_t popped = (((head >> 32) + 1) << 32) | next;
+        if (__atomic_compare_exchange_n(&pool->free_head, &head, popped, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return item;
+        }
+    }
+
+    size_t index = __atomic_fetch_add(&pool->next_item, 1, __ATOMIC_RELAXED);
+    if (index >= UINT32_MAX || !pool_reserve(pool, index)) {
+        return NULL;
+    }
+    return pool_item(pool, index);
+}
+
 // Allocate from memory pool
 void* dm_pool_alloc(dm_memory_pool_t *pool) {
     if (pool == NULL) {
         return NULL;
     }
 
-    // If we need a new block
-    if (pool->current_block == NULL || 
-        pool->current_offset >= pool->items_per_block * pool->block_size) {
-        // Allocate new block
-        void *block = dm_malloc(pool->ctx, pool->items_per_block * pool->block_size);
-        if (block == NULL) {
-            return NULL;
-        }
+    if (pool->concurrent) {
+        return pool_alloc_concurrent(pool);
+    }
 
-        // Add to blocks array
-        void **new_blocks = dm_realloc(pool->ctx, pool->blocks, 
-                                    (pool->block_count + 1) * sizeof(void*));
-        if (new_blocks == NULL) {
-            dm_free(pool->ctx, block);
-            return NULL;
-        }
+    // Reuse a freed item first
+    if (pool->free_list != NULL) {
+        void *item = pool->free_list;
+        pool->free_list = *(void**)item;
+        return item;
+    }
 
-        pool->blocks = new_blocks;
-        pool->blocks[pool->block_count++] = block;
-        pool->current_block = block;
-        pool->current_offset = 0;
+    if (!pool_reserve(pool, pool->next_item)) {
+        return NULL;
     }
+    return pool_item(pool, pool->next_item++);
+}
 
-    // Allocate from current block
-    void *ptr = (char*)pool->current_block + pool->current_offset;
-    pool->current_offset += pool->block_size;
+// Return an item to its pool
+void dm_pool_free(dm_memory_pool_t *pool, void *ptr) {
+    if (pool == NULL || ptr == NULL) {
+        return;
+    }
 
-    return ptr;
+    if (!pool->concurrent) {
+        *(void**)ptr = pool->free_list;
+        pool->free_list = ptr;
+        return;
+    }
+
+    size_t index = pool_index_of(pool, ptr);
+    if (index == SIZE_MAX) {
+        return;
+    }
+
+    uint32_t *link = ptr;
+    uint64_t head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+    uint64_t pushed;
+    do {
+        __atomic_store_n(link, (uint32_t)head, __ATOMIC_RELAXED);
+        pushed = (((head >> 32) + 1) << 32) | (uint64_t)(index + 1);
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, pushed, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
 }
 
-// Reset memory pool (keep blocks, just reset offset)
+// Reset memory pool (keep every block; all items are free again)
 void dm_pool_reset(dm_memory_pool_t *pool) {
     if (pool == NULL) {
         return;
     }
 
-    if (pool->block_count > 0) {
-        pool->current_block = pool->blocks[0];
-        pool->current_offset = 0;
-    }
+    pool->free_list = NULL;
+    pool->free_head = 0;
+    pool->next_item = 0;
 }
 
 // Destroy memory pool
@@ -454,34 +812,334 @@ void dm_pool_destroy(dm_memory_pool_t *pool) {
     }
 
     // Free all blocks
-    for (size_t i = 0; i < pool->block_count; i++) {
+    for (size_t i = 0; i < DM_POOL_MAX_BLOCKS; i++) {
         dm_free(pool->ctx, pool->blocks[i]);
     }
 
-    // Free blocks array
-    dm_free(pool->ctx, pool->blocks);
+    pthread_mutex_destroy(&pool->grow_lock);
 
     // Free pool structure
     dm_free(pool->ctx, pool);
 }
 
-// Aligned matrix allocation for SIMD operations
-void* dm_matrix_alloc(dm_context_t *ctx, size_t rows, size_t cols, size_t elem_size) {
-    if (rows == 0 || cols == 0 || elem_size == 0) {
+// Scratch regions: a list of chunks bumped front to back. Every chunk
+// after the current one is unused, so rewinding to a mark is two stores and
+// the chunks are reused by the next region.
+#define DM_ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct dm_arena_chunk {
+    struct dm_arena_chunk *next;
+    size_t size;                    // Bytes available after the header
+} dm_arena_chunk_t;
+
+typedef union {
+    dm_arena_chunk_t chunk;
+    max_align_t align;
+} dm_arena_chunk_header_t;
+
+struct dm_arena {
+    dm_arena_chunk_t *first;
+    dm_arena_chunk_t *current;      // NULL until the first allocation of a region
+    size_t offset;                  // Bytes used in current
+};
+
+// Mark the start of a region
+dm_arena_mark_t dm_arena_begin(dm_context_t *ctx) {
+    dm_arena_mark_t mark = { NULL, 0 };
+    if (ctx != NULL && ctx->arena != NULL) {
+        mark.chunk = ctx->arena->current;
+        mark.offset = ctx->arena->offset;
+    }
+    
+    return mark;
+}
+
+// Allocate scratch memory in the innermost region
+void* dm_arena_alloc(dm_context_t *ctx, size_t size) {
+    if (ctx == NULL || size == 0 || size > SIZE_MAX - 2 * sizeof(dm_arena_chunk_header_t)) {
+        return NULL;
+    }
+    
+    if (ctx->arena == NULL) {
+        ctx->arena = dm_calloc(ctx, 1, sizeof(struct dm_arena));
+        if (ctx->arena == NULL) {
+            return NULL;
+        }
+    }
+    struct dm_arena *arena = ctx->arena;
+    
+    // Keep every block maximally aligned
+    size = (size + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t);
+    
+    if (arena->current == NULL || arena->offset + size > arena->current->size) {
+        // Move on to the next chunk, or put a new one before it if it is too small
+        dm_arena_chunk_t *next = arena->current != NULL ? arena->current->next : arena->first;
+        if (next == NULL || next->size < size) {
+            size_t chunk_size = size > DM_ARENA_CHUNK_SIZE ? size : DM_ARENA_CHUNK_SIZE;
+            dm_arena_chunk_header_t *header = dm_malloc(ctx, sizeof(dm_arena_chunk_header_t) + chunk_size);
+            if (header == NULL) {
+                return NULL;
+            }
+            header->chunk.size = chunk_size;
+            header->chunk.next = next;
+            if (arena->current != NULL) {
+                arena->current->next = &header->chunk;
+            } else {
+                arena->first = &header->chunk;
+            }
+            next = &header->chunk;
+        }
+        arena->current = next;
+        arena->offset = 0;
+    }
+    
+    void *ptr = (char*)((dm_arena_chunk_header_t*)arena->current + 1) + arena->offset;
+    arena->offset += size;
+    return ptr;
+}
+
+// Release everything allocated since the mark
+void dm_arena_end(dm_context_t *ctx, dm_arena_mark_t mark) {
+    if (ctx != NULL && ctx->arena != NULL) {
+        ctx->arena->current = mark.chunk;
+        ctx->arena->offset = mark.offset;
+    }
+}
+
+// Free the context's arena and its chunks
+void dm_arena_destroy(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->arena == NULL) {
+        return;
+    }
+    
+    dm_arena_chunk_t *chunk = ctx->arena->first;
+    while (chunk != NULL) {
+        dm_arena_chunk_t *next = chunk->next;
+        dm_free(ctx, chunk);
+        chunk = next;
+    }
+    
+    dm_free(ctx, ctx->arena);
+    ctx->arena = NULL;
+}
+
+// Allocate a reference-counted block
+void* dm_rc_alloc(dm_context_t *ctx, size_t size) {
+    if (size > SIZE_MAX - sizeof(dm_rc_header_t)) {
+        return NULL;
+    }
+    
+    dm_rc_header_t *header = dm_malloc(ctx, sizeof(dm_rc_header_t) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    
+    header->refcount = 1;
+    return header + 1;
+}
+
+// Resize a reference-counted block that has a single owner
+void* dm_rc_realloc(dm_context_t *ctx, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return dm_rc_alloc(ctx, size);
+    }
+    if (size > SIZE_MAX - sizeof(dm_rc_header_t)) {
+        return NULL;
+    }
+    
+    dm_rc_header_t *header = (dm_rc_header_t*)ptr - 1;
+    if (header->refcount != 1) {
+        return NULL;
+    }
+    
+    header = dm_realloc(ctx, header, sizeof(dm_rc_header_t) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    
+    return header + 1;
+}
+
+// Parallel regions running. While there are any, values may be shared
+// between threads and reference counts are updated atomically.
+static atomic_size_t shared_regions;
+
+void dm_rc_begin_shared(void) {
+    atomic_fetch_add(&shared_regions, 1);
+}
+
+void dm_rc_end_shared(void) {
+    atomic_fetch_sub(&shared_regions, 1);
+}
+
+// Add a reference to a count
+void dm_refcount_retain(size_t *count) {
+    if (atomic_load_explicit(&shared_regions, memory_order_relaxed) != 0) {
+        __atomic_fetch_add(count, 1, __ATOMIC_RELAXED);
+    } else {
+        (*count)++;
+    }
+}
+
+// Drop a reference from a count (never below zero); returns what is left
+size_t dm_refcount_release(size_t *count) {
+    if (atomic_load_explicit(&shared_regions, memory_order_relaxed) != 0) {
+        size_t current = __atomic_load_n(count, __ATOMIC_RELAXED);
+        while (current > 0 &&
+               !__atomic_compare_exchange_n(count, &current, current - 1, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        }
+        return current > 0 ? current - 1 : 0;
+    }
+    
+    if (*count > 0) {
+        (*count)--;
+    }
+    return *count;
+}
+
+// Add a reference to a block
+void dm_rc_retain(void *ptr) {
+    if (ptr != NULL) {
+        dm_refcount_retain(&((dm_rc_header_t*)ptr - 1)->refcount);
+    }
+}
+
+// Drop a reference; the caller frees the block when this returns 0
+size_t dm_rc_release(void *ptr) {
+    if (ptr == NULL) {
+        return 0;
+    }
+    
+    return dm_refcount_release(&((dm_rc_header_t*)ptr - 1)->refcount);
+}
+
+// Current number of references to a block
+size_t dm_rc_count(const void *ptr) {
+    if (ptr == NULL) {
+        return 0;
+    }
+    
+    return __atomic_load_n(&((const dm_rc_header_t*)ptr - 1)->refcount, __ATOMIC_RELAXED);
+}
+
+// Free a reference-counted block regardless of its count
+void dm_rc_free(dm_context_t *ctx, void *ptr) {
+    if (ptr != NULL) {
+        dm_free(ctx, (dm_rc_header_t*)ptr - 1);
+    }
+}
+
+// Matrix rows start on cache-line (and AVX-512) boundaries. Matrices of at
+// least DM_MATRIX_MMAP_SIZE bytes are mapped directly, aligned to huge pages
+// and advised to use them, so large scans take few TLB misses.
+#define DM_MATRIX_ALIGN 64
+#define DM_MATRIX_MMAP_SIZE (2 * 1024 * 1024)
+#define DM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Bookkeeping in front of a matrix's reference count
+typedef struct {
+    void *base;                     // Start of the allocation
+    size_t mapped;                  // Bytes mapped at base, or 0 if from dm_malloc
+} dm_matrix_info_t;
+
+// Room before the data for the bookkeeping and the reference count
+#define DM_MATRIX_HEADER_SIZE (sizeof(dm_matrix_info_t) + sizeof(dm_rc_header_t))
+
+static dm_matrix_info_t* matrix_info(void *matrix) {
+    return (dm_matrix_info_t*)((char*)matrix - DM_MATRIX_HEADER_SIZE);
+}
+
+// Map a zeroed region for size bytes of data starting one header block
+// past a huge page boundary
+static void* matrix_map(size_t size, void **base, size_t *mapped) {
+    size_t prefix = (DM_MATRIX_HEADER_SIZE + DM_MATRIX_ALIGN - 1) / DM_MATRIX_ALIGN * DM_MATRIX_ALIGN;
+    if (size > SIZE_MAX - prefix - 2 * DM_HUGE_PAGE_SIZE) {
+        return NULL;
+    }
+    size_t length = (prefix + size + DM_HUGE_PAGE_SIZE - 1) / DM_HUGE_PAGE_SIZE * DM_HUGE_PAGE_SIZE;
+    
+    // Map a huge page extra and trim it off around an aligned start
+    char *raw = mmap(NULL, length + DM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    char *start = (char*)(((uintptr_t)raw + DM_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(DM_HUGE_PAGE_SIZE - 1));
+    if (start > raw) {
+        munmap(raw, (size_t)(start - raw));
+    }
+    size_t tail = (size_t)(raw + length + DM_HUGE_PAGE_SIZE - (start + length));
+    if (tail > 0) {
+        munmap(start + length, tail);
+    }
+    
+#ifdef MADV_HUGEPAGE
+    madvise(start, length, MADV_HUGEPAGE);
+#endif
+    
+    *base = start;
+    *mapped = length;
+    return start + prefix;
+}
+
+// Allocate a zeroed, reference-counted matrix whose rows are stride bytes
+// apart (a multiple of DM_MATRIX_ALIGN)
+void* dm_matrix_alloc(dm_context_t *ctx, size_t rows, size_t cols, size_t elem_size, size_t *stride) {
+    if (rows == 0 || cols == 0 || elem_size == 0 || stride == NULL) {
         return NULL;
     }
     
     // Check for multiplication overflow
-    if (cols > SIZE_MAX / rows || 
-        elem_size > SIZE_MAX / (rows * cols)) {
+    if (elem_size > SIZE_MAX / cols || cols * elem_size > SIZE_MAX - DM_MATRIX_ALIGN) {
         return NULL;
     }
+    size_t row_size = (cols * elem_size + DM_MATRIX_ALIGN - 1) / DM_MATRIX_ALIGN * DM_MATRIX_ALIGN;
+    if (row_size > SIZE_MAX / rows) {
+        return NULL;
+    }
+    size_t size = rows * row_size;
     
-    size_t size = rows * cols * elem_size;
-    return dm_malloc(ctx, size);
+    void *base = NULL;
+    size_t mapped = 0;
+    char *data = NULL;
+    if (size >= DM_MATRIX_MMAP_SIZE) {
+        data = matrix_map(size, &base, &mapped);
+    }
+    if (data == NULL) {
+        // Small, or the mapping failed: over-allocate and align by hand
+        if (size > SIZE_MAX - DM_MATRIX_HEADER_SIZE - DM_MATRIX_ALIGN) {
+            return NULL;
+        }
+        base = dm_malloc(ctx, DM_MATRIX_HEADER_SIZE + DM_MATRIX_ALIGN + size);
+        if (base == NULL) {
+            return NULL;
+        }
+        uintptr_t first = (uintptr_t)base + DM_MATRIX_HEADER_SIZE;
+        data = (char*)((first + DM_MATRIX_ALIGN - 1) & ~(uintptr_t)(DM_MATRIX_ALIGN - 1));
+        mapped = 0;
+        memset(data, 0, size);
+    }
+    
+    dm_matrix_info_t *info = matrix_info(data);
+    info->base = base;
+    info->mapped = mapped;
+    ((dm_rc_header_t*)data - 1)->refcount = 1;
+    
+    *stride = row_size;
+    return data;
 }
 
-// Free matrix
+// Drop a reference to a matrix, freeing it with the last one
 void dm_matrix_free(dm_context_t *ctx, void *matrix) {
-    dm_free(ctx, matrix);
-} 
\ No newline at end of file
+    if (matrix == NULL || dm_rc_release(matrix) != 0) {
+        return;
+    }
+    
+    dm_matrix_info_t *info = matrix_info(matrix);
+    if (info->mapped > 0) {
+        munmap(info->base, info->mapped);
+    } else {
+        dm_free(ctx, info->base);
+    }
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/core/nanbox.h"
+#include "../../include/core/memory.h"
+
+#define DM_BOX_INT_MIN (-((int64_t)1 << 47))
+#define DM_BOX_INT_MAX (((int64_t)1 << 47) - 1)
+
+static dm_value_t* heap_box(dm_boxed_t boxed) {
+    return (dm_value_t*)(uintptr_t)(boxed & DM_BOX_PAYLOAD);
+}
+
+// Encode a value into one word
+dm_error_t dm_box_value(dm_context_t *ctx, const dm_value_t *value, dm_boxed_t *boxed) {
+    if (ctx == NULL || value == NULL || boxed == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    switch (value->type) {
+        case DM_TYPE_NULL:
+            *boxed = DM_BOX_MAKE(DM_BOX_NULL, 0);
+            return DM_SUCCESS;
+
+        case DM_TYPE_BOOLEAN:
+            *boxed = DM_BOX_MAKE(value->as.boolean ? DM_BOX_TRUE : DM_BOX_FALSE, 0);
+            return DM_SUCCESS;
+
+        case DM_TYPE_FLOAT:
+            *boxed = dm_box_number(value->as.floating);
+            return DM_SUCCESS;
+
+        case DM_TYPE_INTEGER:
+            if (value->as.integer >= DM_BOX_INT_MIN && value->as.integer <= DM_BOX_INT_MAX) {
+                *boxed = DM_BOX_MAKE(DM_BOX_INTEGER, (uint64_t)value->as.integer);
+                return DM_SUCCESS;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    // Everything else keeps its full representation in a shared heap box
+    dm_value_t *box = dm_rc_alloc(ctx, sizeof(dm_value_t));
+    if (box == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    if (((uintptr_t)box & ~(uintptr_t)DM_BOX_PAYLOAD) != 0) {
+        dm_rc_free(ctx, box);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    dm_value_init(box);
+    dm_value_copy(ctx, box, value);
+    *boxed = DM_BOX_MAKE(DM_BOX_HEAP, (uintptr_t)box);
+    return DM_SUCCESS;
+}
+
+// Decode a word into a full value
+void dm_unbox_value(dm_context_t *ctx, dm_boxed_t boxed, dm_value_t *dest) {
+    if (ctx == NULL || dest == NULL) {
+        return;
+    }
+
+    if (dm_boxed_is_number(boxed)) {
+        dm_value_free(ctx, dest);
+        dest->type = DM_TYPE_FLOAT;
+        dest->as.floating = dm_boxed_as_number(boxed);
+        return;
+    }
+
+    switch (DM_BOX_TAG(boxed)) {
+        case DM_BOX_FALSE:
+        case DM_BOX_TRUE:
+            dm_value_free(ctx, dest);
+            dest->type = DM_TYPE_BOOLEAN;
+            dest->as.boolean = DM_BOX_TAG(boxed) == DM_BOX_TRUE;
+            break;
+
+        case DM_BOX_INTEGER: {
+            // Sign-extend the 48-bit payload
+            int64_t integer = (int64_t)((boxed & DM_BOX_PAYLOAD) << 16) >> 16;
+            dm_value_free(ctx, dest);
+            dest->type = DM_TYPE_INTEGER;
+            dest->as.integer = integer;
+            break;
+        }
+
+        case DM_BOX_HEAP:
+            dm_value_copy(ctx, dest, heap_box(boxed));
+            break;
+
+        default:
+            dm_value_free(ctx, dest);
+            break;
+    }
+}
+
+// Type of the value a word holds
+dm_value_type_t dm_boxed_type(dm_boxed_t boxed) {
+    if (dm_boxed_is_number(boxed)) {
+        return DM_TYPE_FLOAT;
+    }
+
+    switch (DM_BOX_TAG(boxed)) {
+        case DM_BOX_FALSE:
+        case DM_BOX_TRUE:
+            return DM_TYPE_BOOLEAN;
+        case DM_BOX_INTEGER:
+            return DM_TYPE_INTEGER;
+        case DM_BOX_HEAP:
+            return heap_box(boxed)->type;
+        default:
+            return DM_TYPE_NULL;
+    }
+}
+
+void dm_boxed_retain(dm_boxed_t boxed) {
+    if (!dm_boxed_is_number(boxed) && DM_BOX_TAG(boxed) == DM_BOX_HEAP) {
+        dm_rc_retain(heap_box(boxed));
+    }
+}
+
+// Drop one owner of a word; heap boxes are freed with their last owner
+void dm_boxed_free(dm_context_t *ctx, dm_boxed_t boxed) {
+    if (dm_boxed_is_number(boxed) || DM_BOX_TAG(boxed) != DM_BOX_HEAP) {
+        return;
+    }
+
+    dm_value_t *box = heap_box(boxed);
+    if (dm_rc_release(box) == 0) {
+        dm_value_free(ctx, box);
+        dm_rc_free(ctx, box);
+    }
+}
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include "../../include/core/threadpool.h"
+#include "../../include/core/memory.h"
+
+// Indices left to a worker. The owner takes from the front, thieves from
+// the back, both under the lock.
+typedef struct {
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+    char pad[64];               // Keep shares of different workers off one cache line
+} dm_work_share_t;
+
+struct dm_thread_pool {
+    pthread_t *threads;         // Helper threads; the caller is worker 0
+    size_t worker_count;
+    dm_work_share_t *shares;    // One per worker
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;       // A new range was posted (or shutdown)
+    pthread_cond_t done;        // The last helper finished the range
+    size_t generation;          // Bumped for every posted range
+    size_t busy;                // Helpers still working on the range
+    bool shutdown;
+
+    // The range being run
+    dm_range_fn fn;
+    void *arg;
+    size_t grain;               // Indices a worker takes from its share at a time
+    atomic_bool stop;
+};
+
+typedef struct {
+    dm_thread_pool_t *pool;
+    size_t worker;
+} dm_pool_thread_t;
+
+// Take the next batch of the worker's own share
+static bool claim(dm_thread_pool_t *pool, size_t worker, size_t *begin, size_t *end) {
+    dm_work_share_t *share = &pool->shares[worker];
+    pthread_mutex_lock(&share->lock);
+    bool found = share->begin < share->end;
+    if (found) {
+        size_t take = share->end - share->begin;
+        if (take > pool->grain) {
+            take = pool->grain;
+        }
+        *begin = share->begin;
+        *end = share->begin + take;
+        share->begin += take;
+    }
+    pthread_mutex_unlock(&share->lock);
+    return found;
+}
+
+// Move the back half of another worker's share into the worker's own
+static bool steal(dm_thread_pool_t *pool, size_t worker) {
+    for (size_t i = 1; i < pool->worker_count; i++) {
+        dm_work_share_t *victim = &pool->shares[(worker + i) % pool->worker_count];
+
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->begin;
+        size_t from = victim->end - left / 2;
+        size_t to = victim->end;
+        if (left >= 2) {
+            victim->end = from;
+        } else if (left == 1) {
+            // A single index moves as a whole
+            from = victim->begin;
+            victim->end = from;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (left > 0) {
+            dm_work_share_t *own = &pool->shares[worker];
+            pthread_mutex_lock(&own->lock);
+            own->begin = from;
+            own->end = to;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Run batches until no share has work left or the range is stopped
+static void work(dm_thread_pool_t *pool, size_t worker) {
+    while (!atomic_load_explicit(&pool->stop, memory_order_relaxed)) {
+        size_t begin = 0;
+        size_t end = 0;
+        if (!claim(pool, worker, &begin, &end)) {
+            if (!steal(pool, worker)) {
+                break;
+            }
+            continue;
+        }
+
+        if (!pool->fn(pool->arg, worker, begin, end)) {
+            atomic_store(&pool->stop, true);
+        }
+    }
+}
+
+static void* helper_main(void *arg) {
+    dm_pool_thread_t *self = arg;
+    dm_thread_pool_t *pool = self->pool;
+    size_t worker = self->worker;
+    free(self);
+
+    size_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// Stop and join the first count helpers
+static void stop_helpers(dm_thread_pool_t *pool, size_t count) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+}
+
+dm_error_t dm_thread_pool_create(dm_context_t *ctx, size_t threads, dm_thread_pool_t **pool) {
+    if (ctx == NULL || pool == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    dm_thread_pool_t *p = dm_calloc(ctx, 1, sizeof(dm_thread_pool_t));
+    if (p == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    p->worker_count = threads;
+    p->shares = dm_calloc(ctx, threads, sizeof(dm_work_share_t));
+    if (threads > 1) {
+        p->threads = dm_calloc(ctx, threads - 1, sizeof(pthread_t));
+    }
+    if (p->shares == NULL || (threads > 1 && p->threads == NULL)) {
+        dm_free(ctx, p->shares);
+        dm_free(ctx, p->threads);
+        dm_free(ctx, p);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        pthread_mutex_init(&p->shares[i].lock, NULL);
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+    atomic_init(&p->stop, false);
+
+    // Helpers must not take signals meant for the interpreter thread
+    sigset_t blocked, previous;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+
+    dm_error_t err = DM_SUCCESS;
+    size_t started = 0;
+    for (; started + 1 < threads; started++) {
+        dm_pool_thread_t *self = malloc(sizeof(dm_pool_thread_t));
+        if (self == NULL) {
+            err = DM_ERROR_MEMORY_ALLOCATION;
+            break;
+        }
+        self->pool = p;
+        self->worker = started + 1;
+        if (pthread_create(&p->threads[started], NULL, helper_main, self) != 0) {
+            free(self);
+            err = DM_ERROR_BUSY;
+            break;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (err != DM_SUCCESS) {
+        stop_helpers(p, started);
+        dm_free(ctx, p->threads);
+        p->threads = NULL;
+        dm_thread_pool_destroy(ctx, p);
+        return err;
+    }
+
+    *pool = p;
+    return DM_SUCCESS;
+}
+
+void dm_thread_pool_destroy(dm_context_t *ctx, dm_thread_pool_t *pool) {
+    if (ctx == NULL || pool == NULL) {
+        return;
+    }
+
+    if (pool->threads != NULL) {
+        stop_helpers(pool, pool->worker_count - 1);
+        dm_free(ctx, pool->threads);
+    }
+
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        pthread_mutex_destroy(&pool->shares[i].lock);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+
+    dm_free(ctx, pool->shares);
+    dm_free(ctx, pool);
+}
+
+size_t dm_thread_pool_size(const dm_thread_pool_t *pool) {
+    return pool != NULL ? pool->worker_count : 1;
+}
+
+void dm_thread_pool_for(dm_thread_pool_t *pool, size_t count, dm_range_fn fn, void *arg) {
+    if (pool == NULL || fn == NULL || count == 0) {
+        return;
+    }
+
+    size_t workers = pool->worker_count;
+    if (workers == 1 || count == 1) {
+        fn(arg, 0, 0, count);
+        return;
+    }
+
+    // Even shares up front; batches small enough that stealing can balance
+    // uneven iterations
+    for (size_t i = 0; i < workers; i++) {
+        pool->shares[i].begin = count / workers * i + (i < count % workers ? i : count % workers);
+        pool->shares[i].end = pool->shares[i].begin + count / workers + (i < count % workers ? 1 : 0);
+    }
+    pool->grain = count / (workers * 16);
+    if (pool->grain == 0) {
+        pool->grain = 1;
+    }
+    pool->fn = fn;
+    pool->arg = arg;
+    atomic_store(&pool->stop, false);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pool->busy = workers - 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/bytecode.h"
+
+// Constant tags in the serialized constant pool
+#define DM_BC_TAG_NULL    0
+#define DM_BC_TAG_BOOLEAN 1
+#define DM_BC_TAG_NUMBER  2
+#define DM_BC_TAG_STRING  3
+#define DM_BC_TAG_INTEGER 4
+
+// Create an empty module
+dm_error_t dm_bc_module_create(dm_context_t *ctx, dm_bc_module_t **module) {
+    if (ctx == NULL || module == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    *module = dm_malloc(ctx, sizeof(dm_bc_module_t));
+    if (*module == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(*module, 0, sizeof(dm_bc_module_t));
+    return DM_SUCCESS;
+}
+
+// Free a single function
+static void free_function(dm_context_t *ctx, dm_bc_function_t *function) {
+    if (function == NULL) {
+        return;
+    }
+
+    dm_free(ctx, function->params);
+    dm_free(ctx, function->code);
+    dm_free(ctx, function->threaded);
+    dm_free(ctx, function);
+}
+
+// Free a module and everything it owns
+void dm_bc_module_free(dm_context_t *ctx, dm_bc_module_t *module) {
+    if (ctx == NULL || module == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < module->constant_count; i++) {
+        dm_value_free(ctx, &module->constants[i]);
+    }
+    dm_free(ctx, module->constants);
+
+    for (size_t i = 0; i < module->function_count; i++) {
+        free_function(ctx, module->functions[i]);
+    }
+    dm_free(ctx, module->functions);
+    dm_free(ctx, module->names);
+
+    dm_free(ctx, module);
+}
+
+// Check whether two constants are interchangeable
+static bool constants_equal(const dm_value_t *a, const dm_value_t *b) {
+    if (a->type != b->type) {
+        return false;
+    }
+
+    switch (a->type) {
+        case DM_TYPE_NULL:
+            return true;
+        case DM_TYPE_BOOLEAN:
+            return a->as.boolean == b->as.boolean;
+        case DM_TYPE_INTEGER:
+            return a->as.integer == b->as.integer;
+        case DM_TYPE_FLOAT:
+            // Compare bit patterns so that -0.0 and NaN constants stay distinct
+            return memcmp(&a->as.floating, &b->as.floating, sizeof(double)) == 0;
+        case DM_TYPE_STRING:
+            return a->as.string.length == b->as.string.length &&
+                   memcmp(a->as.string.data, b->as.string.data, a->as.string.length) == 0;
+        default:
+            return false;
+    }
+}
+
+// Add a constant to the pool
+dm_error_t dm_bc_add_constant(dm_context_t *ctx, dm_bc_module_t *module, const dm_value_t *value, uint16_t *index) {
+    if (ctx == NULL || module == NULL || value == NULL || index == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Reuse an existing entry if possible
+    for (size_t i = 0; i < module->constant_count; i++) {
+        if (constants_equal(&module->constants[i], value)) {
+            *index = (uint16_t)i;
+            return DM_SUCCESS;
+        }
+    }
+
+    // The index must fit an operand and must not collide with DM_BC_NO_NAME
+    if (module->constant_count >= DM_BC_NO_NAME) {
+        return DM_ERROR_BUFFER_OVERFLOW;
+    }
+
+    // Grow the pool if needed
+    if (module->constant_count >= module->constant_capacity) {
+        size_t new_capacity = module->constant_capacity == 0 ? 16 : module->constant_capacity * 2;
+        dm_value_t *new_constants = dm_realloc(ctx, module->constants, new_capacity * sizeof(dm_value_t));
+        if (new_constants == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        module->constants = new_constants;
+        module->constant_capacity = new_capacity;
+    }
+
+    dm_value_t *slot = &module->constants[module->constant_count];
+    dm_value_init(slot);
+    dm_value_copy(ctx, slot, value);
+
+    *index = (uint16_t)module->constant_count++;
+    return DM_SUCCESS;
+}
+
+// Add an empty function to the module
+dm_error_t dm_bc_add_function(dm_context_t *ctx, dm_bc_module_t *module, dm_bc_function_t **function, uint16_t *index) {
+    if (ctx == NULL || module == NULL || function == NULL || index == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (module->function_count >= UINT16_MAX) {
+        return DM_ERROR_BUFFER_OVERFLOW;
+    }
+
+    // Grow the function table if needed
+    if (module->function_count >= module->function_capacity) {
+        size_t new_capacity = module->function_capacity == 0 ? 4 : module->function_capacity * 2;
+        dm_bc_function_t **new_functions = dm_realloc(ctx, module->functions,
+                                                     new_capacity * sizeof(dm_bc_function_t*));
+        if (new_functions == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        module->functions = new_functions;
+        module->function_capacity = new_capacity;
+    }
+
+    dm_bc_function_t *fn = dm_malloc(ctx, sizeof(dm_bc_function_t));
+    if (fn == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(fn, 0, sizeof(dm_bc_function_t));
+    fn->name = DM_BC_NO_NAME;
+    fn->module = module;
+
+    module->functions[module->function_count] = fn;
+    *index = (uint16_t)module->function_count++;
+    *function = fn;
+
+    return DM_SUCCESS;
+}
+
+// Size of an instruction including operands
+size_t dm_bc_instruction_size(uint8_t opcode) {
+    switch (opcode) {
+        case DM_BC_CONST:
+        case DM_BC_GET:
+        case DM_BC_SET:
+        case DM_BC_DEFINE:
+        case DM_BC_FUNCTION:
+        case DM_BC_ENTER_SCOPE:
+            return 3;
+
+        case DM_BC_CALL:
+        case DM_BC_CALL_VALUE:
+        case DM_BC_CONCAT:
+            return 4;
+
+        case DM_BC_JUMP:
+        case DM_BC_JUMP_IF_FALSE:
+        case DM_BC_GET_LOCAL:
+        case DM_BC_SET_LOCAL:
+            return 5;
+
+        case DM_BC_CONCAT_LOCAL:
+            return 6;
+
+        default:
+            return opcode < DM_BC_OPCODE_COUNT ? 1 : 0;
+    }
+}
+
+// Check for the bytecode magic
+bool dm_bc_is_bytecode(const void *data, size_t length) {
+    return data != NULL && length >= DM_BC_MAGIC_SIZE &&
+           memcmp(data, DM_BC_MAGIC, DM_BC_MAGIC_SIZE) == 0;
+}
+
+// Growable output buffer used by the serializer
+typedef struct {
+    dm_context_t *ctx;
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} bc_writer_t;
+
+static void write_bytes(bc_writer_t *w, const void *bytes, size_t count) {
+    if (w->failed) {
+        return;
+    }
+
+    if (w->length + count > w->capacity) {
+        size_t new_capacity = w->capacity == 0 ? 256 : w->capacity;
+        while (new_capacity < w->length + count) {
+            new_capacity *= 2;
+        }
+
+        uint8_t *new_data = dm_realloc(w->ctx, w->data, new_capacity);
+        if (new_data == NULL) {
+            w->failed = true;
+            return;
+        }
+        w->data = new_data;
+        w->capacity = new_capacity;
+    }
+
+    memcpy(w->data + w->length, bytes, count);
+    w->length += count;
+}
+
+static void write_u8(bc_writer_t *w, uint8_t value) {
+    write_bytes(w, &value, 1);
+}
+
+static void write_u16(bc_writer_t *w, uint16_t value) {
+    uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    write_bytes(w, bytes, 2);
+}
+
+static void write_u32(bc_writer_t *w, uint32_t value) {
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+    write_bytes(w, bytes, 4);
+}
+
+static void write_u64(bc_writer_t *w, uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+    write_bytes(w, bytes, 8);
+}
+
+// Serialize a module
+dm_error_t dm_bc_serialize(dm_context_t *ctx, const dm_bc_module_t *module, uint8_t **data, size_t *length) {
+    if (ctx == NULL || module == NULL || data == NULL || length == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    bc_writer_t w = { ctx, NULL, 0, 0, false };
+
+    // Header
+    write_bytes(&w, DM_BC_MAGIC, DM_BC_MAGIC_SIZE);
+    write_u16(&w, DM_BC_VERSION);
+
+    // Constant pool
+    write_u32(&w, (uint32_t)module->constant_count);
+    for (size_t i = 0; i < module->constant_count; i++) {
+        const dm_value_t *constant = &module->constants[i];
+
+        switch (constant->type) {
+            case DM_TYPE_NULL:
+                write_u8(&w, DM_BC_TAG_NULL);
+                break;
+
+            case DM_TYPE_BOOLEAN:
+                write_u8(&w, DM_BC_TAG_BOOLEAN);
+                write_u8(&w, constant->as.boolean ? 1 : 0);
+                break;
+
+            case DM_TYPE_INTEGER:
+                write_u8(&w, DM_BC_TAG_INTEGER);
+                write_u64(&w, (uint64_t)constant->as.integer);
+                break;
+
+            case DM_TYPE_FLOAT: {
+                uint64_t bits;
+                memcpy(&bits, &constant->as.floating, sizeof(bits));
+                write_u8(&w, DM_BC_TAG_NUMBER);
+                write_u64(&w, bits);
+                break;
+            }
+
+            case DM_TYPE_STRING:
+                write_u8(&w, DM_BC_TAG_STRING);
+                write_u32(&w, (uint32_t)constant->as.string.length);
+                write_bytes(&w, constant->as.string.data, constant->as.string.length);
+                break;
+
+            default:
+                dm_free(ctx, w.data);
+                return DM_ERROR_NOT_SUPPORTED;
+        }
+    }
+
+    // Functions
+    write_u32(&w, (uint32_t)module->function_count);
+    for (size_t i = 0; i < module->function_count; i++) {
+        const dm_bc_function_t *fn = module->functions[i];
+
+        write_u16(&w, fn->name);
+        write_u16(&w, (uint16_t)fn->param_count);
+        for (size_t p = 0; p < fn->param_count; p++) {
+            write_u16(&w, fn->params[p]);
+        }
+        write_u8(&w, fn->named_params ? 1 : 0);
+        write_u32(&w, (uint32_t)fn->code_length);
+        write_bytes(&w, fn->code, fn->code_length);
+    }
+
+    if (w.failed) {
+        dm_free(ctx, w.data);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    *data = w.data;
+    *length = w.length;
+    return DM_SUCCESS;
+}
+
+// Bounds-checked input cursor used by the loader
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+    bool failed;
+} bc_reader_t;
+
+static const uint8_t* read_bytes(bc_reader_t *r, size_t count) {
+    if (r->failed || count > r->length - r->position) {
+        r->failed = true;
+        return NULL;
+    }
+
+    const uint8_t *bytes = r->data + r->position;
+    r->position += count;
+    return bytes;
+}
+
+static uint64_t read_uint(bc_reader_t *r, size_t count) {
+    const uint8_t *bytes = read_bytes(r, count);
+    if (bytes == NULL) {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < count; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+// Verify that every operand of a function refers to something that exists
+static bool verify_function(const dm_bc_module_t *module, const dm_bc_function_t *fn) {
+    if (fn->name != DM_BC_NO_NAME && fn->name >= module->constant_count) {
+        return false;
+    }
+
+    for (size_t p = 0; p < fn->param_count; p++) {
+        if (fn->params[p] >= module->constant_count) {
+            return false;
+        }
+    }
+
+    // First pass: mark instruction boundaries
+    bool *starts = calloc(fn->code_length + 1, sizeof(bool));
+    if (starts == NULL) {
+        return false;
+    }
+
+    bool valid = true;
+    size_t pc = 0;
+    while (pc < fn->code_length) {
+        size_t size = dm_bc_instruction_size(fn->code[pc]);
+        if (size == 0 || size > fn->code_length - pc) {
+            valid = false;
+            break;
+        }
+        starts[pc] = true;
+        pc += size;
+    }
+
+    // Second pass: check operands
+    for (pc = 0; valid && pc < fn->code_length; pc += dm_bc_instruction_size(fn->code[pc])) {
+        const uint8_t *operand = fn->code + pc + 1;
+
+        switch (fn->code[pc]) {
+            case DM_BC_CONST:
+            case DM_BC_GET:
+            case DM_BC_SET:
+            case DM_BC_DEFINE:
+            case DM_BC_CALL:
+            case DM_BC_CALL_VALUE:
+            case DM_BC_CONCAT: {
+                uint16_t index = (uint16_t)(operand[0] | (operand[1] << 8));
+                valid = index < module->constant_count &&
+                        (fn->code[pc] == DM_BC_CONST || module->constants[index].type == DM_TYPE_STRING);
+                break;
+            }
+
+            case DM_BC_FUNCTION: {
+                uint16_t index = (uint16_t)(operand[0] | (operand[1] << 8));
+                valid = index > 0 && index < module->function_count &&
+                        module->functions[index]->name != DM_BC_NO_NAME;
+                break;
+            }
+
+            case DM_BC_JUMP:
+            case DM_BC_JUMP_IF_FALSE: {
+                uint32_t target = (uint32_t)operand[0] | ((uint32_t)operand[1] << 8) |
+                                  ((uint32_t)operand[2] << 16) | ((uint32_t)operand[3] << 24);
+                valid = target < fn->code_length && starts[target];
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    // Execution must never run off the end of the code
+    if (valid) {
+        valid = fn->code_length > 0;
+        if (valid) {
+            // Find the last instruction
+            size_t last = 0;
+            for (pc = 0; pc < fn->code_length; pc += dm_bc_instruction_size(fn->code[pc])) {
+                last = pc;
+            }
+            valid = fn->code[last] == DM_BC_RETURN || fn->code[last] == DM_BC_HALT ||
+                    fn->code[last] == DM_BC_JUMP;
+        }
+    }
+
+    free(starts);
+    return valid;
+}
+
+// Load a module
+dm_error_t dm_bc_deserialize(dm_context_t *ctx, const uint8_t *data, size_t length, dm_bc_module_t **module) {
+    if (ctx == NULL || data == NULL || module == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (!dm_bc_is_bytecode(data, length)) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Not a bytecode file");
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    bc_reader_t r = { data, length, DM_BC_MAGIC_SIZE, false };
+
+    uint16_t version = (uint16_t)read_uint(&r, 2);
+    if (r.failed || version != DM_BC_VERSION) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                "Unsupported bytecode version %u (expected %u)", version, DM_BC_VERSION);
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    dm_bc_module_t *mod = NULL;
+    dm_error_t err = dm_bc_module_create(ctx, &mod);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    // Constant pool
+    uint32_t constant_count = (uint32_t)read_uint(&r, 4);
+    if (constant_count >= DM_BC_NO_NAME) {
+        r.failed = true;
+    }
+
+    for (uint32_t i = 0; i < constant_count && !r.failed; i++) {
+        dm_value_t constant;
+        dm_value_init(&constant);
+
+        uint8_t tag = (uint8_t)read_uint(&r, 1);
+        switch (tag) {
+            case DM_BC_TAG_NULL:
+                break;
+
+            case DM_BC_TAG_BOOLEAN:
+                constant.type = DM_TYPE_BOOLEAN;
+                constant.as.boolean = read_uint(&r, 1) != 0;
+                break;
+
+            case DM_BC_TAG_NUMBER: {
+                uint64_t bits = read_uint(&r, 8);
+                constant.type = DM_TYPE_FLOAT;
+                memcpy(&constant.as.floating, &bits, sizeof(bits));
+                break;
+            }
+
+            case DM_BC_TAG_INTEGER:
+                constant.type = DM_TYPE_INTEGER;
+                constant.as.integer = (int64_t)read_uint(&r, 8);
+                break;
+
+            case DM_BC_TAG_STRING: {
+                uint32_t string_length = (uint32_t)read_uint(&r, 4);
+                const uint8_t *bytes = read_bytes(&r, string_length);
+                if (bytes == NULL) {
+                    break;
+                }
+
+                err = dm_value_set_string(ctx, &constant, (const char*)bytes, string_length);
+                if (err != DM_SUCCESS) {
+                    r.failed = true;
+                }
+                break;
+            }
+
+            default:
+                r.failed = true;
+                break;
+        }
+
+        if (r.failed) {
+            dm_value_free(ctx, &constant);
+            break;
+        }
+
+        // Append directly: the pool must keep the serialized indices
+        if (mod->constant_count >= mod->constant_capacity) {
+            size_t new_capacity = mod->constant_capacity == 0 ? 16 : mod->constant_capacity * 2;
+            dm_value_t *new_constants = dm_realloc(ctx, mod->constants, new_capacity * sizeof(dm_value_t));
+            if (new_constants == NULL) {
+                dm_value_free(ctx, &constant);
+                err = DM_ERROR_MEMORY_ALLOCATION;
+                r.failed = true;
+                break;
+            }
+            mod->constants = new_constants;
+            mod->constant_capacity = new_capacity;
+        }
+        mod->constants[mod->constant_count++] = constant;
+    }
+
+    // Functions
+    uint32_t function_count = r.failed ? 0 : (uint32_t)read_uint(&r, 4);
+    if (!r.failed && (function_count == 0 || function_count > UINT16_MAX)) {
+        r.failed = true;
+    }
+
+    for (uint32_t i = 0; i < function_count && !r.failed; i++) {
+        dm_bc_function_t *fn = NULL;
+        uint16_t index = 0;
+        err = dm_bc_add_function(ctx, mod, &fn, &index);
+        if (err != DM_SUCCESS) {
+            r.failed = true;
+            break;
+        }
+
+        fn->name = (uint16_t)read_uint(&r, 2);
+        fn->param_count = (size_t)read_uint(&r, 2);
+        if (!r.failed && fn->param_count > 0) {
+            fn->params = dm_malloc(ctx, fn->param_count * sizeof(uint16_t));
+            if (fn->params == NULL) {
+                err = DM_ERROR_MEMORY_ALLOCATION;
+                r.failed = true;
+                break;
+            }
+            for (size_t p = 0; p < fn->param_count; p++) {
+                fn->params[p] = (uint16_t)read_uint(&r, 2);
+            }
+        }
+        fn->named_params = read_uint(&r, 1) != 0;
+
+        uint32_t code_length = (uint32_t)read_uint(&r, 4);
+        const uint8_t *code = read_bytes(&r, code_length);
+        if (code == NULL || code_length == 0) {
+            r.failed = true;
+            break;
+        }
+
+        fn->code = dm_malloc(ctx, code_length);
+        if (fn->code == NULL) {
+            err = DM_ERROR_MEMORY_ALLOCATION;
+            r.failed = true;
+            break;
+        }
+        memcpy(fn->code, code, code_length);
+        fn->code_length = code_length;
+        fn->code_capacity = code_length;
+    }
+
+    // Verify all functions once the whole module is known
+    for (size_t i = 0; !r.failed && i < mod->function_count; i++) {
+        if (!verify_function(mod, mod->functions[i])) {
+            r.failed = true;
+        }
+    }
+
+    if (r.failed) {
+        dm_bc_module_free(ctx, mod);
+        if (err == DM_SUCCESS) {
+            snprintf(ctx->error_message, sizeof(ctx->error_message), "Malformed bytecode file");
+            err = DM_ERROR_SYNTAX_ERROR;
+        }
+        return err;
+    }
+
+    *module = mod;
+    return DM_SUCCESS;
+}
@@ -0,0 +1,665 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/bytecode.h"
+#include "../../include/lang/exec.h"
+#include "../../include/lang/optimizer.h"
+#include "../../include/lang/resolver.h"
+
+// Compiler state
+typedef struct {
+    dm_context_t *ctx;
+    dm_bc_module_t *module;
+    dm_bc_function_t *function;  // Function currently receiving code
+} dm_compiler_t;
+
+static dm_error_t compile_node(dm_compiler_t *c, dm_node_t *node);
+
+// Append raw bytes to the current function
+static dm_error_t emit_bytes(dm_compiler_t *c, const uint8_t *bytes, size_t count) {
+    dm_bc_function_t *fn = c->function;
+
+    if (fn->code_length + count > UINT32_MAX) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Function too large to compile");
+        return DM_ERROR_BUFFER_OVERFLOW;
+    }
+
+    if (fn->code_length + count > fn->code_capacity) {
+        size_t new_capacity = fn->code_capacity == 0 ? 64 : fn->code_capacity * 2;
+        while (new_capacity < fn->code_length + count) {
+            new_capacity *= 2;
+        }
+
+        uint8_t *new_code = dm_realloc(c->ctx, fn->code, new_capacity);
+        if (new_code == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        fn->code = new_code;
+        fn->code_capacity = new_capacity;
+    }
+
+    memcpy(fn->code + fn->code_length, bytes, count);
+    fn->code_length += count;
+    return DM_SUCCESS;
+}
+
+static dm_error_t emit_op(dm_compiler_t *c, dm_opcode_t op) {
+    uint8_t byte = (uint8_t)op;
+    return emit_bytes(c, &byte, 1);
+}
+
+static dm_error_t emit_op_u16(dm_compiler_t *c, dm_opcode_t op, uint16_t operand) {
+    uint8_t bytes[3] = { (uint8_t)op, (uint8_t)operand, (uint8_t)(operand >> 8) };
+    return emit_bytes(c, bytes, sizeof(bytes));
+}
+
+// Emit a jump with a placeholder target and return the operand offset for patching
+static dm_error_t emit_jump(dm_compiler_t *c, dm_opcode_t op, size_t *patch) {
+    uint8_t bytes[5] = { (uint8_t)op, 0, 0, 0, 0 };
+    *patch = c->function->code_length + 1;
+    return emit_bytes(c, bytes, sizeof(bytes));
+}
+
+static void patch_jump(dm_compiler_t *c, size_t patch, size_t target) {
+    for (int i = 0; i < 4; i++) {
+        c->function->code[patch + i] = (uint8_t)(target >> (8 * i));
+    }
+}
+
+static dm_error_t emit_jump_to(dm_compiler_t *c, dm_opcode_t op, size_t target) {
+    size_t patch = 0;
+    dm_error_t err = emit_jump(c, op, &patch);
+    if (err == DM_SUCCESS) {
+        patch_jump(c, patch, target);
+    }
+    return err;
+}
+
+// Add a string constant (names and string literals)
+static dm_error_t string_constant(dm_compiler_t *c, const char *text, uint16_t *index) {
+    dm_value_t value;
+    dm_value_init(&value);
+    dm_error_t err = dm_value_set_string(c->ctx, &value, text, strlen(text));
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    // The pool takes its own reference
+    err = dm_bc_add_constant(c->ctx, c->module, &value, index);
+    dm_value_free(c->ctx, &value);
+    if (err == DM_ERROR_BUFFER_OVERFLOW) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Too many constants in one module");
+    }
+    return err;
+}
+
+static dm_error_t compile_literal(dm_compiler_t *c, dm_node_t *node) {
+    switch (node->literal.type) {
+        case DM_LITERAL_NULL:
+            return emit_op(c, DM_BC_NULL);
+
+        case DM_LITERAL_BOOLEAN:
+            return emit_op(c, node->literal.value.boolean ? DM_BC_TRUE : DM_BC_FALSE);
+
+        case DM_LITERAL_NUMBER: {
+            dm_value_t value;
+            dm_value_init(&value);
+            value.type = DM_TYPE_FLOAT;
+            value.as.floating = node->literal.value.number;
+
+            uint16_t index = 0;
+            dm_error_t err = dm_bc_add_constant(c->ctx, c->module, &value, &index);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return emit_op_u16(c, DM_BC_CONST, index);
+        }
+
+        case DM_LITERAL_INTEGER: {
+            dm_value_t value;
+            dm_value_init(&value);
+            value.type = DM_TYPE_INTEGER;
+            value.as.integer = node->literal.value.integer;
+
+            uint16_t index = 0;
+            dm_error_t err = dm_bc_add_constant(c->ctx, c->module, &value, &index);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return emit_op_u16(c, DM_BC_CONST, index);
+        }
+
+        case DM_LITERAL_STRING: {
+            uint16_t index = 0;
+            dm_error_t err = string_constant(c, node->literal.value.string, &index);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return emit_op_u16(c, DM_BC_CONST, index);
+        }
+
+        default:
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+static dm_error_t compile_binary(dm_compiler_t *c, dm_node_t *node) {
+    static const dm_opcode_t opcodes[] = {
+        [DM_OP_ADD] = DM_BC_ADD, [DM_OP_SUB] = DM_BC_SUB, [DM_OP_MUL] = DM_BC_MUL,
+        [DM_OP_DIV] = DM_BC_DIV, [DM_OP_MOD] = DM_BC_MOD,
+        [DM_OP_EQ] = DM_BC_EQ, [DM_OP_NEQ] = DM_BC_NEQ,
+        [DM_OP_LT] = DM_BC_LT, [DM_OP_GT] = DM_BC_GT,
+        [DM_OP_LTE] = DM_BC_LTE, [DM_OP_GTE] = DM_BC_GTE,
+        [DM_OP_AND] = DM_BC_AND, [DM_OP_OR] = DM_BC_OR
+    };
+
+    if (node->binary.op > DM_OP_OR) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message),
+                "Unsupported binary operator: %d", node->binary.op);
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Both operands are always evaluated, matching the tree-walking evaluator
+    dm_error_t err = compile_node(c, node->binary.left);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = compile_node(c, node->binary.right);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    return emit_op(c, opcodes[node->binary.op]);
+}
+
+static dm_error_t compile_unary(dm_compiler_t *c, dm_node_t *node) {
+    dm_error_t err = compile_node(c, node->unary.operand);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    switch (node->unary.op) {
+        case DM_OP_NEG:
+            return emit_op(c, DM_BC_NEG);
+        case DM_OP_NOT:
+            return emit_op(c, DM_BC_NOT);
+        default:
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+// Named operand instructions (GET, SET, DEFINE)
+static dm_error_t emit_named(dm_compiler_t *c, dm_opcode_t op, const char *name) {
+    uint16_t index = 0;
+    dm_error_t err = string_constant(c, name, &index);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    return emit_op_u16(c, op, index);
+}
+
+// Resolved local instructions (GET_LOCAL, SET_LOCAL)
+static dm_error_t emit_local(dm_compiler_t *c, dm_opcode_t op, const dm_local_ref_t *local) {
+    if (local->depth > UINT16_MAX || local->slot > UINT16_MAX) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Too many nested locals to compile");
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    uint8_t bytes[5] = {
+        (uint8_t)op,
+        (uint8_t)local->depth, (uint8_t)(local->depth >> 8),
+        (uint8_t)local->slot, (uint8_t)(local->slot >> 8)
+    };
+    return emit_bytes(c, bytes, sizeof(bytes));
+}
+
+static dm_error_t compile_variable(dm_compiler_t *c, dm_node_t *node) {
+    if (node->variable.local.resolved) {
+        return emit_local(c, DM_BC_GET_LOCAL, &node->variable.local);
+    }
+    return emit_named(c, DM_BC_GET, node->variable.name);
+}
+
+// `x = x + a + ...`: push x and the parts, then let CONCAT append them
+static dm_error_t compile_concat(dm_compiler_t *c, dm_node_t *node, dm_node_t **parts, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dm_error_t err = compile_node(c, parts[i]);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    dm_error_t err = node->assignment.local.resolved
+        ? emit_local(c, DM_BC_CONCAT_LOCAL, &node->assignment.local)
+        : emit_named(c, DM_BC_CONCAT, node->assignment.name);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    uint8_t part_count = (uint8_t)(count - 1);
+    return emit_bytes(c, &part_count, 1);
+}
+
+static dm_error_t compile_assignment(dm_compiler_t *c, dm_node_t *node) {
+    dm_node_t *parts[DM_CONCAT_MAX_PARTS];
+    size_t count = dm_concat_chain(node, parts);
+    dm_error_t err = count > 0
+        ? compile_concat(c, node, parts, count)
+        : compile_node(c, node->assignment.value);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    // The assigned value stays on the stack as the result
+    if (node->assignment.local.resolved) {
+        return emit_local(c, DM_BC_SET_LOCAL, &node->assignment.local);
+    }
+    return emit_named(c, node->assignment.is_declaration ? DM_BC_DEFINE : DM_BC_SET, node->assignment.name);
+}
+
+// Compile a statement list; leaves the last value (or null) on the stack
+static dm_error_t compile_statements(dm_compiler_t *c, dm_node_t **statements, size_t count) {
+    if (count == 0) {
+        return emit_op(c, DM_BC_NULL);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            dm_error_t err = emit_op(c, DM_BC_POP);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+        }
+
+        dm_error_t err = compile_node(c, statements[i]);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    return DM_SUCCESS;
+}
+
+static dm_error_t compile_block(dm_compiler_t *c, dm_node_t *node) {
+    if (node->block.slot_count > UINT16_MAX) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Too many locals in one block");
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    dm_error_t err = emit_op_u16(c, DM_BC_ENTER_SCOPE, (uint16_t)node->block.slot_count);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = compile_statements(c, node->block.statements, node->block.count);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    return emit_op(c, DM_BC_LEAVE_SCOPE);
+}
+
+static dm_error_t compile_if(dm_compiler_t *c, dm_node_t *node) {
+    dm_error_t err = compile_node(c, node->if_stmt.condition);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    size_t else_patch = 0;
+    err = emit_jump(c, DM_BC_JUMP_IF_FALSE, &else_patch);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = compile_node(c, node->if_stmt.then_branch);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    size_t end_patch = 0;
+    err = emit_jump(c, DM_BC_JUMP, &end_patch);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    // Without an else branch the statement evaluates to null
+    patch_jump(c, else_patch, c->function->code_length);
+    if (node->if_stmt.else_branch != NULL) {
+        err = compile_node(c, node->if_stmt.else_branch);
+    } else {
+        err = emit_op(c, DM_BC_NULL);
+    }
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    patch_jump(c, end_patch, c->function->code_length);
+    return DM_SUCCESS;
+}
+
+static dm_error_t compile_while(dm_compiler_t *c, dm_node_t *node) {
+    // The slot below the condition holds the last body value (null if the loop never runs)
+    dm_error_t err = emit_op(c, DM_BC_NULL);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    size_t loop_start = c->function->code_length;
+    err = compile_node(c, node->while_loop.condition);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    size_t exit_patch = 0;
+    err = emit_jump(c, DM_BC_JUMP_IF_FALSE, &exit_patch);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = emit_op(c, DM_BC_POP);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = compile_node(c, node->while_loop.body);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = emit_jump_to(c, DM_BC_JUMP, loop_start);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    patch_jump(c, exit_patch, c->function->code_length);
+    return DM_SUCCESS;
+}
+
+// Compile a node for its side effects only
+static dm_error_t compile_discarded(dm_compiler_t *c, dm_node_t *node) {
+    dm_error_t err = compile_node(c, node);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    return emit_op(c, DM_BC_POP);
+}
+
+static dm_error_t compile_for(dm_compiler_t *c, dm_node_t *node) {
+    if (node->for_loop.parallel) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Cannot compile a parallel for loop");
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+    if (node->for_loop.slot_count > UINT16_MAX) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message), "Too many locals in one loop");
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    // The initializer's locals live in a scope around the whole loop
+    dm_error_t err = emit_op_u16(c, DM_BC_ENTER_SCOPE, (uint16_t)node->for_loop.slot_count);
+    if (err == DM_SUCCESS && node->for_loop.init != NULL) {
+        err = compile_discarded(c, node->for_loop.init);
+    }
+
+    // As for while, the slot below the condition holds the last body value
+    if (err == DM_SUCCESS) {
+        err = emit_op(c, DM_BC_NULL);
+    }
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    size_t loop_start = c->function->code_length;
+    size_t exit_patch = 0;
+    bool has_exit = (node->for_loop.condition != NULL);
+    if (has_exit) {
+        err = compile_node(c, node->for_loop.condition);
+        if (err == DM_SUCCESS) {
+            err = emit_jump(c, DM_BC_JUMP_IF_FALSE, &exit_patch);
+        }
+    }
+
+    if (err == DM_SUCCESS) {
+        err = emit_op(c, DM_BC_POP);
+    }
+    if (err == DM_SUCCESS) {
+        err = compile_node(c, node->for_loop.body);
+    }
+    if (err == DM_SUCCESS && node->for_loop.increment != NULL) {
+        err = compile_discarded(c, node->for_loop.increment);
+    }
+    if (err == DM_SUCCESS) {
+        err = emit_jump_to(c, DM_BC_JUMP, loop_start);
+    }
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    if (has_exit) {
+        patch_jump(c, exit_patch, c->function->code_length);
+    }
+    return emit_op(c, DM_BC_LEAVE_SCOPE);
+}
+
+static dm_error_t compile_call(dm_compiler_t *c, dm_node_t *node) {
+    if (node->call.arg_count > UINT8_MAX) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message),
+                "Too many arguments in call to '%s'", node->call.name);
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    // A function held in a local is pushed below its arguments
+    bool local = node->call.local.resolved;
+    if (local) {
+        dm_error_t err = emit_local(c, DM_BC_GET_LOCAL, &node->call.local);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    for (size_t i = 0; i < node->call.arg_count; i++) {
+        dm_error_t err = compile_node(c, node->call.args[i]);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    uint16_t name = 0;
+    dm_error_t err = string_constant(c, node->call.name, &name);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    uint8_t bytes[4] = {
+        local ? DM_BC_CALL_VALUE : DM_BC_CALL,
+        (uint8_t)name, (uint8_t)(name >> 8), (uint8_t)node->call.arg_count
+    };
+    return emit_bytes(c, bytes, sizeof(bytes));
+}
+
+static dm_error_t compile_function(dm_compiler_t *c, dm_node_t *node) {
+    if (node->function.param_count > UINT16_MAX) {
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    // Result caches live on AST functions only
+    if (node->function.memoize) {
+        snprintf(c->ctx->error_message, sizeof(c->ctx->error_message),
+                "Cannot compile memo function '%s' to bytecode", node->function.name);
+        return DM_ERROR_NOT_SUPPORTED;
+    }
+
+    dm_bc_function_t *fn = NULL;
+    uint16_t fn_index = 0;
+    dm_error_t err = dm_bc_add_function(c->ctx, c->module, &fn, &fn_index);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    err = string_constant(c, node->function.name, &fn->name);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    if (node->function.param_count > 0) {
+        fn->params = dm_malloc(c->ctx, node->function.param_count * sizeof(uint16_t));
+        if (fn->params == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+
+        for (size_t i = 0; i < node->function.param_count; i++) {
+            err = string_constant(c, node->function.params[i], &fn->params[i]);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            fn->param_count++;
+        }
+    }
+    fn->named_params = !node->function.resolved;
+
+    // The body value is the implicit return value
+    dm_bc_function_t *enclosing = c->function;
+    c->function = fn;
+
+    err = compile_node(c, node->function.body);
+    if (err == DM_SUCCESS) {
+        err = emit_op(c, DM_BC_RETURN);
+    }
+
+    c->function = enclosing;
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    return emit_op_u16(c, DM_BC_FUNCTION, fn_index);
+}
+
+static dm_error_t compile_return(dm_compiler_t *c, dm_node_t *node) {
+    dm_error_t err;
+    if (node->return_stmt.value != NULL) {
+        err = compile_node(c, node->return_stmt.value);
+    } else {
+        err = emit_op(c, DM_BC_NULL);
+    }
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    return emit_op(c, DM_BC_RETURN);
+}
+
+static dm_error_t compile_program(dm_compiler_t *c, dm_node_t *node) {
+    for (size_t i = 0; i < node->program.count; i++) {
+        dm_node_t *stmt = node->program.statements[i];
+
+        dm_error_t err = compile_node(c, stmt);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+
+        // Echo expression statements like the interpreter does. The value
+        // of the last statement stays on the stack as the run's result.
+        bool silent = stmt->type == DM_NODE_ASSIGNMENT || stmt->type == DM_NODE_FUNCTION;
+        if (i + 1 < node->program.count) {
+            err = emit_op(c, silent ? DM_BC_POP : DM_BC_PRINT);
+        } else if (!silent) {
+            err = emit_op(c, DM_BC_DUP);
+            if (err == DM_SUCCESS) {
+                err = emit_op(c, DM_BC_PRINT);
+            }
+        }
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    if (node->program.count == 0) {
+        dm_error_t err = emit_op(c, DM_BC_NULL);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    return emit_op(c, DM_BC_HALT);
+}
+
+static dm_error_t compile_node(dm_compiler_t *c, dm_node_t *node) {
+    if (node == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    switch (node->type) {
+        case DM_NODE_PROGRAM:
+            return compile_program(c, node);
+        case DM_NODE_LITERAL:
+            return compile_literal(c, node);
+        case DM_NODE_BINARY_OP:
+            return compile_binary(c, node);
+        case DM_NODE_UNARY_OP:
+            return compile_unary(c, node);
+        case DM_NODE_VARIABLE:
+            return compile_variable(c, node);
+        case DM_NODE_ASSIGNMENT:
+            return compile_assignment(c, node);
+        case DM_NODE_BLOCK:
+            return compile_block(c, node);
+        case DM_NODE_IF:
+            return compile_if(c, node);
+        case DM_NODE_WHILE:
+            return compile_while(c, node);
+        case DM_NODE_FOR:
+            return compile_for(c, node);
+        case DM_NODE_CALL:
+            return compile_call(c, node);
+        case DM_NODE_FUNCTION:
+            return compile_function(c, node);
+        case DM_NODE_RETURN:
+            return compile_return(c, node);
+        default:
+            snprintf(c->ctx->error_message, sizeof(c->ctx->error_message),
+                    "Cannot compile node type %d to bytecode", node->type);
+            return DM_ERROR_NOT_SUPPORTED;
+    }
+}
+
+// Compile an AST into a bytecode module
+dm_error_t dm_bc_compile(dm_context_t *ctx, dm_node_t *root, dm_bc_module_t **module) {
+    if (ctx == NULL || root == NULL || module == NULL || root->type != DM_NODE_PROGRAM) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Constants are folded up front; locals are compiled to slot accesses
+    dm_error_t err = dm_optimize(ctx, root);
+    if (err == DM_SUCCESS) {
+        err = dm_resolve(ctx, root);
+    }
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    dm_compiler_t compiler;
+    compiler.ctx = ctx;
+    compiler.module = NULL;
+    compiler.function = NULL;
+
+    err = dm_bc_module_create(ctx, &compiler.module);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    // Function 0 is the top-level script
+    uint16_t main_index = 0;
+    err = dm_bc_add_function(ctx, compiler.module, &compiler.function, &main_index);
+    if (err == DM_SUCCESS) {
+        err = compile_node(&compiler, root);
+    }
+
+    if (err != DM_SUCCESS) {
+        dm_bc_module_free(ctx, compiler.module);
+        return err;
+    }
+
+    *module = compiler.module;
+    return DM_SUCCESS;
+}
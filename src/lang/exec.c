@@ -1,41 +1,55 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include "../../include/dmkernel.h"
 #include "../../include/lang/exec.h"
 #include "../../include/lang/parser.h"
+#include "../../include/lang/bytecode.h"
+#include "../../include/lang/memo.h"
+#include "../../include/lang/profile.h"
+#include "../../include/lang/optimizer.h"
+#include "../../include/lang/resolver.h"
+#include "../../include/lang/generator.h"
+#include "../../include/lang/parallel.h"
 #include "../../include/core/filesystem.h"
 
-// Helper function to create a new node
-static dm_node_t *create_result_node(dm_context_t *ctx, dm_node_type_t type) {
-    dm_node_t *node = dm_malloc(ctx, sizeof(dm_node_t));
-    if (node == NULL) {
-        return NULL;
-    }
-    
-    node->type = type;
-    return node;
-}
+// Results are written into a caller-provided dm_value_t slot. The caller owns
+// the slot and releases it with dm_value_free, so scalar results never touch
+// the heap.
 
 // Forward declarations for recursive functions
-static dm_error_t eval_literal(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_binary(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_unary(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_variable(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_assignment(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_block(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_if(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_while(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_function_call(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_function_declaration(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_return(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
-static dm_error_t eval_program(dm_context_t *ctx, dm_node_t *node, dm_node_t **result);
+static dm_error_t eval_literal(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_binary(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_unary(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_variable(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_assignment(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_block(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_if(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_while(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_for(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_function_call(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_function_declaration(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_return(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_program(dm_context_t *ctx, dm_node_t *node, dm_value_t *result);
+static dm_error_t eval_borrowed(dm_context_t *ctx, dm_node_t *node, dm_value_t *temp,
+                                const dm_value_t **value);
+static bool node_is_pure(const dm_node_t *node);
+static const char* value_text(const dm_value_t *value, char *buffer, size_t size);
 
-dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
+dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
     if (ctx == NULL || node == NULL || result == NULL) {
         return DM_ERROR_INVALID_ARGUMENT;
     }
     
+    // Every path leaves a valid (possibly null) value in the slot
+    dm_value_init(result);
+    
+    uint64_t profile_start = 0;
+    if (ctx->profiler != NULL) {
+        profile_start = dm_profile_node_begin(ctx->profiler);
+    }
+    
     // Evaluate based on node type
     dm_error_t err = DM_SUCCESS;
     
@@ -43,437 +57,202 @@ dm_error_t dm_eval_node(dm_context_t *ctx, dm_node_t *node, dm_node_t **result)
         case DM_NODE_LITERAL:
             err = eval_literal(ctx, node, result);
             break;
-            
+        
         case DM_NODE_BINARY_OP:
             err = eval_binary(ctx, node, result);
             break;
-            
+        
         case DM_NODE_UNARY_OP:
             err = eval_unary(ctx, node, result);
             break;
-            
+        
         case DM_NODE_VARIABLE:
             err = eval_variable(ctx, node, result);
             break;
-            
+        
         case DM_NODE_ASSIGNMENT:
             err = eval_assignment(ctx, node, result);
             break;
-            
+        
         case DM_NODE_BLOCK:
             err = eval_block(ctx, node, result);
             break;
-            
+        
         case DM_NODE_IF:
             err = eval_if(ctx, node, result);
             break;
-            
+        
         case DM_NODE_WHILE:
             err = eval_while(ctx, node, result);
             break;
-            
+        
+        case DM_NODE_FOR:
+            err = eval_for(ctx, node, result);
+            break;
+        
+        case DM_NODE_FOR_EACH:
+            err = dm_eval_for_each(ctx, node, result);
+            break;
+        
+        case DM_NODE_YIELD:
+            // Generator bodies are run by generator.c, never reaching here
+            dm_context_set_error(ctx, "'yield' can only run inside a generator");
+            err = DM_ERROR_INVALID_ARGUMENT;
+            break;
+        
         case DM_NODE_CALL:
             err = eval_function_call(ctx, node, result);
             break;
-            
+        
         case DM_NODE_FUNCTION:
             err = eval_function_declaration(ctx, node, result);
             break;
-            
+        
         case DM_NODE_RETURN:
             err = eval_return(ctx, node, result);
             break;
-            
+        
         case DM_NODE_PROGRAM:
             err = eval_program(ctx, node, result);
             break;
-            
+        
         default:
-            snprintf(ctx->error_message, sizeof(ctx->error_message), 
+            snprintf(ctx->error_message, sizeof(ctx->error_message),
                     "Unknown node type: %d", node->type);
-            return DM_ERROR_INVALID_ARGUMENT;
+            err = DM_ERROR_INVALID_ARGUMENT;
+            break;
     }
     
-    return err;
-}
-
-// Evaluate a literal value (just returns a copy of itself)
-static dm_error_t eval_literal(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    dm_node_t *res = create_result_node(ctx, DM_NODE_LITERAL);
-    if (res == NULL) {
-        return DM_ERROR_MEMORY_ALLOCATION;
+    if (ctx->profiler != NULL) {
+        dm_profile_node_end(ctx->profiler, node, profile_start);
     }
     
-    // Copy the literal value
-    res->literal.type = node->literal.type;
+    // Never hand a half-built value back on failure
+    if (err != DM_SUCCESS) {
+        dm_value_free(ctx, result);
+    }
     
+    return err;
+}
+
+// Evaluate a literal value
+static dm_error_t eval_literal(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
     switch (node->literal.type) {
         case DM_LITERAL_NUMBER:
-            res->literal.value.number = node->literal.value.number;
+            result->type = DM_TYPE_FLOAT;
+            result->as.floating = node->literal.value.number;
             break;
-            
-        case DM_LITERAL_STRING:
-            res->literal.value.string = dm_strdup(ctx, node->literal.value.string);
-            if (res->literal.value.string == NULL) {
-                dm_free(ctx, res);
+        
+        case DM_LITERAL_INTEGER:
+            result->type = DM_TYPE_INTEGER;
+            result->as.integer = node->literal.value.integer;
+            break;
+        
+        case DM_LITERAL_STRING: {
+            // Every evaluation shares the atom's string value
+            const dm_value_t *value = dm_atom_value(ctx, node->literal.value.string);
+            if (value == NULL) {
                 return DM_ERROR_MEMORY_ALLOCATION;
             }
+            dm_value_copy(ctx, result, value);
             break;
-            
+        }
+        
         case DM_LITERAL_BOOLEAN:
-            res->literal.value.boolean = node->literal.value.boolean;
+            result->type = DM_TYPE_BOOLEAN;
+            result->as.boolean = node->literal.value.boolean;
             break;
-            
+        
         case DM_LITERAL_NULL:
-            // No value to copy
+            // Already null
             break;
-            
+        
         default:
-            dm_free(ctx, res);
             return DM_ERROR_INVALID_ARGUMENT;
     }
     
-    *result = res;
     return DM_SUCCESS;
 }
 
 // Evaluate a binary expression (arithmetics, comparisons, logical operations)
-static dm_error_t eval_binary(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_BINARY_OP) {
-        return DM_ERROR_INVALID_ARGUMENT;
-    }
-    
-    // Get left and right values
-    dm_node_t *left_result = NULL;
-    dm_node_t *right_result = NULL;
-    dm_error_t err;
-    
-    err = dm_eval_node(ctx, node->binary.left, &left_result);
+static dm_error_t eval_binary(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    dm_value_t left_temp;
+    dm_value_t right_temp;
+    const dm_value_t *left = NULL;
+    const dm_value_t *right = NULL;
+    dm_value_init(&right_temp);
+    
+    // A borrowed left operand must not be reassigned while the right runs
+    dm_error_t err = node_is_pure(node->binary.right)
+        ? eval_borrowed(ctx, node->binary.left, &left_temp, &left)
+        : dm_eval_node(ctx, node->binary.left, &left_temp);
     if (err != DM_SUCCESS) {
         return err;
     }
-    
-    err = dm_eval_node(ctx, node->binary.right, &right_result);
-    if (err != DM_SUCCESS) {
-        dm_node_free(ctx, left_result);
-        return err;
-    }
-    
-    // Create result node
-    dm_node_t *res = create_result_node(ctx, DM_NODE_LITERAL);
-    if (res == NULL) {
-        dm_node_free(ctx, left_result);
-        dm_node_free(ctx, right_result);
-        return DM_ERROR_MEMORY_ALLOCATION;
+    if (left == NULL) {
+        left = &left_temp;
     }
     
-    // Handle different types of binary operations
-    switch (node->binary.op) {
-        case DM_OP_ADD:
-        case DM_OP_SUB:
-        case DM_OP_MUL:
-        case DM_OP_DIV:
-        case DM_OP_MOD:
-            // Arithmetic operations require numbers
-            if (left_result->type != DM_NODE_LITERAL || right_result->type != DM_NODE_LITERAL) {
-                snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                        "Expected literal values for arithmetic operation");
-                dm_node_free(ctx, left_result);
-                dm_node_free(ctx, right_result);
-                dm_free(ctx, res);
-                return DM_ERROR_TYPE_MISMATCH;
-            }
-            
-            // Convert operands to numbers if needed
-            double left_num = 0.0, right_num = 0.0;
-            bool left_valid = false, right_valid = false;
-            
-            switch (left_result->literal.type) {
-                case DM_LITERAL_NUMBER:
-                    left_num = left_result->literal.value.number;
-                    left_valid = true;
-                    break;
-                case DM_LITERAL_BOOLEAN:
-                    left_num = left_result->literal.value.boolean ? 1.0 : 0.0;
-                    left_valid = true;
-                    break;
-                default:
-                    snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                            "Cannot perform arithmetic on non-numeric left operand");
-                    break;
-            }
-            
-            switch (right_result->literal.type) {
-                case DM_LITERAL_NUMBER:
-                    right_num = right_result->literal.value.number;
-                    right_valid = true;
-                    break;
-                case DM_LITERAL_BOOLEAN:
-                    right_num = right_result->literal.value.boolean ? 1.0 : 0.0;
-                    right_valid = true;
-                    break;
-                default:
-                    snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                            "Cannot perform arithmetic on non-numeric right operand");
-                    break;
-            }
-            
-            if (!left_valid || !right_valid) {
-                dm_node_free(ctx, left_result);
-                dm_node_free(ctx, right_result);
-                dm_free(ctx, res);
-                return DM_ERROR_TYPE_MISMATCH;
-            }
-            
-            // Perform the arithmetic operation
-            res->literal.type = DM_LITERAL_NUMBER;
-            switch (node->binary.op) {
-                case DM_OP_ADD:
-                    res->literal.value.number = left_num + right_num;
-                    break;
-                case DM_OP_SUB:
-                    res->literal.value.number = left_num - right_num;
-                    break;
-                case DM_OP_MUL:
-                    res->literal.value.number = left_num * right_num;
-                    break;
-                case DM_OP_DIV:
-                    if (right_num == 0.0) {
-                        snprintf(ctx->error_message, sizeof(ctx->error_message), "Division by zero");
-                        dm_node_free(ctx, left_result);
-                        dm_node_free(ctx, right_result);
-                        dm_free(ctx, res);
-                        return DM_ERROR_DIVISION_BY_ZERO;
-                    }
-                    res->literal.value.number = left_num / right_num;
-                    break;
-                case DM_OP_MOD:
-                    if (right_num == 0.0) {
-                        snprintf(ctx->error_message, sizeof(ctx->error_message), "Modulo by zero");
-                        dm_node_free(ctx, left_result);
-                        dm_node_free(ctx, right_result);
-                        dm_free(ctx, res);
-                        return DM_ERROR_DIVISION_BY_ZERO;
-                    }
-                    // Use fmod for floating-point modulo
-                    res->literal.value.number = fmod(left_num, right_num);
-                    break;
-                default:
-                    // Should never reach here
-                    break;
-            }
-            break;
-            
-        case DM_OP_EQ:
-        case DM_OP_NEQ:
-            // Equality operations can compare any types
-            res->literal.type = DM_LITERAL_BOOLEAN;
-            if (left_result->type != DM_NODE_LITERAL || right_result->type != DM_NODE_LITERAL) {
-                // Non-literal values are never equal
-                res->literal.value.boolean = (node->binary.op == DM_OP_NEQ);
-            } else if (left_result->literal.type != right_result->literal.type) {
-                // Different types are never equal
-                res->literal.value.boolean = (node->binary.op == DM_OP_NEQ);
-            } else {
-                // Same types, compare values
-                bool equal = false;
-                switch (left_result->literal.type) {
-                    case DM_LITERAL_NULL:
-                        equal = true;  // null always equals null
-                        break;
-                    case DM_LITERAL_BOOLEAN:
-                        equal = left_result->literal.value.boolean == right_result->literal.value.boolean;
-                        break;
-                    case DM_LITERAL_NUMBER:
-                        equal = left_result->literal.value.number == right_result->literal.value.number;
-                        break;
-                    case DM_LITERAL_STRING:
-                        equal = strcmp(left_result->literal.value.string, right_result->literal.value.string) == 0;
-                        break;
-                }
-                res->literal.value.boolean = (node->binary.op == DM_OP_EQ) ? equal : !equal;
-            }
-            break;
-            
-        case DM_OP_LT:
-        case DM_OP_GT:
-        case DM_OP_LTE:
-        case DM_OP_GTE:
-            // Comparison operations
-            res->literal.type = DM_LITERAL_BOOLEAN;
-            
-            // Operands must be numbers
-            if (left_result->type != DM_NODE_LITERAL || right_result->type != DM_NODE_LITERAL ||
-                left_result->literal.type != DM_LITERAL_NUMBER || right_result->literal.type != DM_LITERAL_NUMBER) {
-                snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                        "Expected numeric operands for comparison");
-                dm_node_free(ctx, left_result);
-                dm_node_free(ctx, right_result);
-                dm_free(ctx, res);
-                return DM_ERROR_TYPE_MISMATCH;
-            }
-            
-            double left_val = left_result->literal.value.number;
-            double right_val = right_result->literal.value.number;
-            
-            switch (node->binary.op) {
-                case DM_OP_LT:
-                    res->literal.value.boolean = left_val < right_val;
-                    break;
-                case DM_OP_GT:
-                    res->literal.value.boolean = left_val > right_val;
-                    break;
-                case DM_OP_LTE:
-                    res->literal.value.boolean = left_val <= right_val;
-                    break;
-                case DM_OP_GTE:
-                    res->literal.value.boolean = left_val >= right_val;
-                    break;
-                default:
-                    // Should never reach here
-                    break;
-            }
-            break;
-            
-        case DM_OP_AND:
-        case DM_OP_OR:
-            // Logical operations
-            res->literal.type = DM_LITERAL_BOOLEAN;
-            
-            // Convert operands to boolean values
-            bool left_bool = false;
-            if (left_result->type == DM_NODE_LITERAL) {
-                switch (left_result->literal.type) {
-                    case DM_LITERAL_BOOLEAN:
-                        left_bool = left_result->literal.value.boolean;
-                        break;
-                    case DM_LITERAL_NUMBER:
-                        left_bool = left_result->literal.value.number != 0.0;
-                        break;
-                    case DM_LITERAL_STRING:
-                        left_bool = strlen(left_result->literal.value.string) > 0;
-                        break;
-                    case DM_LITERAL_NULL:
-                        left_bool = false;
-                        break;
-                }
-            } else {
-                left_bool = true;  // Non-literal values are truthy
-            }
-            
-            // Short-circuit evaluation for logical operations
-            if ((node->binary.op == DM_OP_AND && !left_bool) ||
-                (node->binary.op == DM_OP_OR && left_bool)) {
-                res->literal.value.boolean = left_bool;
-                break;  // Skip right evaluation
-            }
-            
-            bool right_bool = false;
-            if (right_result->type == DM_NODE_LITERAL) {
-                switch (right_result->literal.type) {
-                    case DM_LITERAL_BOOLEAN:
-                        right_bool = right_result->literal.value.boolean;
-                        break;
-                    case DM_LITERAL_NUMBER:
-                        right_bool = right_result->literal.value.number != 0.0;
-                        break;
-                    case DM_LITERAL_STRING:
-                        right_bool = strlen(right_result->literal.value.string) > 0;
-                        break;
-                    case DM_LITERAL_NULL:
-                        right_bool = false;
-                        break;
-                }
-            } else {
-                right_bool = true;  // Non-literal values are truthy
-            }
-            
-            res->literal.value.boolean = (node->binary.op == DM_OP_AND) ? (left_bool && right_bool) : (left_bool || right_bool);
-            break;
-            
-        default:
-            snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                    "Unsupported binary operator: %d", node->binary.op);
-            dm_node_free(ctx, left_result);
-            dm_node_free(ctx, right_result);
-            dm_free(ctx, res);
-            return DM_ERROR_INVALID_ARGUMENT;
+    err = eval_borrowed(ctx, node->binary.right, &right_temp, &right);
+    if (err == DM_SUCCESS && node->binary.op == DM_OP_ADD && left == &left_temp &&
+        left->type == DM_TYPE_STRING && right->type == DM_TYPE_STRING && dm_value_refcount(left) == 1) {
+        // A temporary string on the left (as in `a + b + c`) is extended in place
+        err = dm_value_string_append(ctx, &left_temp, right->as.string.data, right->as.string.length);
+        if (err == DM_SUCCESS) {
+            *result = left_temp;
+            dm_value_init(&left_temp);
+        }
+    } else if (err == DM_SUCCESS) {
+        err = dm_value_binary_op(ctx, node->binary.op, left, right, result);
     }
     
-    // Free the operand results
-    dm_node_free(ctx, left_result);
-    dm_node_free(ctx, right_result);
+    // Free the operand values (borrowed operands leave these empty)
+    dm_value_free(ctx, &left_temp);
+    dm_value_free(ctx, &right_temp);
     
-    // Return the result
-    *result = res;
-    return DM_SUCCESS;
+    return err;
 }
 
 // Unary operations (negation, logical not)
-static dm_error_t eval_unary(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    // Get operand value
-    dm_node_t *operand_result = NULL;
-    dm_error_t err = dm_eval_node(ctx, node->unary.operand, &operand_result);
+static dm_error_t eval_unary(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    dm_value_t temp;
+    const dm_value_t *operand = NULL;
+    dm_error_t err = eval_borrowed(ctx, node->unary.operand, &temp, &operand);
     if (err != DM_SUCCESS) {
         return err;
     }
     
-    // Create result node
-    dm_node_t *res = create_result_node(ctx, DM_NODE_LITERAL);
-    if (res == NULL) {
-        dm_node_free(ctx, operand_result);
-        return DM_ERROR_MEMORY_ALLOCATION;
-    }
+    err = dm_value_unary_op(ctx, node->unary.op, operand, result);
+    dm_value_free(ctx, &temp);
     
-    // Handle specific operations
-    switch (node->unary.op) {
-        case DM_OP_NEG:
-            // Only numbers can be negated
-            if (operand_result->type != DM_NODE_LITERAL || 
-                operand_result->literal.type != DM_LITERAL_NUMBER) {
-                dm_node_free(ctx, operand_result);
-                dm_free(ctx, res);
-                return DM_ERROR_TYPE_MISMATCH;
-            }
-            res->literal.type = DM_LITERAL_NUMBER;
-            res->literal.value.number = -operand_result->literal.value.number;
-            break;
-            
-        case DM_OP_NOT:
-            // Only booleans can be logically negated
-            if (operand_result->type != DM_NODE_LITERAL || 
-                operand_result->literal.type != DM_LITERAL_BOOLEAN) {
-                dm_node_free(ctx, operand_result);
-                dm_free(ctx, res);
-                return DM_ERROR_TYPE_MISMATCH;
-            }
-            res->literal.type = DM_LITERAL_BOOLEAN;
-            res->literal.value.boolean = !operand_result->literal.value.boolean;
-            break;
-            
-        default:
-            dm_node_free(ctx, operand_result);
-            dm_free(ctx, res);
-            return DM_ERROR_INVALID_ARGUMENT;
+    return err;
+}
+
+// Find the slot of a resolved local
+static dm_value_t* local_slot(dm_context_t *ctx, const dm_local_ref_t *local, const char *name) {
+    dm_value_t *slot = dm_scope_slot(ctx->current_scope, local->depth, local->slot);
+    if (slot == NULL) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                "Invalid local slot for '%s'", name);
     }
-    
-    // Free temporary result
-    dm_node_free(ctx, operand_result);
-    
-    *result = res;
-    return DM_SUCCESS;
+    return slot;
 }
 
-// Variable reference
-static dm_error_t eval_variable(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_VARIABLE) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Borrow the stored value of a variable without copying it
+static dm_error_t borrow_variable(dm_context_t *ctx, dm_node_t *node, const dm_value_t **value) {
+    // Resolved locals are read straight from their slot
+    if (node->variable.local.resolved) {
+        dm_value_t *slot = local_slot(ctx, &node->variable.local, node->variable.name);
+        if (slot == NULL) {
+            return DM_ERROR_INVALID_ARGUMENT;
+        }
+        
+        *value = slot;
+        return DM_SUCCESS;
     }
     
     // Look up the variable in the current scope
-    dm_value_t value;
-    dm_error_t err = dm_scope_lookup(ctx, ctx->current_scope, node->variable.name, &value);
-    
+    dm_error_t err = dm_scope_lookup_ref(ctx, ctx->current_scope, node->variable.name, value);
     if (err != DM_SUCCESS) {
         // Variable not found
         snprintf(ctx->error_message, sizeof(ctx->error_message), 
@@ -481,622 +260,1263 @@ static dm_error_t eval_variable(dm_context_t *ctx, dm_node_t *node, dm_node_t **
         return DM_ERROR_UNDEFINED_VARIABLE;
     }
     
-    // Create result node based on the value
-    dm_node_t *res = create_result_node(ctx, DM_NODE_LITERAL);
-    if (res == NULL) {
-        return DM_ERROR_MEMORY_ALLOCATION;
-    }
-    
-    // Convert dm_value_t to dm_node_t
-    switch (value.type) {
-        case DM_TYPE_NULL:
-            res->literal.type = DM_LITERAL_NULL;
-            break;
-            
-        case DM_TYPE_BOOLEAN:
-            res->literal.type = DM_LITERAL_BOOLEAN;
-            res->literal.value.boolean = value.as.boolean;
-            break;
-            
-        case DM_TYPE_INTEGER:
-            res->literal.type = DM_LITERAL_NUMBER;
-            res->literal.value.number = (double)value.as.integer;
-            break;
-            
-        case DM_TYPE_FLOAT:
-            res->literal.type = DM_LITERAL_NUMBER;
-            res->literal.value.number = value.as.floating;
-            break;
-            
-        case DM_TYPE_STRING:
-            res->literal.type = DM_LITERAL_STRING;
-            res->literal.value.string = dm_strdup(ctx, value.as.string.data);
-            if (res->literal.value.string == NULL) {
-                dm_free(ctx, res);
-                return DM_ERROR_MEMORY_ALLOCATION;
-            }
-            break;
-            
-        default:
-            // For other types, return null for now
-            res->literal.type = DM_LITERAL_NULL;
-            break;
+    return DM_SUCCESS;
+}
+
+// Variable reference
+static dm_error_t eval_variable(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    const dm_value_t *value = NULL;
+    dm_error_t err = borrow_variable(ctx, node, &value);
+    if (err != DM_SUCCESS) {
+        return err;
     }
     
-    *result = res;
+    dm_value_copy(ctx, result, value);
     return DM_SUCCESS;
 }
 
-// Variable assignment
-static dm_error_t eval_assignment(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_ASSIGNMENT) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Evaluate an operand that is only read. Variables are borrowed in place;
+// anything else is evaluated into temp. temp is always left initialized so
+// the caller can free it unconditionally.
+static dm_error_t eval_borrowed(dm_context_t *ctx, dm_node_t *node, dm_value_t *temp,
+                                const dm_value_t **value) {
+    dm_value_init(temp);
+    
+    if (node != NULL && node->type == DM_NODE_VARIABLE) {
+        return borrow_variable(ctx, node, value);
     }
     
-    // Evaluate the value first
-    dm_node_t *value_node = NULL;
-    dm_error_t err = dm_eval_node(ctx, node->assignment.value, &value_node);
-    if (err != DM_SUCCESS) {
-        return err;
+    dm_error_t err = dm_eval_node(ctx, node, temp);
+    *value = temp;
+    return err;
+}
+
+// Whether evaluating a node can run user code that reassigns variables
+static bool node_is_pure(const dm_node_t *node) {
+    if (node == NULL) {
+        return true;
     }
     
-    // Convert the node to a dm_value_t
-    dm_value_t value;
-    dm_value_init(&value);
+    switch (node->type) {
+        case DM_NODE_LITERAL:
+        case DM_NODE_VARIABLE:
+            return true;
+        case DM_NODE_UNARY_OP:
+            return node_is_pure(node->unary.operand);
+        case DM_NODE_BINARY_OP:
+            return node_is_pure(node->binary.left) && node_is_pure(node->binary.right);
+        default:
+            return false;
+    }
+}
+
+static bool same_local(const dm_local_ref_t *a, const dm_local_ref_t *b) {
+    return a->resolved && b->resolved && a->depth == b->depth && a->slot == b->slot;
+}
+
+// Match `x = x + a + b + ...`; parts receives x's node, then a, b, ...
+size_t dm_concat_chain(dm_node_t *node, dm_node_t **parts) {
+    if (node == NULL || node->type != DM_NODE_ASSIGNMENT || node->assignment.is_declaration) {
+        return 0;
+    }
     
-    if (value_node->type == DM_NODE_LITERAL) {
-        switch (value_node->literal.type) {
-            case DM_LITERAL_NULL:
-                value.type = DM_TYPE_NULL;
-                break;
-                
-            case DM_LITERAL_BOOLEAN:
-                value.type = DM_TYPE_BOOLEAN;
-                value.as.boolean = value_node->literal.value.boolean;
-                break;
-                
-            case DM_LITERAL_NUMBER:
-                value.type = DM_TYPE_FLOAT;
-                value.as.floating = value_node->literal.value.number;
-                break;
-                
-            case DM_LITERAL_STRING:
-                value.type = DM_TYPE_STRING;
-                value.as.string.length = strlen(value_node->literal.value.string);
-                value.as.string.data = dm_strdup(ctx, value_node->literal.value.string);
-                if (value.as.string.data == NULL) {
-                    dm_node_free(ctx, value_node);
-                    return DM_ERROR_MEMORY_ALLOCATION;
-                }
-                break;
+    // Walk down the left spine of the `+` chain to its first operand
+    size_t count = 0;
+    dm_node_t *first = node->assignment.value;
+    while (first->type == DM_NODE_BINARY_OP && first->binary.op == DM_OP_ADD) {
+        if (++count >= DM_CONCAT_MAX_PARTS) {
+            return 0;
         }
-    } else {
-        // For non-literal nodes, store as null for now
-        value.type = DM_TYPE_NULL;
+        first = first->binary.left;
     }
     
-    // If this is a declaration, define a new variable
-    // Otherwise update an existing one
-    if (node->assignment.is_declaration) {
-        err = dm_scope_define(ctx, ctx->current_scope, node->assignment.name, value);
-    } else {
-        // First check if the variable exists
-        dm_value_t dummy;
-        if (dm_scope_lookup(ctx, ctx->current_scope, node->assignment.name, &dummy) != DM_SUCCESS) {
-            // Variable doesn't exist
-            snprintf(ctx->error_message, sizeof(ctx->error_message), 
-                    "Cannot assign to undefined variable '%s'", node->assignment.name);
-            
-            // Free value if necessary
-            if (value.type == DM_TYPE_STRING) {
-                dm_free(ctx, value.as.string.data);
-            }
-            
-            dm_node_free(ctx, value_node);
-            return DM_ERROR_UNDEFINED_VARIABLE;
+    if (count == 0 || first->type != DM_NODE_VARIABLE) {
+        return 0;
+    }
+    
+    const dm_local_ref_t *target = &node->assignment.local;
+    bool same_variable = target->resolved
+        ? same_local(&first->variable.local, target)
+        : !first->variable.local.resolved && first->variable.name == node->assignment.name;
+    if (!same_variable) {
+        return 0;
+    }
+    
+    parts[0] = first;
+    dm_node_t *add = node->assignment.value;
+    for (size_t i = count; i > 0; i--) {
+        parts[i] = add->binary.right;
+        add = add->binary.left;
+    }
+    
+    return count + 1;
+}
+
+// Evaluate the value of `x = x + a + ...`. x is read first, as `+` would;
+// if it holds a string the parts are then appended to it in place.
+static dm_error_t eval_concat(dm_context_t *ctx, dm_node_t *node, dm_node_t **part_nodes,
+                              size_t count, dm_value_t *result) {
+    dm_value_t values[DM_CONCAT_MAX_PARTS];
+    dm_error_t err = DM_SUCCESS;
+    size_t evaluated = 0;
+    
+    while (evaluated < count) {
+        err = dm_eval_node(ctx, part_nodes[evaluated], &values[evaluated]);
+        evaluated++;
+        if (err != DM_SUCCESS) {
+            break;
+        }
+    }
+    
+    if (err == DM_SUCCESS) {
+        // Find the target only now; the parts may have redefined it
+        dm_value_t *target = NULL;
+        if (values[0].type != DM_TYPE_STRING) {
+            // Nothing to append to
+        } else if (node->assignment.local.resolved) {
+            target = dm_scope_slot(ctx->current_scope, node->assignment.local.depth, node->assignment.local.slot);
+        } else {
+            target = dm_scope_lookup_mutable(ctx, ctx->current_scope, node->assignment.name);
+        }
+        err = dm_value_concat(ctx, target, &values[0], &values[1], count - 1, result);
+    }
+    
+    for (size_t i = 0; i < evaluated; i++) {
+        dm_value_free(ctx, &values[i]);
+    }
+    
+    return err;
+}
+
+// Whether an assignment in a parallel loop worker targets a variable of
+// the parent thread: reaching it leaves the worker's own scopes
+static bool assigns_shared(dm_context_t *ctx, dm_node_t *node) {
+    dm_scope_t *owner = NULL;
+    if (node->assignment.local.resolved) {
+        owner = ctx->current_scope;
+        for (size_t depth = node->assignment.local.depth; depth > 0 && owner != NULL; depth--) {
+            owner = owner->parent;
+        }
+    } else {
+        owner = dm_scope_owner(ctx->current_scope, node->assignment.name);
+    }
+    
+    for (dm_scope_t *scope = ctx->current_scope; scope != NULL; scope = scope->parent) {
+        if (scope == ctx->shared_scope || scope == ctx->global_scope) {
+            return true;
+        }
+        if (scope == owner) {
+            return false;
         }
-        
-        // Variable exists, update it
-        err = dm_scope_define(ctx, ctx->current_scope, node->assignment.name, value);
     }
     
-    // Free the string data if we copied it (scope_define makes its own copy)
-    if (value.type == DM_TYPE_STRING) {
-        dm_free(ctx, value.as.string.data);
+    return owner != NULL;
+}
+
+// Variable assignment
+static dm_error_t eval_assignment(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    // Parallel loop workers may only assign variables of their own (checked
+    // first, as `x = x + ...` may append to x while evaluating)
+    if (ctx->parent != NULL && !node->assignment.is_declaration && assigns_shared(ctx, node)) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                "Cannot assign to '%s' inside a parallel for", node->assignment.name);
+        return DM_ERROR_INVALID_ARGUMENT;
     }
     
+    // Evaluate the value first; it doubles as the result of the assignment.
+    // Strings built up with `x = x + ...` grow in place; the check is only
+    // made where a string was stored before.
+    dm_node_t *parts[DM_CONCAT_MAX_PARTS];
+    size_t count = node->assignment.stores_string ? dm_concat_chain(node, parts) : 0;
+    dm_error_t err = count > 0
+        ? eval_concat(ctx, node, parts, count, result)
+        : dm_eval_node(ctx, node->assignment.value, result);
     if (err != DM_SUCCESS) {
-        dm_node_free(ctx, value_node);
         return err;
     }
+    if (ctx->parent == NULL) {
+        node->assignment.stores_string = (result->type == DM_TYPE_STRING);
+    }
+    
+    // Resolved locals (declared or assigned) are stored straight into their slot
+    if (node->assignment.local.resolved) {
+        dm_value_t *slot = local_slot(ctx, &node->assignment.local, node->assignment.name);
+        if (slot == NULL) {
+            return DM_ERROR_INVALID_ARGUMENT;
+        }
+        
+        dm_value_copy(ctx, slot, result);
+        return DM_SUCCESS;
+    }
+    
+    // If this is a declaration, define a new variable
+    // Otherwise update the variable in the scope that defines it
+    if (node->assignment.is_declaration) {
+        return dm_scope_define(ctx, ctx->current_scope, node->assignment.name, *result);
+    }
+    
+    if (dm_scope_assign(ctx, ctx->current_scope, node->assignment.name, *result) != DM_SUCCESS) {
+        // Variable doesn't exist
+        snprintf(ctx->error_message, sizeof(ctx->error_message), 
+                "Cannot assign to undefined variable '%s'", node->assignment.name);
+        return DM_ERROR_UNDEFINED_VARIABLE;
+    }
     
-    // Return the value as the result of the assignment
-    *result = value_node;
     return DM_SUCCESS;
 }
 
 // Block of statements
-static dm_error_t eval_block(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_BLOCK) {
-        return DM_ERROR_INVALID_ARGUMENT;
-    }
-    
-    // Create a new scope for the block
-    dm_scope_t *block_scope = dm_scope_create(ctx, ctx->current_scope);
+static dm_error_t eval_block(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    // Take a pooled scope for the block with room for its resolved locals
+    dm_scope_t *block_scope = dm_scope_acquire(ctx, ctx->current_scope, node->block.slot_count);
     if (block_scope == NULL) {
         return DM_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Save previous scope
+    // Save previous scope and make the block scope current
     dm_scope_t *previous_scope = ctx->current_scope;
-    
-    // Set the new scope as current
     ctx->current_scope = block_scope;
     
-    // Execute all statements in the block
-    dm_node_t *stmt_result = NULL;
+    // Execute all statements; the block evaluates to the last one (null if empty)
     dm_error_t err = DM_SUCCESS;
     
     for (size_t i = 0; i < node->block.count; i++) {
-        // Free the previous statement result, if any
-        if (stmt_result != NULL) {
-            dm_node_free(ctx, stmt_result);
-            stmt_result = NULL;
-        }
+        dm_value_free(ctx, result);
         
-        // Evaluate the current statement
-        err = dm_eval_node(ctx, node->block.statements[i], &stmt_result);
-        if (err != DM_SUCCESS) {
+        // Scratch memory of a statement is released when it ends
+        dm_arena_mark_t scratch = dm_arena_begin(ctx);
+        err = dm_eval_node(ctx, node->block.statements[i], result);
+        dm_arena_end(ctx, scratch);
+        if (err != DM_SUCCESS || ctx->returning) {
             break;
         }
     }
     
-    // Save the last result
-    *result = stmt_result;
-    stmt_result = NULL; // Prevent it from being freed
-    
-    // Restore the previous scope
+    // Restore the previous scope and return the block scope to the pool
     ctx->current_scope = previous_scope;
-    
-    // Destroy the block scope
-    dm_scope_destroy(ctx, block_scope);
-    
-    // If no statements were executed, return NULL
-    if (*result == NULL) {
-        *result = create_result_node(ctx, DM_NODE_LITERAL);
-        if (*result != NULL) {
-            (*result)->literal.type = DM_LITERAL_NULL;
-        } else {
-            err = DM_ERROR_MEMORY_ALLOCATION;
-        }
-    }
+    dm_scope_release(ctx, block_scope);
     
     return err;
 }
 
 // If statement
-static dm_error_t eval_if(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_IF) {
-        return DM_ERROR_INVALID_ARGUMENT;
-    }
-    
+static dm_error_t eval_if(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
     // Evaluate the condition
-    dm_node_t *condition_result = NULL;
-    dm_error_t err = dm_eval_node(ctx, node->if_stmt.condition, &condition_result);
+    dm_value_t temp;
+    const dm_value_t *condition = NULL;
+    dm_error_t err = eval_borrowed(ctx, node->if_stmt.condition, &temp, &condition);
     if (err != DM_SUCCESS) {
         return err;
     }
     
-    // Check if the condition is true
-    bool condition_true = false;
-    
-    if (condition_result->type == DM_NODE_LITERAL) {
-        switch (condition_result->literal.type) {
-            case DM_LITERAL_BOOLEAN:
-                condition_true = condition_result->literal.value.boolean;
-                break;
-                
-            case DM_LITERAL_NUMBER:
-                condition_true = condition_result->literal.value.number != 0;
-                break;
-                
-            case DM_LITERAL_STRING:
-                condition_true = condition_result->literal.value.string != NULL && 
-                                 strlen(condition_result->literal.value.string) > 0;
-                break;
-                
-            case DM_LITERAL_NULL:
-                condition_true = false;
-                break;
-        }
-    } else {
-        // Non-literal nodes are considered true
-        condition_true = true;
-    }
-    
-    // Free condition result
-    dm_node_free(ctx, condition_result);
+    bool condition_true = dm_value_is_truthy(condition);
+    dm_value_free(ctx, &temp);
     
-    // Execute the appropriate branch
+    // Execute the appropriate branch (no else branch leaves null)
     if (condition_true) {
-        // Execute then branch
         return dm_eval_node(ctx, node->if_stmt.then_branch, result);
     } else if (node->if_stmt.else_branch != NULL) {
-        // Execute else branch
         return dm_eval_node(ctx, node->if_stmt.else_branch, result);
-    } else {
-        // No else branch, return NULL
-        *result = create_result_node(ctx, DM_NODE_LITERAL);
-        if (*result == NULL) {
-            return DM_ERROR_MEMORY_ALLOCATION;
-        }
-        
-        (*result)->literal.type = DM_LITERAL_NULL;
-        return DM_SUCCESS;
     }
+    
+    return DM_SUCCESS;
 }
 
 // While loop
-static dm_error_t eval_while(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_WHILE) {
-        return DM_ERROR_INVALID_ARGUMENT;
-    }
-    
-    dm_node_t *latest_result = NULL;
+static dm_error_t eval_while(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
     dm_error_t err = DM_SUCCESS;
     
-    // Loop until condition is false
+    // Loop until condition is false; result holds the last iteration's value
     while (1) {
-        // Evaluate condition
-        dm_node_t *condition_result = NULL;
-        err = dm_eval_node(ctx, node->while_loop.condition, &condition_result);
+        dm_value_t temp;
+        const dm_value_t *condition = NULL;
+        err = eval_borrowed(ctx, node->while_loop.condition, &temp, &condition);
         if (err != DM_SUCCESS) {
             break;
         }
         
-        // Check if condition is true
-        bool condition_true = false;
-        
-        if (condition_result->type == DM_NODE_LITERAL) {
-            switch (condition_result->literal.type) {
-                case DM_LITERAL_BOOLEAN:
-                    condition_true = condition_result->literal.value.boolean;
-                    break;
-                    
-                case DM_LITERAL_NUMBER:
-                    condition_true = condition_result->literal.value.number != 0;
-                    break;
-                    
-                case DM_LITERAL_STRING:
-                    condition_true = condition_result->literal.value.string != NULL && 
-                                     strlen(condition_result->literal.value.string) > 0;
-                    break;
-                    
-                case DM_LITERAL_NULL:
-                    condition_true = false;
-                    break;
-            }
-        } else {
-            // Non-literal nodes are considered true
-            condition_true = true;
-        }
-        
-        // Free condition result
-        dm_node_free(ctx, condition_result);
+        bool condition_true = dm_value_is_truthy(condition);
+        dm_value_free(ctx, &temp);
         
-        // Exit loop if condition is false
         if (!condition_true) {
             break;
         }
         
-        // Free previous iteration result
-        if (latest_result != NULL) {
-            dm_node_free(ctx, latest_result);
-            latest_result = NULL;
-        }
-        
-        // Execute loop body
-        err = dm_eval_node(ctx, node->while_loop.body, &latest_result);
+        // Each iteration is a step of the run
+        err = DM_KERNEL_STEP(ctx);
         if (err != DM_SUCCESS) {
             break;
         }
-    }
-    
-    // Return the result of the last iteration or NULL if no iterations
-    if (latest_result != NULL) {
-        *result = latest_result;
-    } else {
-        // Return null if loop never executed
-        *result = create_result_node(ctx, DM_NODE_LITERAL);
-        if (*result == NULL) {
-            return DM_ERROR_MEMORY_ALLOCATION;
-        }
         
-        (*result)->literal.type = DM_LITERAL_NULL;
+        // Execute loop body, replacing the previous iteration's value
+        dm_value_free(ctx, result);
+        err = dm_eval_node(ctx, node->while_loop.body, result);
+        if (err != DM_SUCCESS || ctx->returning) {
+            break;
+        }
     }
     
     return err;
 }
 
-// Function call
-static dm_error_t eval_function_call(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_CALL) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Checked int64 arithmetic: false if the exact result does not fit
+static bool checked_add(int64_t a, int64_t b, int64_t *result) {
+#if defined(__GNUC__)
+    return !__builtin_add_overflow(a, b, result);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+        return false;
     }
-    
-    // Look up the function in the scope chain
-    dm_value_t function_value;
-    dm_error_t err = dm_scope_lookup(ctx, ctx->current_scope, node->call.name, &function_value);
-    if (err != DM_SUCCESS) {
-        // Function not found
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), "Function '%s' is not defined", node->call.name);
-        dm_context_set_error(ctx, error_msg);
-        return DM_ERROR_UNDEFINED_VARIABLE;
+    *result = a + b;
+    return true;
+#endif
+}
+
+static bool checked_sub(int64_t a, int64_t b, int64_t *result) {
+#if defined(__GNUC__)
+    return !__builtin_sub_overflow(a, b, result);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+        return false;
     }
-    
-    // Check if it's actually a function
-    if (function_value.type != DM_TYPE_FUNCTION) {
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), "'%s' is not a function", node->call.name);
-        dm_context_set_error(ctx, error_msg);
-        return DM_ERROR_TYPE_MISMATCH;
+    *result = a - b;
+    return true;
+#endif
+}
+
+static bool checked_mul(int64_t a, int64_t b, int64_t *result) {
+#if defined(__GNUC__)
+    return !__builtin_mul_overflow(a, b, result);
+#else
+    if (a != 0 && b != 0 &&
+        ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN) ||
+         (a != -1 && b != -1 && (a * b) / b != a))) {
+        return false;
     }
-    
-    // Get the function node from the user_data
-    dm_node_t *function_node = function_value.as.function.user_data;
-    if (function_node == NULL || function_node->type != DM_NODE_FUNCTION) {
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), "Invalid function definition for '%s'", node->call.name);
-        dm_context_set_error(ctx, error_msg);
-        return DM_ERROR_TYPE_MISMATCH;
+    *result = a * b;
+    return true;
+#endif
+}
+
+// Largest magnitude at which every integer is exactly representable as a double
+#define DM_EXACT_INT_LIMIT 9007199254740992.0
+
+static bool is_integral_literal(const dm_node_t *node, int64_t *value, bool *is_integer) {
+    if (node == NULL || node->type != DM_NODE_LITERAL) {
+        return false;
     }
     
-    // Check if argument count matches parameter count
-    if (node->call.arg_count != function_node->function.param_count) {
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), 
-                "Function '%s' expects %zu arguments, but got %zu", 
-                node->call.name, 
-                function_node->function.param_count, 
-                node->call.arg_count);
-        dm_context_set_error(ctx, error_msg);
-        return DM_ERROR_INVALID_ARGUMENT;
+    if (node->literal.type == DM_LITERAL_INTEGER) {
+        int64_t integer = node->literal.value.integer;
+        if (integer > 1000000000 || integer < -1000000000) {
+            return false;
+        }
+        *value = integer;
+        *is_integer = true;
+        return true;
     }
     
-    // Create a new scope for the function call
-    dm_scope_t *function_scope = dm_scope_create(ctx, ctx->current_scope);
-    if (function_scope == NULL) {
-        return DM_ERROR_MEMORY_ALLOCATION;
+    if (node->literal.type != DM_LITERAL_NUMBER) {
+        return false;
     }
     
-    // Evaluate and bind arguments to parameters
-    for (size_t i = 0; i < node->call.arg_count; i++) {
-        // Evaluate the argument
-        dm_node_t *arg_result = NULL;
-        err = dm_eval_node(ctx, node->call.args[i], &arg_result);
-        if (err != DM_SUCCESS) {
-            dm_scope_destroy(ctx, function_scope);
-            return err;
-        }
-        
-        // Convert argument to value
-        dm_value_t arg_value;
-        dm_value_init(&arg_value);
-        
-        if (arg_result->type == DM_NODE_LITERAL) {
-            // Convert literal to value
-            switch (arg_result->literal.type) {
-                case DM_LITERAL_NULL:
-                    arg_value.type = DM_TYPE_NULL;
-                    break;
-                    
-                case DM_LITERAL_BOOLEAN:
-                    arg_value.type = DM_TYPE_BOOLEAN;
-                    arg_value.as.boolean = arg_result->literal.value.boolean;
-                    break;
-                    
-                case DM_LITERAL_NUMBER:
-                    arg_value.type = DM_TYPE_FLOAT;
-                    arg_value.as.floating = arg_result->literal.value.number;
-                    break;
-                    
-                case DM_LITERAL_STRING:
-                    arg_value.type = DM_TYPE_STRING;
-                    arg_value.as.string.data = strdup(arg_result->literal.value.string);
-                    if (arg_value.as.string.data == NULL) {
-                        dm_node_free(ctx, arg_result);
-                        dm_scope_destroy(ctx, function_scope);
-                        return DM_ERROR_MEMORY_ALLOCATION;
-                    }
-                    arg_value.as.string.length = strlen(arg_value.as.string.data);
-                    break;
-            }
-        } else {
-            // Non-literal node, this is an error
-            dm_node_free(ctx, arg_result);
-            dm_scope_destroy(ctx, function_scope);
-            return DM_ERROR_TYPE_MISMATCH;
-        }
-        
-        // Bind argument to parameter
-        err = dm_scope_define(ctx, function_scope, function_node->function.params[i], arg_value);
-        
-        // Clean up any dynamically allocated memory in the value
-        dm_value_free(ctx, &arg_value);
-        
-        // Free the argument result
-        dm_node_free(ctx, arg_result);
-        
-        if (err != DM_SUCCESS) {
-            dm_scope_destroy(ctx, function_scope);
-            return err;
-        }
+    double number = node->literal.value.number;
+    if (number != (double)(int64_t)number || number > 1e9 || number < -1e9) {
+        return false;
     }
     
-    // Save previous scope
-    dm_scope_t *previous_scope = ctx->current_scope;
-    
-    // Set function scope as current
-    ctx->current_scope = function_scope;
-    
-    // Execute function body
-    err = dm_eval_node(ctx, function_node->function.body, result);
-    
-    // Restore previous scope
-    ctx->current_scope = previous_scope;
-    
-    // Destroy function scope
-    dm_scope_destroy(ctx, function_scope);
-    
-    return err;
+    *value = (int64_t)number;
+    *is_integer = false;
+    return true;
 }
 
-// Function declaration
-static dm_error_t eval_function_declaration(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_FUNCTION) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Recognize `for (let i = ...; i < bound; i = i + step)` with a constant
+// integral step (also `<=`, `>`, `>=`, `-` and `step + i`). *integer_step
+// is true when the step is an integer literal rather than a whole float.
+static bool counting_loop_step(const dm_node_t *node, int64_t *step, bool *integer_step) {
+    const dm_node_t *init = node->for_loop.init;
+    const dm_node_t *condition = node->for_loop.condition;
+    const dm_node_t *increment = node->for_loop.increment;
+    
+    if (init == NULL || init->type != DM_NODE_ASSIGNMENT || !init->assignment.is_declaration ||
+        !init->assignment.local.resolved || init->assignment.local.depth != 0) {
+        return false;
+    }
+    const dm_local_ref_t *counter = &init->assignment.local;
+    
+    if (condition == NULL || condition->type != DM_NODE_BINARY_OP ||
+        (condition->binary.op != DM_OP_LT && condition->binary.op != DM_OP_LTE &&
+         condition->binary.op != DM_OP_GT && condition->binary.op != DM_OP_GTE) ||
+        condition->binary.left->type != DM_NODE_VARIABLE ||
+        !same_local(&condition->binary.left->variable.local, counter) ||
+        !node_is_pure(condition->binary.right)) {
+        return false;
     }
     
-    // Store the function in the current scope
-    dm_value_t function_value;
-    dm_value_init(&function_value);
-    
-    function_value.type = DM_TYPE_FUNCTION;
-    function_value.as.function.func = NULL; // Not a native function
-    function_value.as.function.user_data = node; // Store the function node as user data
-    
-    // Add the function to the current scope
-    dm_error_t err = dm_scope_define(ctx, ctx->current_scope, node->function.name, function_value);
-    if (err != DM_SUCCESS) {
-        return err;
+    if (increment == NULL || increment->type != DM_NODE_ASSIGNMENT ||
+        !same_local(&increment->assignment.local, counter)) {
+        return false;
     }
     
-    // Return the function name as result
-    *result = create_result_node(ctx, DM_NODE_LITERAL);
-    if (*result == NULL) {
-        return DM_ERROR_MEMORY_ALLOCATION;
+    const dm_node_t *update = increment->assignment.value;
+    if (update->type != DM_NODE_BINARY_OP ||
+        (update->binary.op != DM_OP_ADD && update->binary.op != DM_OP_SUB)) {
+        return false;
     }
     
-    (*result)->literal.type = DM_LITERAL_STRING;
-    (*result)->literal.value.string = strdup(node->function.name);
-    if ((*result)->literal.value.string == NULL) {
-        dm_node_free(ctx, *result);
-        *result = NULL;
-        return DM_ERROR_MEMORY_ALLOCATION;
+    const dm_node_t *left = update->binary.left;
+    const dm_node_t *right = update->binary.right;
+    if (left->type == DM_NODE_VARIABLE && same_local(&left->variable.local, counter) &&
+        is_integral_literal(right, step, integer_step)) {
+        if (update->binary.op == DM_OP_SUB) {
+            *step = -*step;
+        }
+    } else if (update->binary.op == DM_OP_ADD && right->type == DM_NODE_VARIABLE &&
+               same_local(&right->variable.local, counter) && is_integral_literal(left, step, integer_step)) {
+        // step + i
+    } else {
+        return false;
     }
     
-    return DM_SUCCESS;
+    return *step != 0;
 }
 
-// Return statement
-static dm_error_t eval_return(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_RETURN) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Read an integral counter value; false if it is not one. Integer counters
+// only qualify with an integer step, since a float step makes them floats.
+static bool counter_value(const dm_value_t *value, bool integer_step, int64_t *counter) {
+    if (value->type == DM_TYPE_INTEGER) {
+        *counter = value->as.integer;
+        return integer_step;
     }
     
-    // If there's a return value, evaluate it
-    if (node->return_stmt.value != NULL) {
-        return dm_eval_node(ctx, node->return_stmt.value, result);
-    } else {
-        // Return null if no value provided
-        *result = create_result_node(ctx, DM_NODE_LITERAL);
-        if (*result == NULL) {
-            return DM_ERROR_MEMORY_ALLOCATION;
-        }
-        
-        (*result)->literal.type = DM_LITERAL_NULL;
-        return DM_SUCCESS;
+    if (value->type != DM_TYPE_FLOAT || value->as.floating != value->as.floating ||
+        value->as.floating >= DM_EXACT_INT_LIMIT || value->as.floating <= -DM_EXACT_INT_LIMIT ||
+        value->as.floating != (double)(int64_t)value->as.floating) {
+        return false;
     }
+    
+    *counter = (int64_t)value->as.floating;
+    return true;
 }
 
-// Execute a program (sequence of statements)
-static dm_error_t eval_program(dm_context_t *ctx, dm_node_t *node, dm_node_t **result) {
-    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_PROGRAM) {
-        return DM_ERROR_INVALID_ARGUMENT;
+// Run a counting loop with the counter kept in a C integer. The counter's
+// slot is updated in place, so the body sees the usual integer or float
+// value. If the body stores something the fast path cannot follow (or the
+// bound stops being a number) *handled is false and the generic loop takes
+// over at the next condition check.
+static dm_error_t eval_counting_for(dm_context_t *ctx, dm_node_t *node, int64_t step,
+                                    bool integer_step, dm_value_t *result, bool *handled) {
+    *handled = false;
+    
+    const dm_local_ref_t *ref = &node->for_loop.init->assignment.local;
+    dm_value_t *slot = dm_scope_slot(ctx->current_scope, 0, ref->slot);
+    int64_t counter = 0;
+    if (slot == NULL || !counter_value(slot, integer_step, &counter)) {
+        return DM_SUCCESS;
     }
     
-    // Execute all statements in sequence, keeping only the last result
-    dm_node_t *stmt_result = NULL;
-    dm_error_t err = DM_SUCCESS;
+    dm_operator_t op = node->for_loop.condition->binary.op;
+    dm_node_t *bound_node = node->for_loop.condition->binary.right;
     
-    for (size_t i = 0; i < node->program.count; i++) {
-        // Free previous result, if any
-        if (stmt_result != NULL) {
-            dm_node_free(ctx, stmt_result);
-            stmt_result = NULL;
+    while (1) {
+        dm_value_t temp;
+        const dm_value_t *bound = NULL;
+        dm_error_t err = eval_borrowed(ctx, bound_node, &temp, &bound);
+        if (err != DM_SUCCESS) {
+            *handled = true;
+            return err;
+        }
+        
+        bool keep_going;
+        if (bound->type == DM_TYPE_INTEGER && slot->type == DM_TYPE_INTEGER) {
+            int64_t limit = bound->as.integer;
+            keep_going = (op == DM_OP_LT) ? counter < limit :
+                         (op == DM_OP_LTE) ? counter <= limit :
+                         (op == DM_OP_GT) ? counter > limit : counter >= limit;
+        } else if (bound->type == DM_TYPE_INTEGER || bound->type == DM_TYPE_FLOAT) {
+            double limit = bound->type == DM_TYPE_INTEGER ? (double)bound->as.integer : bound->as.floating;
+            double current = (double)counter;
+            keep_going = (op == DM_OP_LT) ? current < limit :
+                         (op == DM_OP_LTE) ? current <= limit :
+                         (op == DM_OP_GT) ? current > limit : current >= limit;
+        } else {
+            dm_value_free(ctx, &temp);
+            return DM_SUCCESS;
+        }
+        dm_value_free(ctx, &temp);
+        
+        if (!keep_going) {
+            *handled = true;
+            return DM_SUCCESS;
         }
         
-        // Evaluate the current statement
-        err = dm_eval_node(ctx, node->program.statements[i], &stmt_result);
+        err = DM_KERNEL_STEP(ctx);
         if (err != DM_SUCCESS) {
-            // Don't free stmt_result, as it might not be allocated if there was an error
+            *handled = true;
             return err;
         }
         
-        // Print the result if it's an expression statement
-        if (stmt_result != NULL && node->program.statements[i]->type != DM_NODE_ASSIGNMENT 
-            && node->program.statements[i]->type != DM_NODE_FUNCTION) {
-            char *result_str = NULL;
-            if (dm_node_to_string(ctx, stmt_result, &result_str) == DM_SUCCESS && result_str != NULL) {
-                fprintf(ctx->output, "=> %s\n", result_str);
-                dm_free(ctx, result_str);
+        // Execute loop body, replacing the previous iteration's value
+        dm_value_free(ctx, result);
+        err = dm_eval_node(ctx, node->for_loop.body, result);
+        if (err != DM_SUCCESS || ctx->returning) {
+            *handled = true;
+            return err;
+        }
+        
+        // The body may have assigned the counter; pick up its new value. If
+        // it no longer qualifies, or an integer step would overflow, finish
+        // this iteration generically.
+        int64_t next = 0;
+        if (!counter_value(slot, integer_step, &counter) ||
+            (slot->type == DM_TYPE_INTEGER && !checked_add(counter, step, &next))) {
+            dm_value_t increment_value;
+            err = dm_eval_node(ctx, node->for_loop.increment, &increment_value);
+            dm_value_free(ctx, &increment_value);
+            *handled = (err != DM_SUCCESS);
+            return err;
+        }
+        
+        // Step the counter in place; leave huge floats to the generic loop
+        if (slot->type == DM_TYPE_INTEGER) {
+            counter = next;
+            slot->as.integer = counter;
+        } else {
+            counter += step;
+            slot->as.floating = (double)counter;
+            if (counter >= (int64_t)DM_EXACT_INT_LIMIT || counter <= -(int64_t)DM_EXACT_INT_LIMIT) {
+                return DM_SUCCESS;
             }
         }
     }
+}
+
+// Number of iterations of a counting loop from start by step while
+// `counter op limit` holds; false if it would never stop
+static bool iteration_count(int64_t start, int64_t step, dm_operator_t op, double limit, size_t *count) {
+    double first = (double)start;
+    bool runs = (op == DM_OP_LT) ? first < limit :
+                (op == DM_OP_LTE) ? first <= limit :
+                (op == DM_OP_GT) ? first > limit : first >= limit;
+    if (!runs) {
+        *count = 0;
+        return true;
+    }
     
-    // Return the last statement's result
-    *result = stmt_result;
+    bool upward = (op == DM_OP_LT || op == DM_OP_LTE);
+    if (upward != (step > 0) || limit != limit) {
+        return false;
+    }
     
-    // If no statements were executed, return NULL literal
-    if (*result == NULL) {
-        *result = create_result_node(ctx, DM_NODE_LITERAL);
-        if (*result != NULL) {
-            (*result)->literal.type = DM_LITERAL_NULL;
-        } else {
-            return DM_ERROR_MEMORY_ALLOCATION;
-        }
+    // Steps until the condition fails, counting the first iteration
+    double steps = (limit - first) / (double)step;
+    steps = (op == DM_OP_LT || op == DM_OP_GT) ? ceil(steps) : floor(steps) + 1;
+    if (steps >= DM_EXACT_INT_LIMIT) {
+        return false;
     }
     
-    return DM_SUCCESS;
+    *count = (size_t)steps;
+    return true;
 }
 
-// Execute source code
-dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_node_t **result) {
-    if (ctx == NULL || source == NULL) {
+// Parallel for loop: the iterations of a counting loop run on worker
+// threads (see lang/parallel.h). The bound is evaluated once, up front,
+// and the loop evaluates to the array of its iterations' values.
+static dm_error_t eval_parallel_for(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    dm_parallel_loop_t loop;
+    bool integer_step = false;
+    if (!counting_loop_step(node, &loop.step, &integer_step)) {
+        dm_context_set_error(ctx, "A parallel for must count: for (let i = start; i < end; i = i + step)");
         return DM_ERROR_INVALID_ARGUMENT;
     }
     
-    // Initialize parser
-    dm_parser_t parser;
-    dm_error_t err = dm_parser_init(ctx, &parser, source, source_len);
-    if (err != DM_SUCCESS) {
-        return err;
+    // Evaluate the initializer and the bound in a scope of their own
+    dm_scope_t *loop_scope = dm_scope_acquire(ctx, ctx->current_scope, node->for_loop.slot_count);
+    if (loop_scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Parse the source
-    dm_node_t *ast = NULL;
-    err = dm_parser_parse(&parser, &ast);
-    if (err != DM_SUCCESS) {
-        return err;
-    }
+    dm_scope_t *previous_scope = ctx->current_scope;
+    ctx->current_scope = loop_scope;
     
-    // Evaluate the AST
-    dm_node_t *eval_result = NULL;
-    err = dm_eval_node(ctx, ast, &eval_result);
+    loop.body = node->for_loop.body;
+    loop.slot_count = node->for_loop.slot_count;
+    loop.counter_slot = node->for_loop.init->assignment.local.slot;
     
-    // Free the AST
-    dm_node_free(ctx, ast);
+    dm_value_t init_value;
+    dm_error_t err = dm_eval_node(ctx, node->for_loop.init, &init_value);
+    dm_value_free(ctx, &init_value);
     
-    if (err != DM_SUCCESS) {
-        return err;
+    dm_value_t temp;
+    const dm_value_t *bound = NULL;
+    if (err == DM_SUCCESS) {
+        err = eval_borrowed(ctx, node->for_loop.condition->binary.right, &temp, &bound);
     }
     
-    // Return the result if requested
+    if (err == DM_SUCCESS) {
+        dm_value_t *counter = &loop_scope->slots[loop.counter_slot];
+        loop.integer = (counter->type == DM_TYPE_INTEGER);
+        
+        double limit = 0.0;
+        bool numeric = bound->type == DM_TYPE_INTEGER || bound->type == DM_TYPE_FLOAT;
+        if (numeric) {
+            limit = bound->type == DM_TYPE_INTEGER ? (double)bound->as.integer : bound->as.floating;
+        }
+        
+        if (!counter_value(counter, integer_step, &loop.start) || !numeric) {
+            dm_context_set_error(ctx, "A parallel for needs a whole number counter and a numeric bound");
+            err = DM_ERROR_TYPE_MISMATCH;
+        } else if (!iteration_count(loop.start, loop.step, node->for_loop.condition->binary.op,
+                                    limit, &loop.count)) {
+            dm_context_set_error(ctx, "A parallel for must have a finite number of iterations");
+            err = DM_ERROR_INVALID_ARGUMENT;
+        }
+        dm_value_free(ctx, &temp);
+    }
+    
+    ctx->current_scope = previous_scope;
+    dm_scope_release(ctx, loop_scope);
+    
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    return dm_parallel_for(ctx, &loop, result);
+}
+
+// For loop
+static dm_error_t eval_for(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    if (node->for_loop.parallel) {
+        return eval_parallel_for(ctx, node, result);
+    }
+    
+    // The initializer's variables live in a scope around the whole loop
+    dm_scope_t *loop_scope = dm_scope_acquire(ctx, ctx->current_scope, node->for_loop.slot_count);
+    if (loop_scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    dm_scope_t *previous_scope = ctx->current_scope;
+    ctx->current_scope = loop_scope;
+    
+    dm_error_t err = DM_SUCCESS;
+    bool done = false;
+    
+    if (node->for_loop.init != NULL) {
+        dm_value_t init_value;
+        err = dm_eval_node(ctx, node->for_loop.init, &init_value);
+        dm_value_free(ctx, &init_value);
+        done = (err != DM_SUCCESS || ctx->returning);
+    }
+    
+    // Counting loops run on an integer counter
+    int64_t step = 0;
+    bool integer_step = false;
+    if (!done && counting_loop_step(node, &step, &integer_step)) {
+        err = eval_counting_for(ctx, node, step, integer_step, result, &done);
+    }
+    
+    // Generic loop; result holds the last iteration's value
+    while (!done) {
+        if (node->for_loop.condition != NULL) {
+            dm_value_t temp;
+            const dm_value_t *condition = NULL;
+            err = eval_borrowed(ctx, node->for_loop.condition, &temp, &condition);
+            if (err != DM_SUCCESS) {
+                break;
+            }
+            
+            bool condition_true = dm_value_is_truthy(condition);
+            dm_value_free(ctx, &temp);
+            
+            if (!condition_true) {
+                break;
+            }
+        }
+        
+        err = DM_KERNEL_STEP(ctx);
+        if (err != DM_SUCCESS) {
+            break;
+        }
+        
+        dm_value_free(ctx, result);
+        err = dm_eval_node(ctx, node->for_loop.body, result);
+        if (err != DM_SUCCESS || ctx->returning) {
+            break;
+        }
+        
+        if (node->for_loop.increment != NULL) {
+            dm_value_t increment_value;
+            err = dm_eval_node(ctx, node->for_loop.increment, &increment_value);
+            dm_value_free(ctx, &increment_value);
+            if (err != DM_SUCCESS) {
+                break;
+            }
+        }
+    }
+    
+    // Restore the previous scope and return the loop scope to the pool
+    ctx->current_scope = previous_scope;
+    dm_scope_release(ctx, loop_scope);
+    
+    return err;
+}
+
+// Find the AST function a call node refers to, and the code it belongs to
+static dm_error_t lookup_function(dm_context_t *ctx, dm_node_t *node, dm_node_t **function,
+                                  dm_object_t **owner) {
+    // Named callees already validated at this call site need no lookup
+    // until a definition changes. Parallel loop workers have epochs of
+    // their own and leave the cache alone.
+    if (ctx->parent == NULL && node->call.cached_function != NULL &&
+        node->call.cache_epoch == ctx->definition_epoch) {
+        *function = node->call.cached_function;
+        *owner = node->call.cached_owner;
+        return DM_SUCCESS;
+    }
+    
+    // Borrow the function from its local slot or the scope chain
+    const dm_value_t *function_value = NULL;
+    dm_error_t err = DM_ERROR_NOT_FOUND;
+    if (node->call.local.resolved) {
+        function_value = local_slot(ctx, &node->call.local, node->call.name);
+        if (function_value != NULL) {
+            err = DM_SUCCESS;
+        }
+    } else {
+        err = dm_scope_lookup_ref(ctx, ctx->current_scope, node->call.name, &function_value);
+    }
+    if (err != DM_SUCCESS) {
+        // Function not found
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Function '%s' is not defined", node->call.name);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_UNDEFINED_VARIABLE;
+    }
+    
+    // Check if it's actually a function
+    if (function_value->type != DM_TYPE_FUNCTION) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "'%s' is not a function", node->call.name);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_TYPE_MISMATCH;
+    }
+    
+    // Get the function node from the user_data (native and bytecode
+    // functions carry a non-NULL func and cannot be evaluated here)
+    dm_node_t *function_node = function_value->as.function.user_data;
+    if (function_value->as.function.func != NULL ||
+        function_node == NULL || function_node->type != DM_NODE_FUNCTION) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Invalid function definition for '%s'", node->call.name);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_TYPE_MISMATCH;
+    }
+    
+    // Check if argument count matches parameter count
+    if (node->call.arg_count != function_node->function.param_count) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg),
+                "Function '%s' expects %zu arguments, but got %zu",
+                node->call.name,
+                function_node->function.param_count,
+                node->call.arg_count);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // Slots change without touching the epoch, so only named lookups are cached
+    if (!node->call.local.resolved && ctx->parent == NULL) {
+        node->call.cached_function = function_node;
+        node->call.cached_owner = function_value->as.function.owner;
+        node->call.cache_epoch = ctx->definition_epoch;
+    }
+    
+    *function = function_node;
+    *owner = function_value->as.function.owner;
+    return DM_SUCCESS;
+}
+
+// Evaluate the arguments of a call into a fresh parameter scope
+static dm_error_t bind_arguments(dm_context_t *ctx, dm_node_t *node, dm_node_t *function_node,
+                                 dm_scope_t **scope) {
+    // Take a pooled scope for the call; resolved parameters live in its slots
+    bool resolved = function_node->function.resolved;
+    dm_scope_t *function_scope = dm_scope_acquire(ctx, ctx->current_scope,
+                                                  resolved ? function_node->function.param_count : 0);
+    if (function_scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Evaluate and bind arguments to parameters
+    for (size_t i = 0; i < node->call.arg_count; i++) {
+        dm_error_t err;
+        if (resolved) {
+            // Evaluate straight into the parameter slot
+            err = dm_eval_node(ctx, node->call.args[i], &function_scope->slots[i]);
+        } else {
+            dm_value_t arg_value;
+            err = dm_eval_node(ctx, node->call.args[i], &arg_value);
+            if (err == DM_SUCCESS) {
+                err = dm_scope_define(ctx, function_scope, function_node->function.params[i], arg_value);
+                dm_value_free(ctx, &arg_value);
+            }
+        }
+        
+        if (err != DM_SUCCESS) {
+            dm_scope_release(ctx, function_scope);
+            return err;
+        }
+    }
+    
+    *scope = function_scope;
+    return DM_SUCCESS;
+}
+
+// Push a frame on the call stack, enforcing the depth limit
+static dm_error_t push_call_frame(dm_context_t *ctx, dm_node_t *function_node, dm_scope_t *scope) {
+    if (ctx->call_depth >= ctx->max_call_depth) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Maximum call depth of %zu exceeded in '%s'",
+                ctx->max_call_depth, function_node->function.name);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_STACK_OVERFLOW;
+    }
+    
+    // Non-tail calls recurse on the C stack, which may run out before the
+    // depth limit does (large --max-depth, small helper thread stacks)
+    if (dm_kernel_stack_low()) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "Out of stack after %zu nested calls in '%s'",
+                ctx->call_depth, function_node->function.name);
+        dm_context_set_error(ctx, error_msg);
+        return DM_ERROR_STACK_OVERFLOW;
+    }
+    
+    if (ctx->call_depth >= ctx->call_capacity) {
+        size_t new_capacity = ctx->call_capacity == 0 ? 16 : ctx->call_capacity * 2;
+        dm_call_frame_t *frames = dm_realloc(ctx, ctx->call_stack, new_capacity * sizeof(dm_call_frame_t));
+        if (frames == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        ctx->call_stack = frames;
+        ctx->call_capacity = new_capacity;
+    }
+    
+    dm_call_frame_t *frame = &ctx->call_stack[ctx->call_depth++];
+    frame->name = function_node->function.name;
+    frame->scope = scope;
+    frame->tail_function = NULL;
+    frame->tail_scope = NULL;
+    return DM_SUCCESS;
+}
+
+// Memo calls waiting for their result. Calls joined by tail calls share
+// one frame and one result, which is stored for each of them at the end.
+typedef struct {
+    dm_node_t *function;
+    dm_value_t *key;        // Argument values, copied before the body can reassign them
+} dm_memo_pending_t;
+
+typedef struct {
+    dm_memo_pending_t *calls;
+    size_t count;
+    size_t capacity;
+} dm_memo_chain_t;
+
+// Consult the result cache of a memo function about to run with the bound
+// arguments. A miss is remembered in chain so its result can be stored.
+static dm_error_t memo_begin(dm_context_t *ctx, dm_memo_chain_t *chain, dm_node_t *function_node,
+                             dm_scope_t *function_scope, dm_value_t *result, bool *hit) {
+    size_t arity = function_node->function.param_count;
+    *hit = false;
+    
+    // Parameters must live in slots and be usable as a key. Caches are not
+    // shared with parallel loop workers.
+    if (!function_node->function.memoize || !function_node->function.resolved || ctx->parent != NULL ||
+        !dm_memo_cacheable(function_scope->slots, arity)) {
+        return DM_SUCCESS;
+    }
+    
+    if (function_node->function.memo == NULL) {
+        dm_error_t err = dm_memo_create(ctx, arity, DM_MEMO_CAPACITY, &function_node->function.memo);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+    
+    const dm_value_t *cached = dm_memo_lookup(function_node->function.memo, function_scope->slots);
+    if (cached != NULL) {
+        ctx->memo_hits++;
+        dm_value_copy(ctx, result, cached);
+        *hit = true;
+        return DM_SUCCESS;
+    }
+    
+    ctx->memo_misses++;
+    
+    // The pending calls and their keys are scratch of the calling statement;
+    // the table keeps copies of what it stores
+    if (chain->count >= chain->capacity) {
+        size_t new_capacity = chain->capacity == 0 ? 4 : chain->capacity * 2;
+        dm_memo_pending_t *calls = dm_arena_alloc(ctx, new_capacity * sizeof(dm_memo_pending_t));
+        if (calls == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        if (chain->count > 0) {
+            memcpy(calls, chain->calls, chain->count * sizeof(dm_memo_pending_t));
+        }
+        chain->calls = calls;
+        chain->capacity = new_capacity;
+    }
+    
+    dm_value_t *key = NULL;
+    if (arity > 0) {
+        key = dm_arena_alloc(ctx, arity * sizeof(dm_value_t));
+        if (key == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        for (size_t i = 0; i < arity; i++) {
+            dm_value_init(&key[i]);
+            dm_value_copy(ctx, &key[i], &function_scope->slots[i]);
+        }
+    }
+    
+    chain->calls[chain->count].function = function_node;
+    chain->calls[chain->count].key = key;
+    chain->count++;
+    return DM_SUCCESS;
+}
+
+// Cache the result for every pending memo call (unless the call failed)
+static dm_error_t memo_finish(dm_context_t *ctx, dm_memo_chain_t *chain, const dm_value_t *result,
+                              dm_error_t err) {
+    for (size_t i = 0; i < chain->count; i++) {
+        dm_node_t *function_node = chain->calls[i].function;
+        dm_value_t *key = chain->calls[i].key;
+        
+        if (err == DM_SUCCESS) {
+            err = dm_memo_store(ctx, function_node->function.memo, key, result);
+        }
+        
+        if (key != NULL) {
+            for (size_t j = 0; j < function_node->function.param_count; j++) {
+                dm_value_free(ctx, &key[j]);
+            }
+        }
+    }
+    
+    return err;
+}
+
+// Function call
+static dm_error_t eval_function_call(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    dm_node_t *function_node = NULL;
+    dm_object_t *owner = NULL;
+    dm_error_t err = lookup_function(ctx, node, &function_node, &owner);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    dm_scope_t *function_scope = NULL;
+    err = bind_arguments(ctx, node, function_node, &function_scope);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // A generator's body runs later, one item at a time
+    if (function_node->function.generator) {
+        return dm_generator_create(ctx, function_node, owner, function_scope, result);
+    }
+    
+    // Memo functions skip the body for argument lists they have seen
+    dm_memo_chain_t memo = {NULL, 0, 0};
+    bool hit = false;
+    err = memo_begin(ctx, &memo, function_node, function_scope, result, &hit);
+    if (err == DM_SUCCESS && !hit) {
+        err = push_call_frame(ctx, function_node, function_scope);
+    }
+    if (err != DM_SUCCESS || hit) {
+        dm_scope_release(ctx, function_scope);
+        return memo_finish(ctx, &memo, result, err);
+    }
+    if (ctx->profiler != NULL) {
+        dm_profile_call_begin(ctx->profiler, function_node->function.name);
+    }
+    
+    // Save previous scope; the call runs in the function scope
+    dm_scope_t *previous_scope = ctx->current_scope;
+    size_t depth = ctx->call_depth;
+    
+    for (;;) {
+        ctx->current_scope = function_scope;
+        
+        // Execute function body; each call, tail calls included, is a step
+        err = DM_KERNEL_STEP(ctx);
+        if (err == DM_SUCCESS) {
+            err = dm_eval_node(ctx, function_node->function.body, result);
+        }
+        
+        // A return statement stops unwinding at the call boundary
+        ctx->returning = false;
+        
+        // A `return f(...)` leaves its callee and arguments in the frame.
+        // Run it in place of this call so tail recursion keeps one frame.
+        dm_call_frame_t *frame = &ctx->call_stack[depth - 1];
+        if (frame->tail_function == NULL || err != DM_SUCCESS) {
+            break;
+        }
+        
+        dm_scope_release(ctx, function_scope);
+        function_node = frame->tail_function;
+        function_scope = frame->tail_scope;
+        function_scope->parent = previous_scope;
+        
+        frame->name = function_node->function.name;
+        frame->scope = function_scope;
+        frame->tail_function = NULL;
+        frame->tail_scope = NULL;
+        
+        // Profiles show the tail callee as a call of its own
+        if (ctx->profiler != NULL) {
+            dm_profile_call_end(ctx->profiler);
+            dm_profile_call_begin(ctx->profiler, function_node->function.name);
+        }
+        
+        dm_value_free(ctx, result);
+        
+        err = memo_begin(ctx, &memo, function_node, function_scope, result, &hit);
+        if (err != DM_SUCCESS || hit) {
+            break;
+        }
+    }
+    
+    // Pop the frame, dropping a tail call abandoned by an error
+    dm_call_frame_t *frame = &ctx->call_stack[--ctx->call_depth];
+    if (ctx->profiler != NULL) {
+        dm_profile_call_end(ctx->profiler);
+    }
+    if (frame->tail_scope != NULL) {
+        dm_scope_release(ctx, frame->tail_scope);
+    }
+    
+    // Restore previous scope and return the function scope to the pool
+    ctx->current_scope = previous_scope;
+    dm_scope_release(ctx, function_scope);
+    
+    return memo_finish(ctx, &memo, result, err);
+}
+
+// Whether a call in tail position may reuse the current frame. Scopes of
+// the caller that hold named symbols stay visible to a callee through the
+// scope chain, so dropping them early is only safe when there are none.
+static bool tail_call_allowed(dm_context_t *ctx) {
+    if (ctx->call_depth == 0) {
+        return false;
+    }
+    
+    dm_scope_t *frame_scope = ctx->call_stack[ctx->call_depth - 1].scope;
+    for (dm_scope_t *scope = ctx->current_scope; scope != NULL; scope = scope->parent) {
+        if (scope->symbols != NULL) {
+            return false;
+        }
+        if (scope == frame_scope) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Prepare `return f(...)`: bind the callee's arguments and leave the call
+// for the enclosing eval_function_call to run once this body has unwound.
+// A generator callee has no body to run now and is created in place.
+static dm_error_t eval_tail_call(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    dm_node_t *function_node = NULL;
+    dm_object_t *owner = NULL;
+    dm_error_t err = lookup_function(ctx, node, &function_node, &owner);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    dm_scope_t *function_scope = NULL;
+    err = bind_arguments(ctx, node, function_node, &function_scope);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    if (function_node->function.generator) {
+        return dm_generator_create(ctx, function_node, owner, function_scope, result);
+    }
+    
+    dm_call_frame_t *frame = &ctx->call_stack[ctx->call_depth - 1];
+    frame->tail_function = function_node;
+    frame->tail_scope = function_scope;
+    return DM_SUCCESS;
+}
+
+// Function declaration
+static dm_error_t eval_function_declaration(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    // Store the function in the current scope
+    dm_value_t function_value;
+    dm_value_init(&function_value);
+    
+    function_value.type = DM_TYPE_FUNCTION;
+    function_value.as.function.func = NULL; // Not a native function
+    function_value.as.function.user_data = node; // Store the function node as user data
+    function_value.as.function.owner = ctx->program;  // Referenced by the stored copy
+    
+    dm_error_t err = dm_scope_define(ctx, ctx->current_scope, node->function.name, function_value);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Return the function name as result
+    return dm_value_set_string(ctx, result, node->function.name, strlen(node->function.name));
+}
+
+// Return statement
+static dm_error_t eval_return(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    // A returned call reuses the current frame when nothing else needs it
+    dm_node_t *value = node->return_stmt.value;
+    if (value != NULL && value->type == DM_NODE_CALL && tail_call_allowed(ctx)) {
+        dm_error_t err = eval_tail_call(ctx, value, result);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    } else if (value != NULL) {
+        // Evaluate the return value (otherwise the result stays null)
+        dm_error_t err = dm_eval_node(ctx, value, result);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+    
+    // Unwind enclosing blocks and loops up to the function call
+    ctx->returning = true;
+    return DM_SUCCESS;
+}
+
+// Execute a program (sequence of statements)
+static dm_error_t eval_program(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    // Execute all statements in sequence, keeping only the last result
+    for (size_t i = 0; i < node->program.count; i++) {
+        dm_value_free(ctx, result);
+        
+        // Scratch memory of a statement is released when it ends
+        dm_arena_mark_t scratch = dm_arena_begin(ctx);
+        dm_error_t err = dm_eval_node(ctx, node->program.statements[i], result);
+        dm_arena_end(ctx, scratch);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+        
+        // A top-level return ends the script
+        if (ctx->returning) {
+            ctx->returning = false;
+            break;
+        }
+        
+        // Print the result if it's an expression statement
+        if (node->program.statements[i]->type != DM_NODE_ASSIGNMENT
+            && node->program.statements[i]->type != DM_NODE_FUNCTION) {
+            char buffer[64];
+            const char *text = value_text(result, buffer, sizeof(buffer));
+            if (text != NULL) {
+                fprintf(ctx->output, "=> %s\n", text);
+            }
+        }
+    }
+    
+    return DM_SUCCESS;
+}
+
+static void release_program(dm_context_t *ctx, void *data) {
+    dm_node_free(ctx, data);
+}
+
+// Execute source code
+dm_error_t dm_execute_source(dm_context_t *ctx, const char *source, size_t source_len, dm_value_t *result) {
+    if (result != NULL) {
+        dm_value_init(result);
+    }
+    if (ctx == NULL || source == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // Initialize parser
+    dm_parser_t parser;
+    dm_error_t err = dm_parser_init(ctx, &parser, source, source_len);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Parse the source
+    dm_node_t *ast = NULL;
+    err = dm_parser_parse(&parser, &ast);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Fold constants, then resolve locals to slots
+    err = dm_optimize(ctx, ast);
+    if (err == DM_SUCCESS) {
+        err = dm_resolve(ctx, ast);
+    }
+    if (err != DM_SUCCESS) {
+        dm_node_free(ctx, ast);
+        return err;
+    }
+    
+    // In threaded mode the program runs as pre-decoded bytecode; programs
+    // the compiler cannot handle fall back to the tree walker
+    if (ctx->threaded) {
+        dm_bc_module_t *module = NULL;
+        err = dm_bc_compile(ctx, ast, &module);
+        if (err == DM_SUCCESS) {
+            // The VM owns the module from here on
+            dm_node_free(ctx, ast);
+            return dm_vm_execute(ctx, module, result);
+        }
+        if (err != DM_ERROR_NOT_SUPPORTED) {
+            dm_node_free(ctx, ast);
+            return err;
+        }
+    }
+    
+    // Functions the program declares refer to its AST and keep it alive
+    dm_object_t *program = dm_code_create(ctx, ast, release_program);
+    if (program == NULL) {
+        dm_node_free(ctx, ast);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Evaluate the AST under the context's step budget and time limit
+    err = dm_kernel_begin_run(ctx);
+    if (err != DM_SUCCESS) {
+        dm_object_release(ctx, program);
+        return err;
+    }
+    
+    dm_value_t eval_result;
+    dm_object_t *outer_program = ctx->program;
+    ctx->program = program;
+    ctx->returning = false;
+    err = dm_eval_node(ctx, ast, &eval_result);
+    ctx->program = outer_program;
+    dm_kernel_end_run(ctx);
+    
+    // The AST goes now unless functions it declared are still referenced
+    dm_object_release(ctx, program);
+    
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Return the result if requested
     if (result != NULL) {
         *result = eval_result;
     } else {
-        dm_node_free(ctx, eval_result);
+        dm_value_free(ctx, &eval_result);
     }
     
     return DM_SUCCESS;
@@ -1122,6 +1542,16 @@ dm_error_t dm_node_to_string(dm_context_t *ctx, dm_node_t *node, char **str) {
                 break;
             }
             
+            case DM_LITERAL_INTEGER: {
+                char buffer[64];
+                snprintf(buffer, sizeof(buffer), "%" PRId64, node->literal.value.integer);
+                *str = dm_strdup(ctx, buffer);
+                if (*str == NULL) {
+                    return DM_ERROR_MEMORY_ALLOCATION;
+                }
+                break;
+            }
+            
             case DM_LITERAL_STRING:
                 // Just copy the string
                 *str = dm_strdup(ctx, node->literal.value.string);
@@ -1158,4 +1588,422 @@ dm_error_t dm_node_to_string(dm_context_t *ctx, dm_node_t *node, char **str) {
     }
     
     return DM_SUCCESS;
-} 
\ No newline at end of file
+} 
+
+// Read a numeric operand (booleans count as 0/1 in arithmetic)
+static bool value_as_number(const dm_value_t *value, double *number) {
+    switch (value->type) {
+        case DM_TYPE_INTEGER:
+            *number = (double)value->as.integer;
+            return true;
+        case DM_TYPE_FLOAT:
+            *number = value->as.floating;
+            return true;
+        case DM_TYPE_BOOLEAN:
+            *number = value->as.boolean ? 1.0 : 0.0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool value_is_numeric(const dm_value_t *value) {
+    return value->type == DM_TYPE_INTEGER || value->type == DM_TYPE_FLOAT;
+}
+
+// Equality of two values (different types are never equal, except integer/float)
+static bool values_equal(const dm_value_t *left, const dm_value_t *right) {
+    if (left->type == DM_TYPE_INTEGER && right->type == DM_TYPE_INTEGER) {
+        return left->as.integer == right->as.integer;
+    }
+    
+    if (value_is_numeric(left) && value_is_numeric(right)) {
+        double l = 0.0, r = 0.0;
+        value_as_number(left, &l);
+        value_as_number(right, &r);
+        return l == r;
+    }
+    
+    if (left->type != right->type) {
+        return false;
+    }
+    
+    switch (left->type) {
+        case DM_TYPE_NULL:
+            return true;
+        case DM_TYPE_BOOLEAN:
+            return left->as.boolean == right->as.boolean;
+        case DM_TYPE_STRING:
+            // Copies of one literal share their data
+            if (left->as.string.data == right->as.string.data) {
+                return true;
+            }
+            return left->as.string.length == right->as.string.length &&
+                   memcmp(left->as.string.data, right->as.string.data, left->as.string.length) == 0;
+        default:
+            // Compound values have no value equality yet
+            return false;
+    }
+}
+
+// Arithmetic on two integers. Results stay integers while they are exact;
+// overflow and inexact division produce a double instead.
+static dm_error_t integer_arithmetic(dm_context_t *ctx, dm_operator_t op, int64_t l, int64_t r,
+                                     dm_value_t *result) {
+    int64_t value = 0;
+    bool exact = false;
+    
+    switch (op) {
+        case DM_OP_ADD:
+            exact = checked_add(l, r, &value);
+            break;
+        case DM_OP_SUB:
+            exact = checked_sub(l, r, &value);
+            break;
+        case DM_OP_MUL:
+            exact = checked_mul(l, r, &value);
+            break;
+        case DM_OP_DIV:
+            if (r == 0) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), "Division by zero");
+                return DM_ERROR_DIVISION_BY_ZERO;
+            }
+            exact = r != -1 ? l % r == 0 : l != INT64_MIN;
+            value = exact ? l / r : 0;
+            break;
+        default:
+            if (r == 0) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), "Modulo by zero");
+                return DM_ERROR_DIVISION_BY_ZERO;
+            }
+            // Like fmod, the result takes the sign of the dividend
+            exact = true;
+            value = r == -1 ? 0 : l % r;
+            break;
+    }
+    
+    if (exact) {
+        result->type = DM_TYPE_INTEGER;
+        result->as.integer = value;
+        return DM_SUCCESS;
+    }
+    
+    double a = (double)l;
+    double b = (double)r;
+    result->type = DM_TYPE_FLOAT;
+    result->as.floating = (op == DM_OP_ADD) ? a + b :
+                          (op == DM_OP_SUB) ? a - b :
+                          (op == DM_OP_MUL) ? a * b : a / b;
+    return DM_SUCCESS;
+}
+
+// Apply a binary operator to two values
+dm_error_t dm_value_binary_op(dm_context_t *ctx, dm_operator_t op, const dm_value_t *left,
+                              const dm_value_t *right, dm_value_t *result) {
+    if (ctx == NULL || left == NULL || right == NULL || result == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_value_init(result);
+    
+    switch (op) {
+        case DM_OP_ADD:
+        case DM_OP_SUB:
+        case DM_OP_MUL:
+        case DM_OP_DIV:
+        case DM_OP_MOD: {
+            // String concatenation
+            if (op == DM_OP_ADD && left->type == DM_TYPE_STRING && right->type == DM_TYPE_STRING) {
+                size_t length = left->as.string.length + right->as.string.length;
+                char *joined = dm_rc_alloc(ctx, length + 1);
+                if (joined == NULL) {
+                    return DM_ERROR_MEMORY_ALLOCATION;
+                }
+                
+                memcpy(joined, left->as.string.data, left->as.string.length);
+                memcpy(joined + left->as.string.length, right->as.string.data, right->as.string.length + 1);
+                
+                result->type = DM_TYPE_STRING;
+                result->as.string.data = joined;
+                result->as.string.length = length;
+                result->as.string.capacity = length;
+                return DM_SUCCESS;
+            }
+            
+            if (left->type == DM_TYPE_INTEGER && right->type == DM_TYPE_INTEGER) {
+                return integer_arithmetic(ctx, op, left->as.integer, right->as.integer, result);
+            }
+            
+            double l = 0.0, r = 0.0;
+            if (!value_as_number(left, &l)) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), 
+                        "Cannot perform arithmetic on non-numeric left operand");
+                return DM_ERROR_TYPE_MISMATCH;
+            }
+            if (!value_as_number(right, &r)) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), 
+                        "Cannot perform arithmetic on non-numeric right operand");
+                return DM_ERROR_TYPE_MISMATCH;
+            }
+            
+            result->type = DM_TYPE_FLOAT;
+            switch (op) {
+                case DM_OP_ADD:
+                    result->as.floating = l + r;
+                    break;
+                case DM_OP_SUB:
+                    result->as.floating = l - r;
+                    break;
+                case DM_OP_MUL:
+                    result->as.floating = l * r;
+                    break;
+                case DM_OP_DIV:
+                    if (r == 0.0) {
+                        snprintf(ctx->error_message, sizeof(ctx->error_message), "Division by zero");
+                        result->type = DM_TYPE_NULL;
+                        return DM_ERROR_DIVISION_BY_ZERO;
+                    }
+                    result->as.floating = l / r;
+                    break;
+                default:
+                    if (r == 0.0) {
+                        snprintf(ctx->error_message, sizeof(ctx->error_message), "Modulo by zero");
+                        result->type = DM_TYPE_NULL;
+                        return DM_ERROR_DIVISION_BY_ZERO;
+                    }
+                    result->as.floating = fmod(l, r);
+                    break;
+            }
+            return DM_SUCCESS;
+        }
+            
+        case DM_OP_EQ:
+        case DM_OP_NEQ: {
+            bool equal = values_equal(left, right);
+            result->type = DM_TYPE_BOOLEAN;
+            result->as.boolean = (op == DM_OP_EQ) ? equal : !equal;
+            return DM_SUCCESS;
+        }
+            
+        case DM_OP_LT:
+        case DM_OP_GT:
+        case DM_OP_LTE:
+        case DM_OP_GTE: {
+            // Operands must be numbers
+            if (!value_is_numeric(left) || !value_is_numeric(right)) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), 
+                        "Expected numeric operands for comparison");
+                return DM_ERROR_TYPE_MISMATCH;
+            }
+            
+            result->type = DM_TYPE_BOOLEAN;
+            if (left->type == DM_TYPE_INTEGER && right->type == DM_TYPE_INTEGER) {
+                int64_t l = left->as.integer;
+                int64_t r = right->as.integer;
+                result->as.boolean = (op == DM_OP_LT) ? l < r :
+                                     (op == DM_OP_GT) ? l > r :
+                                     (op == DM_OP_LTE) ? l <= r : l >= r;
+                return DM_SUCCESS;
+            }
+            
+            double l = 0.0, r = 0.0;
+            value_as_number(left, &l);
+            value_as_number(right, &r);
+            
+            switch (op) {
+                case DM_OP_LT:
+                    result->as.boolean = l < r;
+                    break;
+                case DM_OP_GT:
+                    result->as.boolean = l > r;
+                    break;
+                case DM_OP_LTE:
+                    result->as.boolean = l <= r;
+                    break;
+                default:
+                    result->as.boolean = l >= r;
+                    break;
+            }
+            return DM_SUCCESS;
+        }
+            
+        case DM_OP_AND:
+        case DM_OP_OR: {
+            bool l = dm_value_is_truthy(left);
+            bool r = dm_value_is_truthy(right);
+            
+            result->type = DM_TYPE_BOOLEAN;
+            result->as.boolean = (op == DM_OP_AND) ? (l && r) : (l || r);
+            return DM_SUCCESS;
+        }
+            
+        default:
+            snprintf(ctx->error_message, sizeof(ctx->error_message), 
+                    "Unsupported binary operator: %d", op);
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+// base + parts[0] + ... for an assignment to target; see exec.h
+dm_error_t dm_value_concat(dm_context_t *ctx, dm_value_t *target, dm_value_t *base,
+                           const dm_value_t *parts, size_t count, dm_value_t *result) {
+    if (ctx == NULL || base == NULL || (parts == NULL && count > 0) || result == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_value_init(result);
+    
+    // The parts cannot have changed target if it still shares base's buffer
+    bool in_place = target != NULL && base->type == DM_TYPE_STRING && target->type == DM_TYPE_STRING &&
+                    target->as.string.data == base->as.string.data &&
+                    target->as.string.length == base->as.string.length;
+    for (size_t i = 0; in_place && i < count; i++) {
+        in_place = parts[i].type == DM_TYPE_STRING;
+    }
+    
+    if (in_place) {
+        // Drop base's reference so target is normally the sole owner
+        dm_value_free(ctx, base);
+        for (size_t i = 0; i < count; i++) {
+            dm_error_t err = dm_value_string_append(ctx, target, parts[i].as.string.data,
+                                                    parts[i].as.string.length);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+        }
+        
+        dm_value_copy(ctx, result, target);
+        return DM_SUCCESS;
+    }
+    
+    // Otherwise add left to right like the plain expression
+    dm_value_t sum = *base;
+    dm_value_init(base);
+    for (size_t i = 0; i < count; i++) {
+        dm_value_t next;
+        dm_error_t err = dm_value_binary_op(ctx, DM_OP_ADD, &sum, &parts[i], &next);
+        dm_value_free(ctx, &sum);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+        sum = next;
+    }
+    
+    *result = sum;
+    return DM_SUCCESS;
+}
+
+// Apply a unary operator to a value
+dm_error_t dm_value_unary_op(dm_context_t *ctx, dm_operator_t op, const dm_value_t *operand, dm_value_t *result) {
+    if (ctx == NULL || operand == NULL || result == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_value_init(result);
+    
+    switch (op) {
+        case DM_OP_NEG:
+            // Only numbers can be negated
+            if (operand->type == DM_TYPE_INTEGER && operand->as.integer != INT64_MIN) {
+                result->type = DM_TYPE_INTEGER;
+                result->as.integer = -operand->as.integer;
+            } else if (operand->type == DM_TYPE_INTEGER) {
+                // -INT64_MIN does not fit
+                result->type = DM_TYPE_FLOAT;
+                result->as.floating = -(double)operand->as.integer;
+            } else if (operand->type == DM_TYPE_FLOAT) {
+                result->type = DM_TYPE_FLOAT;
+                result->as.floating = -operand->as.floating;
+            } else {
+                return DM_ERROR_TYPE_MISMATCH;
+            }
+            return DM_SUCCESS;
+            
+        case DM_OP_NOT:
+            // Only booleans can be logically negated
+            if (operand->type != DM_TYPE_BOOLEAN) {
+                return DM_ERROR_TYPE_MISMATCH;
+            }
+            result->type = DM_TYPE_BOOLEAN;
+            result->as.boolean = !operand->as.boolean;
+            return DM_SUCCESS;
+            
+        default:
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+// Check whether a value counts as true in a condition
+bool dm_value_is_truthy(const dm_value_t *value) {
+    if (value == NULL) {
+        return false;
+    }
+    
+    switch (value->type) {
+        case DM_TYPE_NULL:
+            return false;
+        case DM_TYPE_BOOLEAN:
+            return value->as.boolean;
+        case DM_TYPE_INTEGER:
+            return value->as.integer != 0;
+        case DM_TYPE_FLOAT:
+            return value->as.floating != 0;
+        case DM_TYPE_STRING:
+            return value->as.string.data != NULL && value->as.string.length > 0;
+        default:
+            // Compound values are always true
+            return true;
+    }
+}
+
+// Text of a value: its string data, a constant, or formatted into buffer
+static const char* value_text(const dm_value_t *value, char *buffer, size_t size) {
+    const char *text = buffer;
+    
+    switch (value->type) {
+        case DM_TYPE_NULL:
+            text = "null";
+            break;
+        case DM_TYPE_BOOLEAN:
+            text = value->as.boolean ? "true" : "false";
+            break;
+        case DM_TYPE_INTEGER:
+            snprintf(buffer, size, "%" PRId64, value->as.integer);
+            break;
+        case DM_TYPE_FLOAT:
+            snprintf(buffer, size, "%f", value->as.floating);
+            break;
+        case DM_TYPE_STRING:
+            text = value->as.string.data;
+            break;
+        case DM_TYPE_ARRAY:
+            snprintf(buffer, size, "[array of %zu]", value->as.array.length);
+            break;
+        case DM_TYPE_MATRIX:
+            snprintf(buffer, size, "[matrix %zux%zu]", value->as.matrix.rows, value->as.matrix.cols);
+            break;
+        case DM_TYPE_FUNCTION:
+            text = "[function]";
+            break;
+        default:
+            text = "[object]";
+            break;
+    }
+    
+    return text;
+}
+
+// Convert value to string representation
+dm_error_t dm_value_to_string(dm_context_t *ctx, const dm_value_t *value, char **str) {
+    if (ctx == NULL || value == NULL || str == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    char buffer[64];
+    *str = dm_strdup(ctx, value_text(value, buffer, sizeof(buffer)));
+    if (*str == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return DM_SUCCESS;
+}
@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/generator.h"
+#include "../../include/lang/exec.h"
+
+// Start iterating over a value
+dm_error_t dm_iterator_init(dm_context_t *ctx, dm_iterator_t *iterator, const dm_value_t *iterable) {
+    if (ctx == NULL || iterator == NULL || iterable == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_value_init(&iterator->source);
+    iterator->index = 0;
+
+    bool iterable_type = iterable->type == DM_TYPE_ARRAY || iterable->type == DM_TYPE_STRING ||
+                         (iterable->type == DM_TYPE_OBJECT && iterable->as.object->next != NULL);
+    if (!iterable_type) {
+        dm_context_set_error(ctx, "Value is not iterable");
+        return DM_ERROR_TYPE_MISMATCH;
+    }
+
+    // Holding a reference keeps arrays and strings unchanged for the loop
+    dm_value_copy(ctx, &iterator->source, iterable);
+    return DM_SUCCESS;
+}
+
+// Produce the next item of an iteration
+dm_error_t dm_iterator_next(dm_context_t *ctx, dm_iterator_t *iterator, dm_value_t *item, bool *done) {
+    if (ctx == NULL || iterator == NULL || item == NULL || done == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_value_t *source = &iterator->source;
+    *done = false;
+
+    switch (source->type) {
+        case DM_TYPE_ARRAY:
+            if (iterator->index >= source->as.array.length) {
+                break;
+            }
+            return dm_value_array_get(ctx, source, iterator->index++, item);
+
+        case DM_TYPE_STRING:
+            if (iterator->index >= source->as.string.length) {
+                break;
+            }
+            return dm_value_set_string(ctx, item, source->as.string.data + iterator->index++, 1);
+
+        case DM_TYPE_OBJECT: {
+            dm_value_free(ctx, item);
+            dm_error_t err = source->as.object->next(ctx, source->as.object, item, done);
+            if (err != DM_SUCCESS || *done) {
+                // Exhausted or failed objects are not asked again
+                dm_value_free(ctx, source);
+            }
+            return err;
+        }
+
+        default:
+            break;
+    }
+
+    dm_value_free(ctx, item);
+    dm_value_free(ctx, source);
+    *done = true;
+    return DM_SUCCESS;
+}
+
+void dm_iterator_free(dm_context_t *ctx, dm_iterator_t *iterator) {
+    if (ctx == NULL || iterator == NULL) {
+        return;
+    }
+    dm_value_free(ctx, &iterator->source);
+}
+
+// Store the item of a for-of iteration in the loop variable
+static dm_error_t bind_item(dm_context_t *ctx, dm_node_t *node, dm_scope_t *scope, dm_value_t item) {
+    if (!node->for_each.local.resolved) {
+        dm_error_t err = dm_scope_define(ctx, scope, node->for_each.name, item);
+        dm_value_free(ctx, &item);
+        return err;
+    }
+
+    dm_value_t *slot = &scope->slots[node->for_each.local.slot];
+    dm_value_free(ctx, slot);
+    *slot = item;
+    return DM_SUCCESS;
+}
+
+// For-of loop; result holds the last iteration's value
+dm_error_t dm_eval_for_each(dm_context_t *ctx, dm_node_t *node, dm_value_t *result) {
+    if (ctx == NULL || node == NULL || result == NULL || node->type != DM_NODE_FOR_EACH) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_value_t iterable;
+    dm_error_t err = dm_eval_node(ctx, node->for_each.iterable, &iterable);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    dm_iterator_t iterator;
+    err = dm_iterator_init(ctx, &iterator, &iterable);
+    dm_value_free(ctx, &iterable);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    dm_scope_t *loop_scope = dm_scope_acquire(ctx, ctx->current_scope, node->for_each.slot_count);
+    if (loop_scope == NULL) {
+        dm_iterator_free(ctx, &iterator);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    dm_scope_t *previous_scope = ctx->current_scope;
+
+    while (1) {
+        // Items are fetched in the caller's scope, as the iterable was made there
+        ctx->current_scope = previous_scope;
+        dm_value_t item;
+        dm_value_init(&item);
+        bool done = false;
+        err = dm_iterator_next(ctx, &iterator, &item, &done);
+        ctx->current_scope = loop_scope;
+        if (err != DM_SUCCESS || done) {
+            dm_value_free(ctx, &item);
+            break;
+        }
+
+        err = bind_item(ctx, node, loop_scope, item);
+        if (err == DM_SUCCESS) {
+            err = DM_KERNEL_STEP(ctx);
+        }
+        if (err != DM_SUCCESS) {
+            break;
+        }
+
+        // Execute loop body, replacing the previous iteration's value
+        dm_value_free(ctx, result);
+        err = dm_eval_node(ctx, node->for_each.body, result);
+        if (err != DM_SUCCESS || ctx->returning) {
+            break;
+        }
+    }
+
+    ctx->current_scope = previous_scope;
+    dm_scope_release(ctx, loop_scope);
+    dm_iterator_free(ctx, &iterator);
+    return err;
+}
+
+// A statement of the generator body that is still running. Only statements
+// that contain other statements get a frame; the rest run to completion.
+typedef struct {
+    dm_node_t *node;
+    size_t step;                // Progress through node (statement index, loop phase)
+    dm_scope_t *scope;          // Scope the frame opened, or NULL
+    dm_iterator_t iterator;     // Source of a for-of loop
+} dm_generator_frame_t;
+
+typedef struct {
+    dm_object_t object;
+    dm_node_t *function;
+    dm_object_t *code;          // Keeps function alive (see dm_code_create), or NULL
+    dm_context_t *owner;        // Context (thread) that created the generator
+    dm_scope_t *params;         // Parameter scope, the outermost of the body
+    dm_scope_t *scope;          // Innermost open scope while suspended
+    dm_generator_frame_t *frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    bool running;
+    bool finished;
+} dm_generator_t;
+
+// Phases of loop frames
+enum {
+    LOOP_START = 0,             // Open the loop scope, run the initializer
+    LOOP_TEST,                  // Check the condition or fetch the next item
+    LOOP_UPDATE                 // The body finished; run the update clause
+};
+
+static dm_error_t push_frame(dm_context_t *ctx, dm_generator_t *gen, dm_node_t *node) {
+    if (gen->frame_count >= gen->frame_capacity) {
+        size_t new_capacity = gen->frame_capacity == 0 ? 8 : gen->frame_capacity * 2;
+        dm_generator_frame_t *frames = dm_realloc(ctx, gen->frames, new_capacity * sizeof(dm_generator_frame_t));
+        if (frames == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        gen->frames = frames;
+        gen->frame_capacity = new_capacity;
+    }
+
+    dm_generator_frame_t *frame = &gen->frames[gen->frame_count++];
+    frame->node = node;
+    frame->step = LOOP_START;
+    frame->scope = NULL;
+    dm_value_init(&frame->iterator.source);
+    frame->iterator.index = 0;
+    return DM_SUCCESS;
+}
+
+// Open a scope for the innermost frame, as the evaluator does for the node
+static dm_error_t open_scope(dm_context_t *ctx, dm_generator_frame_t *frame, size_t slot_count) {
+    frame->scope = dm_scope_acquire(ctx, ctx->current_scope, slot_count);
+    if (frame->scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    ctx->current_scope = frame->scope;
+    return DM_SUCCESS;
+}
+
+static void pop_frame(dm_context_t *ctx, dm_generator_t *gen) {
+    dm_generator_frame_t *frame = &gen->frames[--gen->frame_count];
+    if (frame->scope != NULL) {
+        ctx->current_scope = frame->scope->parent;
+        dm_scope_release(ctx, frame->scope);
+    }
+    dm_iterator_free(ctx, &frame->iterator);
+}
+
+// Drop every frame and the parameter scope; the generator yields no more
+static void finish(dm_context_t *ctx, dm_generator_t *gen) {
+    // Frames release their scopes innermost first, starting from the
+    // generator's own innermost scope
+    dm_scope_t *caller_scope = ctx->current_scope;
+    ctx->current_scope = gen->scope;
+    while (gen->frame_count > 0) {
+        pop_frame(ctx, gen);
+    }
+    ctx->current_scope = caller_scope;
+
+    dm_free(ctx, gen->frames);
+    gen->frames = NULL;
+    gen->frame_capacity = 0;
+
+    dm_scope_release(ctx, gen->params);
+    gen->params = NULL;
+    gen->scope = NULL;
+    gen->finished = true;
+}
+
+// Evaluate a condition for its truth value
+static dm_error_t test(dm_context_t *ctx, dm_node_t *node, bool *truthy) {
+    dm_value_t value;
+    dm_error_t err = dm_eval_node(ctx, node, &value);
+    if (err == DM_SUCCESS) {
+        *truthy = dm_value_is_truthy(&value);
+        dm_value_free(ctx, &value);
+    }
+    return err;
+}
+
+// Evaluate a node for its side effects
+static dm_error_t run_discarded(dm_context_t *ctx, dm_node_t *node) {
+    dm_value_t value;
+    dm_error_t err = dm_eval_node(ctx, node, &value);
+    dm_value_free(ctx, &value);
+    return err;
+}
+
+// Start a statement of the body. Statements that hold others get a frame;
+// yield stores the item and suspends, return finishes the generator.
+static dm_error_t enter(dm_context_t *ctx, dm_generator_t *gen, dm_node_t *node,
+                        dm_value_t *item, bool *suspended) {
+    switch (node->type) {
+        case DM_NODE_FOR:
+            // A parallel loop's body cannot yield; it runs like an expression
+            if (node->for_loop.parallel) {
+                return run_discarded(ctx, node);
+            }
+            return push_frame(ctx, gen, node);
+
+        case DM_NODE_BLOCK:
+        case DM_NODE_IF:
+        case DM_NODE_WHILE:
+        case DM_NODE_FOR_EACH:
+            return push_frame(ctx, gen, node);
+
+        case DM_NODE_YIELD:
+            *suspended = true;
+            if (node->yield_stmt.value == NULL) {
+                return DM_SUCCESS;
+            }
+            return dm_eval_node(ctx, node->yield_stmt.value, item);
+
+        case DM_NODE_RETURN: {
+            // The returned value only matters for its side effects
+            dm_error_t err = DM_SUCCESS;
+            if (node->return_stmt.value != NULL) {
+                err = run_discarded(ctx, node->return_stmt.value);
+            }
+            while (gen->frame_count > 0) {
+                pop_frame(ctx, gen);
+            }
+            return err;
+        }
+
+        default:
+            return run_discarded(ctx, node);
+    }
+}
+
+// Run the body until it yields (*suspended) or ends
+static dm_error_t run(dm_context_t *ctx, dm_generator_t *gen, dm_value_t *item, bool *suspended) {
+    dm_error_t err = DM_SUCCESS;
+
+    while (gen->frame_count > 0 && !*suspended && err == DM_SUCCESS) {
+        dm_generator_frame_t *frame = &gen->frames[gen->frame_count - 1];
+        dm_node_t *node = frame->node;
+
+        switch (node->type) {
+            case DM_NODE_BLOCK:
+                if (frame->scope == NULL) {
+                    err = open_scope(ctx, frame, node->block.slot_count);
+                } else if (frame->step < node->block.count) {
+                    err = enter(ctx, gen, node->block.statements[frame->step++], item, suspended);
+                } else {
+                    pop_frame(ctx, gen);
+                }
+                break;
+
+            case DM_NODE_IF: {
+                // The frame is replaced by the branch taken
+                bool truthy = false;
+                err = test(ctx, node->if_stmt.condition, &truthy);
+                if (err != DM_SUCCESS) {
+                    break;
+                }
+                pop_frame(ctx, gen);
+                dm_node_t *branch = truthy ? node->if_stmt.then_branch : node->if_stmt.else_branch;
+                if (branch != NULL) {
+                    err = enter(ctx, gen, branch, item, suspended);
+                }
+                break;
+            }
+
+            case DM_NODE_WHILE: {
+                bool truthy = false;
+                err = test(ctx, node->while_loop.condition, &truthy);
+                if (err != DM_SUCCESS) {
+                    break;
+                }
+                if (!truthy) {
+                    pop_frame(ctx, gen);
+                    break;
+                }
+                err = DM_KERNEL_STEP(ctx);
+                if (err == DM_SUCCESS) {
+                    err = enter(ctx, gen, node->while_loop.body, item, suspended);
+                }
+                break;
+            }
+
+            case DM_NODE_FOR:
+                if (frame->step == LOOP_START) {
+                    err = open_scope(ctx, frame, node->for_loop.slot_count);
+                    if (err == DM_SUCCESS && node->for_loop.init != NULL) {
+                        err = run_discarded(ctx, node->for_loop.init);
+                    }
+                    frame->step = LOOP_TEST;
+                } else if (frame->step == LOOP_TEST) {
+                    bool truthy = true;
+                    if (node->for_loop.condition != NULL) {
+                        err = test(ctx, node->for_loop.condition, &truthy);
+                    }
+                    if (err != DM_SUCCESS) {
+                        break;
+                    }
+                    if (!truthy) {
+                        pop_frame(ctx, gen);
+                        break;
+                    }
+                    err = DM_KERNEL_STEP(ctx);
+                    if (err == DM_SUCCESS) {
+                        frame->step = LOOP_UPDATE;
+                        err = enter(ctx, gen, node->for_loop.body, item, suspended);
+                    }
+                } else {
+                    if (node->for_loop.increment != NULL) {
+                        err = run_discarded(ctx, node->for_loop.increment);
+                    }
+                    frame->step = LOOP_TEST;
+                }
+                break;
+
+            case DM_NODE_FOR_EACH:
+                if (frame->step == LOOP_START) {
+                    // The iterable is evaluated outside the loop scope
+                    dm_value_t iterable;
+                    err = dm_eval_node(ctx, node->for_each.iterable, &iterable);
+                    if (err == DM_SUCCESS) {
+                        err = dm_iterator_init(ctx, &frame->iterator, &iterable);
+                        dm_value_free(ctx, &iterable);
+                    }
+                    if (err == DM_SUCCESS) {
+                        err = open_scope(ctx, frame, node->for_each.slot_count);
+                    }
+                    frame->step = LOOP_TEST;
+                } else {
+                    dm_value_t next;
+                    dm_value_init(&next);
+                    bool done = false;
+                    err = dm_iterator_next(ctx, &frame->iterator, &next, &done);
+                    if (err != DM_SUCCESS || done) {
+                        dm_value_free(ctx, &next);
+                        if (err == DM_SUCCESS) {
+                            pop_frame(ctx, gen);
+                        }
+                        break;
+                    }
+
+                    err = bind_item(ctx, node, frame->scope, next);
+                    if (err == DM_SUCCESS) {
+                        err = DM_KERNEL_STEP(ctx);
+                    }
+                    if (err == DM_SUCCESS) {
+                        err = enter(ctx, gen, node->for_each.body, item, suspended);
+                    }
+                }
+                break;
+
+            default:
+                err = DM_ERROR_INVALID_ARGUMENT;
+                break;
+        }
+    }
+
+    return err;
+}
+
+// Iteration protocol: resume the body until its next yield
+static dm_error_t generator_next(dm_context_t *ctx, dm_object_t *object, dm_value_t *item, bool *done) {
+    dm_generator_t *gen = (dm_generator_t*)object;
+    dm_value_init(item);
+    *done = false;
+
+    if (gen->finished) {
+        *done = true;
+        return DM_SUCCESS;
+    }
+    if (gen->owner != ctx) {
+        // Parallel loop workers only resume generators they created (and
+        // cannot hand them out; see dm_parallel_for)
+        char message[256];
+        snprintf(message, sizeof(message), "Generator '%s' belongs to another thread", gen->function->function.name);
+        dm_context_set_error(ctx, message);
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    if (gen->running) {
+        char message[256];
+        snprintf(message, sizeof(message), "Generator '%s' is already running", gen->function->function.name);
+        dm_context_set_error(ctx, message);
+        return DM_ERROR_BUSY;
+    }
+
+    // Run on the generator's own scopes, then give the caller its own back
+    dm_scope_t *caller_scope = ctx->current_scope;
+    ctx->current_scope = gen->scope;
+    gen->running = true;
+
+    bool suspended = false;
+    dm_error_t err = run(ctx, gen, item, &suspended);
+
+    gen->running = false;
+    gen->scope = ctx->current_scope;
+    ctx->current_scope = caller_scope;
+
+    if (err != DM_SUCCESS || !suspended) {
+        finish(ctx, gen);
+        dm_value_free(ctx, item);
+        *done = (err == DM_SUCCESS);
+    }
+    return err;
+}
+
+static void generator_destroy(dm_context_t *ctx, dm_object_t *object) {
+    dm_generator_t *gen = (dm_generator_t*)object;
+    if (!gen->finished) {
+        finish(ctx, gen);
+    }
+    dm_object_release(ctx, gen->code);
+    dm_free(ctx, gen);
+}
+
+// Wrap a bound call of a generator function in a generator object
+dm_error_t dm_generator_create(dm_context_t *ctx, dm_node_t *function, dm_object_t *code, dm_scope_t *scope,
+                               dm_value_t *result) {
+    if (ctx == NULL || function == NULL || scope == NULL || result == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_generator_t *gen = dm_calloc(ctx, 1, sizeof(dm_generator_t));
+    if (gen == NULL) {
+        dm_scope_release(ctx, scope);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    gen->object.refcount = 1;
+    gen->object.destroy = generator_destroy;
+    gen->object.next = generator_next;
+    gen->function = function;
+    gen->code = code;
+    dm_object_retain(code);
+    gen->owner = ctx;
+
+    // The caller's scopes may be gone by the time the body runs
+    scope->parent = ctx->global_scope;
+    gen->params = scope;
+    gen->scope = scope;
+
+    dm_error_t err = push_frame(ctx, gen, function->function.body);
+    if (err != DM_SUCCESS) {
+        dm_scope_release(ctx, scope);
+        dm_free(ctx, gen);
+        return err;
+    }
+
+    return dm_value_set_object(ctx, result, &gen->object);
+}
+
+// Whether value is a generator object
+bool dm_is_generator(const dm_value_t *value) {
+    return value != NULL && value->type == DM_TYPE_OBJECT && value->as.object->destroy == generator_destroy;
+}
@@ -20,7 +20,7 @@ static const char *KEYWORDS[] = {
     "break", "case", "class", "const", "continue", "default",
     "else", "export", "extends", "false", "for", "function",
     "if", "import", "let", "null", "return", "static", "super",
-    "switch", "this", "true", "var", "while"
+    "switch", "this", "true", "var", "while", "yield"
 };
 
 static const size_t KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/memo.h"
+
+#define MEMO_NONE ((size_t)-1)
+
+// One cached call. Entries are chained per hash bucket and kept on a
+// doubly linked list from most to least recently used.
+typedef struct {
+    dm_value_t *args;
+    dm_value_t result;
+    uint64_t hash;
+    size_t bucket_next;
+    size_t newer;
+    size_t older;
+} dm_memo_entry_t;
+
+struct dm_memo {
+    size_t arity;
+    size_t capacity;
+    size_t count;
+    dm_memo_entry_t *entries;
+    dm_value_t *keys;           // capacity * arity argument values
+    size_t *buckets;            // First entry of each chain, MEMO_NONE if empty
+    size_t bucket_mask;
+    size_t newest;
+    size_t oldest;
+};
+
+// FNV-1a over a run of bytes
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_args(const dm_value_t *args, size_t count) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < count; i++) {
+        const dm_value_t *arg = &args[i];
+        hash = hash_bytes(hash, &arg->type, sizeof(arg->type));
+
+        switch (arg->type) {
+            case DM_TYPE_BOOLEAN:
+                hash = hash_bytes(hash, &arg->as.boolean, sizeof(arg->as.boolean));
+                break;
+
+            case DM_TYPE_INTEGER:
+                hash = hash_bytes(hash, &arg->as.integer, sizeof(arg->as.integer));
+                break;
+
+            case DM_TYPE_FLOAT:
+                hash = hash_bytes(hash, &arg->as.floating, sizeof(arg->as.floating));
+                break;
+
+            case DM_TYPE_STRING:
+                hash = hash_bytes(hash, arg->as.string.data, arg->as.string.length);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return hash;
+}
+
+// Numbers match bit for bit so that 0 and -0 stay distinct keys
+static bool args_equal(const dm_value_t *a, const dm_value_t *b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].type != b[i].type) {
+            return false;
+        }
+
+        switch (a[i].type) {
+            case DM_TYPE_BOOLEAN:
+                if (a[i].as.boolean != b[i].as.boolean) {
+                    return false;
+                }
+                break;
+
+            case DM_TYPE_INTEGER:
+                if (a[i].as.integer != b[i].as.integer) {
+                    return false;
+                }
+                break;
+
+            case DM_TYPE_FLOAT:
+                if (memcmp(&a[i].as.floating, &b[i].as.floating, sizeof(double)) != 0) {
+                    return false;
+                }
+                break;
+
+            case DM_TYPE_STRING:
+                if (a[i].as.string.length != b[i].as.string.length ||
+                    memcmp(a[i].as.string.data, b[i].as.string.data, a[i].as.string.length) != 0) {
+                    return false;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+bool dm_memo_cacheable(const dm_value_t *args, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        switch (args[i].type) {
+            case DM_TYPE_NULL:
+            case DM_TYPE_BOOLEAN:
+            case DM_TYPE_INTEGER:
+            case DM_TYPE_FLOAT:
+            case DM_TYPE_STRING:
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+dm_error_t dm_memo_create(dm_context_t *ctx, size_t arity, size_t capacity, dm_memo_t **memo) {
+    if (ctx == NULL || memo == NULL || capacity == 0) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Keep chains short with at least twice as many buckets as entries
+    size_t bucket_count = 1;
+    while (bucket_count < capacity * 2) {
+        bucket_count <<= 1;
+    }
+
+    dm_memo_t *table = dm_calloc(ctx, 1, sizeof(dm_memo_t));
+    if (table == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    table->entries = dm_calloc(ctx, capacity, sizeof(dm_memo_entry_t));
+    table->buckets = dm_malloc(ctx, bucket_count * sizeof(size_t));
+    table->keys = arity > 0 ? dm_calloc(ctx, capacity * arity, sizeof(dm_value_t)) : NULL;
+    if (table->entries == NULL || table->buckets == NULL || (arity > 0 && table->keys == NULL)) {
+        dm_free(ctx, table->entries);
+        dm_free(ctx, table->buckets);
+        dm_free(ctx, table->keys);
+        dm_free(ctx, table);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        table->buckets[i] = MEMO_NONE;
+    }
+
+    table->arity = arity;
+    table->capacity = capacity;
+    table->bucket_mask = bucket_count - 1;
+    table->newest = MEMO_NONE;
+    table->oldest = MEMO_NONE;
+
+    *memo = table;
+    return DM_SUCCESS;
+}
+
+static void free_entry(dm_context_t *ctx, dm_memo_t *memo, dm_memo_entry_t *entry) {
+    for (size_t i = 0; i < memo->arity; i++) {
+        dm_value_free(ctx, &entry->args[i]);
+    }
+    dm_value_free(ctx, &entry->result);
+}
+
+void dm_memo_free(dm_context_t *ctx, dm_memo_t *memo) {
+    if (ctx == NULL || memo == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < memo->count; i++) {
+        free_entry(ctx, memo, &memo->entries[i]);
+    }
+
+    dm_free(ctx, memo->entries);
+    dm_free(ctx, memo->buckets);
+    dm_free(ctx, memo->keys);
+    dm_free(ctx, memo);
+}
+
+static void lru_unlink(dm_memo_t *memo, size_t index) {
+    dm_memo_entry_t *entry = &memo->entries[index];
+
+    if (entry->newer != MEMO_NONE) {
+        memo->entries[entry->newer].older = entry->older;
+    } else {
+        memo->newest = entry->older;
+    }
+
+    if (entry->older != MEMO_NONE) {
+        memo->entries[entry->older].newer = entry->newer;
+    } else {
+        memo->oldest = entry->newer;
+    }
+}
+
+static void lru_push(dm_memo_t *memo, size_t index) {
+    dm_memo_entry_t *entry = &memo->entries[index];
+    entry->newer = MEMO_NONE;
+    entry->older = memo->newest;
+
+    if (memo->newest != MEMO_NONE) {
+        memo->entries[memo->newest].newer = index;
+    }
+    memo->newest = index;
+
+    if (memo->oldest == MEMO_NONE) {
+        memo->oldest = index;
+    }
+}
+
+static size_t find_entry(dm_memo_t *memo, const dm_value_t *args, uint64_t hash) {
+    size_t index = memo->buckets[hash & memo->bucket_mask];
+
+    while (index != MEMO_NONE) {
+        dm_memo_entry_t *entry = &memo->entries[index];
+        if (entry->hash == hash && args_equal(entry->args, args, memo->arity)) {
+            return index;
+        }
+        index = entry->bucket_next;
+    }
+
+    return MEMO_NONE;
+}
+
+const dm_value_t* dm_memo_lookup(dm_memo_t *memo, const dm_value_t *args) {
+    if (memo == NULL || (args == NULL && memo->arity > 0)) {
+        return NULL;
+    }
+
+    size_t index = find_entry(memo, args, hash_args(args, memo->arity));
+    if (index == MEMO_NONE) {
+        return NULL;
+    }
+
+    if (memo->newest != index) {
+        lru_unlink(memo, index);
+        lru_push(memo, index);
+    }
+
+    return &memo->entries[index].result;
+}
+
+// Take the least recently used entry out of its bucket chain and the list
+static size_t evict_oldest(dm_context_t *ctx, dm_memo_t *memo) {
+    size_t index = memo->oldest;
+    dm_memo_entry_t *entry = &memo->entries[index];
+
+    size_t *link = &memo->buckets[entry->hash & memo->bucket_mask];
+    while (*link != index) {
+        link = &memo->entries[*link].bucket_next;
+    }
+    *link = entry->bucket_next;
+
+    lru_unlink(memo, index);
+    free_entry(ctx, memo, entry);
+    return index;
+}
+
+dm_error_t dm_memo_store(dm_context_t *ctx, dm_memo_t *memo, const dm_value_t *args, const dm_value_t *result) {
+    if (ctx == NULL || memo == NULL || result == NULL || (args == NULL && memo->arity > 0)) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint64_t hash = hash_args(args, memo->arity);
+
+    // A recursive call may already have cached the same arguments
+    size_t index = find_entry(memo, args, hash);
+    if (index != MEMO_NONE) {
+        dm_value_copy(ctx, &memo->entries[index].result, result);
+        lru_unlink(memo, index);
+        lru_push(memo, index);
+        return DM_SUCCESS;
+    }
+
+    if (memo->count < memo->capacity) {
+        index = memo->count++;
+        memo->entries[index].args = memo->keys != NULL ? memo->keys + index * memo->arity : NULL;
+    } else {
+        index = evict_oldest(ctx, memo);
+    }
+
+    dm_memo_entry_t *entry = &memo->entries[index];
+    for (size_t i = 0; i < memo->arity; i++) {
+        dm_value_init(&entry->args[i]);
+        dm_value_copy(ctx, &entry->args[i], &args[i]);
+    }
+    dm_value_init(&entry->result);
+    dm_value_copy(ctx, &entry->result, result);
+    entry->hash = hash;
+
+    size_t *bucket = &memo->buckets[hash & memo->bucket_mask];
+    entry->bucket_next = *bucket;
+    *bucket = index;
+
+    lru_push(memo, index);
+    return DM_SUCCESS;
+}
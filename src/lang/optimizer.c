@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/exec.h"
+#include "../../include/lang/optimizer.h"
+
+static void optimize_node(dm_context_t *ctx, dm_node_t *node);
+
+static void optimize_list(dm_context_t *ctx, dm_node_t **nodes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        optimize_node(ctx, nodes[i]);
+    }
+}
+
+// Read a literal node into a value
+static bool literal_to_value(dm_context_t *ctx, const dm_node_t *node, dm_value_t *value) {
+    dm_value_init(value);
+
+    if (node == NULL || node->type != DM_NODE_LITERAL) {
+        return false;
+    }
+
+    switch (node->literal.type) {
+        case DM_LITERAL_NUMBER:
+            value->type = DM_TYPE_FLOAT;
+            value->as.floating = node->literal.value.number;
+            return true;
+
+        case DM_LITERAL_INTEGER:
+            value->type = DM_TYPE_INTEGER;
+            value->as.integer = node->literal.value.integer;
+            return true;
+
+        case DM_LITERAL_STRING: {
+            const dm_value_t *atom_value = dm_atom_value(ctx, node->literal.value.string);
+            if (atom_value == NULL) {
+                return false;
+            }
+            dm_value_copy(ctx, value, atom_value);
+            return true;
+        }
+
+        case DM_LITERAL_BOOLEAN:
+            value->type = DM_TYPE_BOOLEAN;
+            value->as.boolean = node->literal.value.boolean;
+            return true;
+
+        case DM_LITERAL_NULL:
+            return true;
+    }
+
+    return false;
+}
+
+// Turn node into a literal holding value. Returns false (leaving node
+// untouched) if the value has no literal form.
+static bool replace_with_literal(dm_context_t *ctx, dm_node_t *node, const dm_value_t *value) {
+    dm_literal_node_t literal;
+    memset(&literal, 0, sizeof(literal));
+
+    switch (value->type) {
+        case DM_TYPE_NULL:
+            literal.type = DM_LITERAL_NULL;
+            break;
+
+        case DM_TYPE_BOOLEAN:
+            literal.type = DM_LITERAL_BOOLEAN;
+            literal.value.boolean = value->as.boolean;
+            break;
+
+        case DM_TYPE_INTEGER:
+            literal.type = DM_LITERAL_INTEGER;
+            literal.value.integer = value->as.integer;
+            break;
+
+        case DM_TYPE_FLOAT:
+            literal.type = DM_LITERAL_NUMBER;
+            literal.value.number = value->as.floating;
+            break;
+
+        case DM_TYPE_STRING:
+            literal.type = DM_LITERAL_STRING;
+            literal.value.string = dm_intern(ctx, value->as.string.data, value->as.string.length);
+            if (literal.value.string == NULL) {
+                return false;
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    // Free the old children, then reuse the node in place
+    switch (node->type) {
+        case DM_NODE_BINARY_OP:
+            dm_node_free(ctx, node->binary.left);
+            dm_node_free(ctx, node->binary.right);
+            break;
+
+        case DM_NODE_UNARY_OP:
+            dm_node_free(ctx, node->unary.operand);
+            break;
+
+        default:
+            break;
+    }
+
+    memset(&node->program, 0, sizeof(*node) - offsetof(dm_node_t, program));
+    node->type = DM_NODE_LITERAL;
+    node->literal = literal;
+    return true;
+}
+
+// Move replacement's contents into node and free what node held before.
+// Nodes are rewritten in place so the root and parent pointers stay valid.
+static void replace_contents(dm_context_t *ctx, dm_node_t *node, dm_node_t *replacement) {
+    dm_node_t old = *node;
+    *node = *replacement;
+    *replacement = old;
+    dm_node_free(ctx, replacement);
+}
+
+static void fold_binary(dm_context_t *ctx, dm_node_t *node) {
+    dm_value_t left;
+    dm_value_t right;
+    dm_value_t result;
+    dm_value_init(&left);
+    dm_value_init(&right);
+    dm_value_init(&result);
+
+    if (literal_to_value(ctx, node->binary.left, &left) &&
+        literal_to_value(ctx, node->binary.right, &right)) {
+        // Operations that fail are kept so the error is reported at runtime
+        char saved_error[sizeof(ctx->error_message)];
+        memcpy(saved_error, ctx->error_message, sizeof(saved_error));
+
+        if (dm_value_binary_op(ctx, node->binary.op, &left, &right, &result) == DM_SUCCESS) {
+            replace_with_literal(ctx, node, &result);
+        }
+
+        memcpy(ctx->error_message, saved_error, sizeof(saved_error));
+    }
+
+    dm_value_free(ctx, &left);
+    dm_value_free(ctx, &right);
+    dm_value_free(ctx, &result);
+}
+
+static void fold_unary(dm_context_t *ctx, dm_node_t *node) {
+    dm_value_t operand;
+    dm_value_t result;
+    dm_value_init(&result);
+
+    if (literal_to_value(ctx, node->unary.operand, &operand)) {
+        char saved_error[sizeof(ctx->error_message)];
+        memcpy(saved_error, ctx->error_message, sizeof(saved_error));
+
+        if (dm_value_unary_op(ctx, node->unary.op, &operand, &result) == DM_SUCCESS) {
+            replace_with_literal(ctx, node, &result);
+        }
+
+        memcpy(ctx->error_message, saved_error, sizeof(saved_error));
+    }
+
+    dm_value_free(ctx, &operand);
+    dm_value_free(ctx, &result);
+}
+
+// Truthiness of a literal condition; false if the node is not a literal
+static bool constant_condition(dm_context_t *ctx, const dm_node_t *node, bool *truthy) {
+    dm_value_t value;
+    if (!literal_to_value(ctx, node, &value)) {
+        dm_value_free(ctx, &value);
+        return false;
+    }
+
+    *truthy = dm_value_is_truthy(&value);
+    dm_value_free(ctx, &value);
+    return true;
+}
+
+// Make node evaluate to null without side effects
+static void replace_with_null(dm_context_t *ctx, dm_node_t *node) {
+    dm_node_t *null_node = dm_calloc(ctx, 1, sizeof(dm_node_t));
+    if (null_node == NULL) {
+        return;
+    }
+
+    null_node->type = DM_NODE_LITERAL;
+    null_node->line = node->line;
+    null_node->column = node->column;
+    null_node->literal.type = DM_LITERAL_NULL;
+    replace_contents(ctx, node, null_node);
+}
+
+static void prune_if(dm_context_t *ctx, dm_node_t *node) {
+    bool truthy = false;
+    if (!constant_condition(ctx, node->if_stmt.condition, &truthy)) {
+        return;
+    }
+
+    dm_node_t **taken = truthy ? &node->if_stmt.then_branch : &node->if_stmt.else_branch;
+    if (*taken == NULL) {
+        replace_with_null(ctx, node);
+        return;
+    }
+
+    // Top-level statements print their value unless they are assignments or
+    // declarations, so such a branch must stay wrapped in its if
+    if ((*taken)->type == DM_NODE_ASSIGNMENT || (*taken)->type == DM_NODE_FUNCTION) {
+        return;
+    }
+
+    dm_node_t *branch = *taken;
+    *taken = NULL;
+    replace_contents(ctx, node, branch);
+}
+
+static void optimize_node(dm_context_t *ctx, dm_node_t *node) {
+    if (node == NULL) {
+        return;
+    }
+
+    switch (node->type) {
+        case DM_NODE_PROGRAM:
+            optimize_list(ctx, node->program.statements, node->program.count);
+            break;
+
+        case DM_NODE_BLOCK:
+            optimize_list(ctx, node->block.statements, node->block.count);
+            break;
+
+        case DM_NODE_BINARY_OP:
+            optimize_node(ctx, node->binary.left);
+            optimize_node(ctx, node->binary.right);
+            fold_binary(ctx, node);
+            break;
+
+        case DM_NODE_UNARY_OP:
+            optimize_node(ctx, node->unary.operand);
+            fold_unary(ctx, node);
+            break;
+
+        case DM_NODE_ASSIGNMENT:
+            optimize_node(ctx, node->assignment.value);
+            break;
+
+        case DM_NODE_IF:
+            optimize_node(ctx, node->if_stmt.condition);
+            optimize_node(ctx, node->if_stmt.then_branch);
+            optimize_node(ctx, node->if_stmt.else_branch);
+            prune_if(ctx, node);
+            break;
+
+        case DM_NODE_WHILE: {
+            optimize_node(ctx, node->while_loop.condition);
+            optimize_node(ctx, node->while_loop.body);
+
+            bool truthy = true;
+            if (constant_condition(ctx, node->while_loop.condition, &truthy) && !truthy) {
+                replace_with_null(ctx, node);
+            }
+            break;
+        }
+
+        case DM_NODE_FOR:
+            optimize_node(ctx, node->for_loop.init);
+            optimize_node(ctx, node->for_loop.condition);
+            optimize_node(ctx, node->for_loop.increment);
+            optimize_node(ctx, node->for_loop.body);
+            break;
+
+        case DM_NODE_FOR_EACH:
+            optimize_node(ctx, node->for_each.iterable);
+            optimize_node(ctx, node->for_each.body);
+            break;
+
+        case DM_NODE_CALL:
+            optimize_list(ctx, node->call.args, node->call.arg_count);
+            break;
+
+        case DM_NODE_FUNCTION:
+            optimize_node(ctx, node->function.body);
+            break;
+
+        case DM_NODE_RETURN:
+            optimize_node(ctx, node->return_stmt.value);
+            break;
+
+        case DM_NODE_YIELD:
+            optimize_node(ctx, node->yield_stmt.value);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Fold constants and prune dead branches of a parsed program
+dm_error_t dm_optimize(dm_context_t *ctx, dm_node_t *root) {
+    if (ctx == NULL || root == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    optimize_node(ctx, root);
+    return DM_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/parallel.h"
+#include "../../include/lang/exec.h"
+#include "../../include/lang/generator.h"
+#include "../../include/core/nanbox.h"
+#include "../../include/core/threadpool.h"
+
+// A worker thread's share of a loop
+typedef struct {
+    dm_context_t *ctx;
+    size_t failed_at;           // Earliest iteration that failed, or SIZE_MAX
+    dm_error_t err;
+    char error_message[256];
+} dm_parallel_worker_t;
+
+typedef struct {
+    const dm_parallel_loop_t *loop;
+    dm_value_t *results;        // One per iteration, written by whichever worker ran it
+    dm_parallel_worker_t *workers;
+    atomic_bool failed;         // Stops the remaining iterations
+} dm_parallel_job_t;
+
+// Whether value is or holds a generator. Generators stay bound to the
+// worker that created them, which is destroyed when the loop ends.
+static bool holds_generator(dm_context_t *ctx, const dm_value_t *value) {
+    if (dm_is_generator(value)) {
+        return true;
+    }
+    if (value->type != DM_TYPE_ARRAY) {
+        return false;
+    }
+
+    for (size_t i = 0; i < value->as.array.length; i++) {
+        if (!value->as.array.compact) {
+            if (holds_generator(ctx, &value->as.array.items[i])) {
+                return true;
+            }
+            continue;
+        }
+
+        // Only boxed objects and arrays can hold a generator
+        dm_value_type_t type = dm_boxed_type(value->as.array.cells[i]);
+        if (type != DM_TYPE_OBJECT && type != DM_TYPE_ARRAY) {
+            continue;
+        }
+        dm_value_t item;
+        if (dm_value_array_get(ctx, value, i, &item) != DM_SUCCESS) {
+            continue;
+        }
+        bool found = holds_generator(ctx, &item);
+        dm_value_free(ctx, &item);
+        if (found) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static dm_error_t run_iteration(dm_context_t *ctx, const dm_parallel_loop_t *loop, size_t index,
+                                dm_value_t *result) {
+    dm_scope_t *scope = dm_scope_acquire(ctx, ctx->shared_scope, loop->slot_count);
+    if (scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    dm_value_t *counter = &scope->slots[loop->counter_slot];
+    int64_t value = loop->start + (int64_t)index * loop->step;
+    if (loop->integer) {
+        counter->type = DM_TYPE_INTEGER;
+        counter->as.integer = value;
+    } else {
+        counter->type = DM_TYPE_FLOAT;
+        counter->as.floating = (double)value;
+    }
+
+    ctx->current_scope = scope;
+    dm_error_t err = DM_KERNEL_STEP(ctx);
+    if (err == DM_SUCCESS) {
+        err = dm_eval_node(ctx, loop->body, result);
+    }
+    if (err == DM_SUCCESS && ctx->returning) {
+        // The function to return from belongs to another thread
+        ctx->returning = false;
+        dm_value_free(ctx, result);
+        dm_context_set_error(ctx, "Cannot return from inside a parallel for");
+        err = DM_ERROR_INVALID_ARGUMENT;
+    }
+    if (err == DM_SUCCESS && holds_generator(ctx, result)) {
+        dm_value_free(ctx, result);
+        dm_context_set_error(ctx, "A parallel for cannot produce generators");
+        err = DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    ctx->current_scope = ctx->shared_scope;
+    dm_scope_release(ctx, scope);
+    return err;
+}
+
+// Run iterations [begin, end) on one worker (see dm_range_fn)
+static bool run_range(void *arg, size_t worker, size_t begin, size_t end) {
+    dm_parallel_job_t *job = arg;
+    dm_parallel_worker_t *self = &job->workers[worker];
+
+    for (size_t i = begin; i < end; i++) {
+        if (atomic_load_explicit(&job->failed, memory_order_relaxed)) {
+            return false;
+        }
+
+        dm_error_t err = run_iteration(self->ctx, job->loop, i, &job->results[i]);
+        if (err != DM_SUCCESS) {
+            if (i < self->failed_at) {
+                self->failed_at = i;
+                self->err = err;
+                memcpy(self->error_message, self->ctx->error_message, sizeof(self->error_message));
+            }
+            atomic_store(&job->failed, true);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Give back the steps a worker took from the run's budget but did not use
+static void return_steps(dm_context_t *ctx, dm_context_t *worker) {
+    dm_context_t *run = ctx->parent != NULL ? ctx->parent : ctx;
+    if (run->max_steps > 0 && run->run_depth > 0 && worker->poll_countdown > 1) {
+        __atomic_fetch_add(&run->steps_left, (uint64_t)worker->poll_countdown - 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Run a parallel for loop and collect its values
+dm_error_t dm_parallel_for(dm_context_t *ctx, const dm_parallel_loop_t *loop, dm_value_t *result) {
+    if (ctx == NULL || loop == NULL || result == NULL || loop->counter_slot >= loop->slot_count) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Only the outermost loop uses threads; nested ones run on their worker
+    dm_thread_pool_t *pool = NULL;
+    if (ctx->parent == NULL && loop->count > 1) {
+        if (ctx->thread_pool == NULL) {
+            dm_error_t err = dm_thread_pool_create(ctx, ctx->max_threads, &ctx->thread_pool);
+            if (err != DM_SUCCESS) {
+                dm_context_set_error(ctx, "Failed to start the parallel loop threads");
+                return err;
+            }
+        }
+        pool = ctx->thread_pool;
+    }
+    size_t worker_count = dm_thread_pool_size(pool);
+
+    dm_parallel_job_t job;
+    job.loop = loop;
+    job.results = NULL;
+    job.workers = dm_calloc(ctx, worker_count, sizeof(dm_parallel_worker_t));
+    atomic_init(&job.failed, false);
+    if (job.workers == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    dm_error_t err = DM_SUCCESS;
+    if (loop->count > 0) {
+        job.results = dm_malloc(ctx, loop->count * sizeof(dm_value_t));
+        if (job.results == NULL) {
+            err = DM_ERROR_MEMORY_ALLOCATION;
+        } else {
+            for (size_t i = 0; i < loop->count; i++) {
+                dm_value_init(&job.results[i]);
+            }
+        }
+    }
+
+    size_t created = 0;
+    for (; err == DM_SUCCESS && created < worker_count; created++) {
+        dm_parallel_worker_t *worker = &job.workers[created];
+        worker->failed_at = SIZE_MAX;
+        err = dm_context_create_worker(ctx, ctx->current_scope, &worker->ctx);
+        if (err != DM_SUCCESS) {
+            break;
+        }
+    }
+
+    if (err == DM_SUCCESS && loop->count > 0) {
+        if (worker_count > 1) {
+            dm_rc_begin_shared();
+            dm_thread_pool_for(pool, loop->count, run_range, &job);
+            dm_rc_end_shared();
+        } else {
+            run_range(&job, 0, 0, loop->count);
+        }
+
+        // Report the earliest failure
+        dm_parallel_worker_t *first = NULL;
+        for (size_t i = 0; i < worker_count; i++) {
+            if (job.workers[i].failed_at != SIZE_MAX &&
+                (first == NULL || job.workers[i].failed_at < first->failed_at)) {
+                first = &job.workers[i];
+            }
+        }
+        if (first != NULL) {
+            err = first->err;
+            dm_context_set_error(ctx, first->error_message);
+        }
+    }
+
+    // The values combine into one array, in iteration order
+    if (err == DM_SUCCESS) {
+        err = dm_value_set_compact_array(ctx, result, loop->count > 0 ? loop->count : 1);
+        for (size_t i = 0; err == DM_SUCCESS && i < loop->count; i++) {
+            err = dm_value_array_push(ctx, result, &job.results[i]);
+        }
+    }
+
+    for (size_t i = 0; i < created; i++) {
+        return_steps(ctx, job.workers[i].ctx);
+        dm_context_destroy(job.workers[i].ctx);
+    }
+    if (job.results != NULL) {
+        for (size_t i = 0; i < loop->count; i++) {
+            dm_value_free(ctx, &job.results[i]);
+        }
+        dm_free(ctx, job.results);
+    }
+    dm_free(ctx, job.workers);
+    return err;
+}
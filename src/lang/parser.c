@@ -1,8 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <ctype.h>
+#include <errno.h>
 #include "../../include/lang/parser.h"
+#include "../../include/lang/memo.h"
 #include "../../include/core/debug.h"
 
 // Override debug macros locally to disable them
@@ -27,6 +30,8 @@ dm_error_t dm_parser_init(dm_context_t *ctx, dm_parser_t *parser, const char *so
     // Initialize parser
     parser->ctx = ctx;
     strncpy(parser->error_message, "", sizeof(parser->error_message));
+    parser->function_depth = 0;
+    parser->yield_count = 0;
     
     // Initialize lexer
     return dm_lexer_init(ctx, &parser->lexer, source, source_len);
@@ -111,13 +116,62 @@ static dm_node_t* create_node(dm_context_t *ctx, dm_node_type_t type) {
     
     // Initialize node
     node->type = type;
+    node->line = 0;
+    node->column = 0;
     
-    // Clear the union
-    memset(&node->program, 0, sizeof(node->program));
+    // Clear the union (the largest member, not just the program node)
+    memset(&node->program, 0, sizeof(*node) - offsetof(dm_node_t, program));
     
     return node;
 }
 
+// Give a node the source position of the token it starts at, unless a
+// more specific parse already placed it
+static dm_node_t* place_node(dm_node_t *node, const dm_token_t *start) {
+    if (node != NULL && node->line == 0) {
+        node->line = start->line;
+        node->column = start->column;
+    }
+    return node;
+}
+
+// Intern the text of the current token. Names and string literals are
+// atoms owned by the context, so nodes never free them.
+static const char* intern_token(dm_parser_t *parser) {
+    return dm_intern(parser->ctx, parser->current.text, parser->current.length);
+}
+
+// Store the current number token in a literal node. Numbers without a
+// decimal point are integers unless they do not fit in int64.
+static dm_error_t set_number_literal(dm_parser_t *parser, dm_node_t *node) {
+    // strtoll/strtod need the token null-terminated; the copy is scratch
+    dm_arena_mark_t scratch = dm_arena_begin(parser->ctx);
+    char *text = dm_arena_alloc(parser->ctx, parser->current.length + 1);
+    if (text == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    memcpy(text, parser->current.text, parser->current.length);
+    text[parser->current.length] = '\0';
+    
+    node->literal.type = DM_LITERAL_NUMBER;
+    if (strchr(text, '.') == NULL) {
+        errno = 0;
+        long long integer = strtoll(text, NULL, 10);
+        if (errno != ERANGE) {
+            node->literal.type = DM_LITERAL_INTEGER;
+            node->literal.value.integer = (int64_t)integer;
+        }
+    }
+    
+    if (node->literal.type == DM_LITERAL_NUMBER) {
+        node->literal.value.number = strtod(text, NULL);
+    }
+    
+    dm_arena_end(parser->ctx, scratch);
+    return DM_SUCCESS;
+}
+
 // Forward declarations
 static dm_node_t* parse_expression(dm_parser_t *parser);
 static dm_node_t* parse_statement(dm_parser_t *parser);
@@ -128,8 +182,13 @@ static dm_node_t* parse_binary(dm_parser_t *parser, int precedence);
 static dm_node_t* parse_unary(dm_parser_t *parser);
 static dm_node_t* parse_if(dm_parser_t *parser);
 static dm_node_t* parse_while(dm_parser_t *parser);
+static dm_node_t* parse_for(dm_parser_t *parser);
+static bool match_parallel(dm_parser_t *parser);
+static dm_node_t* parse_parallel_for(dm_parser_t *parser);
 static dm_node_t* parse_function(dm_parser_t *parser);
+static dm_node_t* parse_for_each(dm_parser_t *parser, const char *name);
 static dm_node_t* parse_return(dm_parser_t *parser);
+static dm_node_t* parse_yield(dm_parser_t *parser);
 
 // Parse a program (multiple statements)
 static dm_node_t* parse_program(dm_parser_t *parser) {
@@ -156,6 +215,7 @@ static dm_node_t* parse_program(dm_parser_t *parser) {
         dm_free(parser->ctx, node);
         return NULL;
     }
+    place_node(node, &parser->current);
     
     // Parse statements until end of file
     while (parser->current.type != DM_TOKEN_EOF) {
@@ -204,39 +264,11 @@ static dm_node_t* parse_literal(dm_parser_t *parser) {
     }
     
     if (match(parser, DM_TOKEN_NUMBER)) {
-        // Parse number
-        char *tmp = dm_malloc(parser->ctx, parser->current.length + 1);
-        if (tmp == NULL) {
+        if (set_number_literal(parser, node) != DM_SUCCESS) {
             dm_free(parser->ctx, node);
             return NULL;
         }
         
-        // Copy and null-terminate the number string
-        strncpy(tmp, parser->current.text, parser->current.length);
-        tmp[parser->current.length] = '\0';
-        
-        // Check if it's a floating-point number
-        bool is_float = false;
-        for (size_t i = 0; i < parser->current.length; i++) {
-            if (tmp[i] == '.') {
-                is_float = true;
-                break;
-            }
-        }
-        
-        if (is_float) {
-            // Float value
-            node->literal.type = DM_LITERAL_NUMBER;
-            node->literal.value.number = atof(tmp);
-        } else {
-            // Integer value (convert to double for uniformity)
-            node->literal.type = DM_LITERAL_NUMBER;
-            node->literal.value.number = (double)atoll(tmp);
-        }
-        
-        // Free temporary string
-        dm_free(parser->ctx, tmp);
-        
         // Consume the number token
         if (consume(parser) != DM_SUCCESS) {
             dm_free(parser->ctx, node);
@@ -245,17 +277,13 @@ static dm_node_t* parse_literal(dm_parser_t *parser) {
     } else if (match(parser, DM_TOKEN_STRING)) {
         // Remove quotes from string literal
         size_t len = parser->current.length - 2;  // subtract 2 for quotes
-        char* value = dm_malloc(parser->ctx, len + 1);
+        const char* value = dm_intern(parser->ctx, parser->current.text + 1, len);
         if (value == NULL) {
             return NULL;
         }
         
-        strncpy(value, parser->current.text + 1, len);
-        value[len] = '\0';
-        
         dm_node_t* node = create_node(parser->ctx, DM_NODE_LITERAL);
         if (node == NULL) {
-            dm_free(parser->ctx, value);
             return NULL;
         }
         
@@ -309,22 +337,15 @@ static dm_node_t* parse_variable(dm_parser_t *parser) {
         return NULL;
     }
     
-    // Copy variable name
-    size_t name_len = parser->current.length;
-    char *name = dm_malloc(parser->ctx, name_len + 1);
-    if (name == NULL) {
+    // Intern variable name
+    node->variable.name = intern_token(parser);
+    if (node->variable.name == NULL) {
         dm_free(parser->ctx, node);
         return NULL;
     }
     
-    strncpy(name, parser->current.text, name_len);
-    name[name_len] = '\0';
-    
-    node->variable.name = name;
-    
     // Consume the identifier token
     if (consume(parser) != DM_SUCCESS) {
-        dm_free(parser->ctx, node->variable.name);
         dm_free(parser->ctx, node);
         return NULL;
     }
@@ -332,12 +353,8 @@ static dm_node_t* parse_variable(dm_parser_t *parser) {
     return node;
 }
 
-// Parse a statement
-static dm_node_t* parse_statement(dm_parser_t *parser) {
-    if (parser == NULL) {
-        return NULL;
-    }
-    
+// Parse a statement (without its position)
+static dm_node_t* parse_statement_node(dm_parser_t *parser) {
     // Check for variable declaration
     if (match_keyword(parser, "let") || match_keyword(parser, "var") || match_keyword(parser, "const")) {
         return parse_assignment(parser);
@@ -353,6 +370,11 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
         return parse_return(parser);
     }
     
+    // Check for yield statement
+    if (match_keyword(parser, "yield")) {
+        return parse_yield(parser);
+    }
+    
     // Check for if statement
     if (match_keyword(parser, "if")) {
         return parse_if(parser);
@@ -363,25 +385,61 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
         return parse_while(parser);
     }
     
+    // Check for for loop
+    if (match_keyword(parser, "for")) {
+        return parse_for(parser);
+    }
+    
+    // Check for parallel for loop
+    if (match_parallel(parser)) {
+        return parse_parallel_for(parser);
+    }
+    
     // Check for block statement
     if (match_symbol(parser, '{')) {
         return parse_block(parser);
     }
     
+    // Check for memoized function definition (`memo` is only special
+    // right before `function`, so it stays usable as a name)
+    if (match(parser, DM_TOKEN_IDENTIFIER) && parser->current.length == 4 &&
+        strncmp(parser->current.text, "memo", 4) == 0) {
+        dm_lexer_t saved_lexer = parser->lexer;
+        dm_token_t saved_token = parser->current;
+        
+        if (consume(parser) == DM_SUCCESS && match_keyword(parser, "function")) {
+            dm_node_t *node = parse_function(parser);
+            if (node != NULL && node->function.generator) {
+                // A cached generator would be shared by every caller
+                report_error(parser, "A memo function cannot yield");
+                dm_node_free(parser->ctx, node);
+                return NULL;
+            }
+            if (node != NULL) {
+                node->function.memoize = true;
+            }
+            return node;
+        }
+        
+        parser->lexer = saved_lexer;
+        parser->current = saved_token;
+    }
+    
     // Check for non-declaration assignment (identifier followed by equals)
     if (match(parser, DM_TOKEN_IDENTIFIER)) {
+        // Remember where the identifier starts so we can back up if this
+        // turns out to be an expression statement (call, arithmetic, ...)
+        dm_lexer_t saved_lexer = parser->lexer;
+        dm_token_t saved_token = parser->current;
+        
         // Save the identifier for possible assignment
-        char *name = dm_malloc(parser->ctx, parser->current.length + 1);
+        const char *name = intern_token(parser);
         if (name == NULL) {
             return NULL;
         }
         
-        strncpy(name, parser->current.text, parser->current.length);
-        name[parser->current.length] = '\0';
-        
         // Consume identifier
         if (consume(parser) != DM_SUCCESS) {
-            dm_free(parser->ctx, name);
             return NULL;
         }
         
@@ -390,7 +448,6 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             // Create assignment node
             dm_node_t *node = create_node(parser->ctx, DM_NODE_ASSIGNMENT);
             if (node == NULL) {
-                dm_free(parser->ctx, name);
                 return NULL;
             }
             
@@ -399,7 +456,6 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             
             // Consume the equals sign
             if (consume(parser) != DM_SUCCESS) {
-                dm_free(parser->ctx, name);
                 dm_free(parser->ctx, node);
                 return NULL;
             }
@@ -407,7 +463,6 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             // Parse the right-hand expression
             dm_node_t *value = parse_expression(parser);
             if (value == NULL) {
-                dm_free(parser->ctx, name);
                 dm_free(parser->ctx, node);
                 return NULL;
             }
@@ -417,7 +472,6 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             // Expect semicolon after assignment
             if (!match_symbol(parser, ';')) {
                 report_error(parser, "Expected ';' after assignment");
-                dm_free(parser->ctx, name);
                 dm_node_free(parser->ctx, value);
                 dm_free(parser->ctx, node);
                 return NULL;
@@ -425,7 +479,6 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             
             // Consume the semicolon
             if (consume(parser) != DM_SUCCESS) {
-                dm_free(parser->ctx, name);
                 dm_node_free(parser->ctx, value);
                 dm_free(parser->ctx, node);
                 return NULL;
@@ -434,33 +487,9 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
             return node;
         }
         
-        // Not an assignment, must be a variable reference
-        // Create a variable node
-        dm_node_t *var_node = create_node(parser->ctx, DM_NODE_VARIABLE);
-        if (var_node == NULL) {
-            dm_free(parser->ctx, name);
-            return NULL;
-        }
-        
-        // Set the variable name
-        var_node->variable.name = name;
-        
-        // Expect semicolon after expression statement
-        if (!match_symbol(parser, ';')) {
-            report_error(parser, "Expected ';' after expression");
-            dm_free(parser->ctx, name);
-            dm_free(parser->ctx, var_node);
-            return NULL;
-        }
-        
-        // Consume the semicolon
-        if (consume(parser) != DM_SUCCESS) {
-            dm_free(parser->ctx, name);
-            dm_free(parser->ctx, var_node);
-            return NULL;
-        }
-        
-        return var_node;
+        // Not an assignment, rewind and parse it as an expression statement
+        parser->lexer = saved_lexer;
+        parser->current = saved_token;
     }
     
     // Expression statement
@@ -485,6 +514,16 @@ static dm_node_t* parse_statement(dm_parser_t *parser) {
     return expr;
 }
 
+// Parse a statement, recording where it starts
+static dm_node_t* parse_statement(dm_parser_t *parser) {
+    if (parser == NULL) {
+        return NULL;
+    }
+    
+    dm_token_t start = parser->current;
+    return place_node(parse_statement_node(parser), &start);
+}
+
 // Parse a variable assignment
 static dm_node_t* parse_assignment(dm_parser_t *parser) {
     DM_DEBUG_INFO_PRINT("Parsing assignment...\n");
@@ -521,18 +560,14 @@ static dm_node_t* parse_assignment(dm_parser_t *parser) {
     DM_DEBUG_VERBOSE_PRINT("  Found identifier: %.*s\n", (int)parser->current.length, parser->current.text);
     
     // Store the variable name
-    char *name = dm_malloc(parser->ctx, parser->current.length + 1);
+    const char *name = intern_token(parser);
     if (name == NULL) {
         DM_DEBUG_ERROR_PRINT("  Memory allocation failed for variable name\n");
         return NULL;
     }
     
-    strncpy(name, parser->current.text, parser->current.length);
-    name[parser->current.length] = '\0';
-    
     if (consume(parser) != DM_SUCCESS) {
         DM_DEBUG_ERROR_PRINT("  Error consuming identifier\n");
-        dm_free(parser->ctx, name);
         return NULL;
     }
     
@@ -541,13 +576,11 @@ static dm_node_t* parse_assignment(dm_parser_t *parser) {
         DM_DEBUG_ERROR_PRINT("  Expected '=' operator but found: %.*s\n", 
                 (int)parser->current.length, parser->current.text);
         report_error(parser, "Expected '=' in assignment");
-        dm_free(parser->ctx, name);
         return NULL;
     }
     
     if (consume(parser) != DM_SUCCESS) {
         DM_DEBUG_ERROR_PRINT("  Error consuming '='\n");
-        dm_free(parser->ctx, name);
         return NULL;
     }
     
@@ -555,7 +588,6 @@ static dm_node_t* parse_assignment(dm_parser_t *parser) {
     dm_node_t *value = parse_expression(parser);
     if (value == NULL) {
         DM_DEBUG_ERROR_PRINT("  Failed to parse expression\n");
-        dm_free(parser->ctx, name);
         return NULL;
     }
     
@@ -564,14 +596,12 @@ static dm_node_t* parse_assignment(dm_parser_t *parser) {
         DM_DEBUG_ERROR_PRINT("  Expected ';' but found: %.*s\n", 
                 (int)parser->current.length, parser->current.text);
         report_error(parser, "Expected ';' after assignment");
-        dm_free(parser->ctx, name);
         dm_node_free(parser->ctx, value);
         return NULL;
     }
     
     if (consume(parser) != DM_SUCCESS) {
         DM_DEBUG_ERROR_PRINT("  Error consuming ';'\n");
-        dm_free(parser->ctx, name);
         dm_node_free(parser->ctx, value);
         return NULL;
     }
@@ -580,7 +610,6 @@ static dm_node_t* parse_assignment(dm_parser_t *parser) {
     dm_node_t *node = create_node(parser->ctx, DM_NODE_ASSIGNMENT);
     if (node == NULL) {
         DM_DEBUG_ERROR_PRINT("  Memory allocation failed for assignment node\n");
-        dm_free(parser->ctx, name);
         dm_node_free(parser->ctx, value);
         return NULL;
     }
@@ -599,23 +628,20 @@ static dm_node_t* parse_expression(dm_parser_t *parser) {
     return parse_binary(parser, 1);
 }
 
-// Parse a primary expression (literals, variables, grouping)
-static dm_node_t* parse_primary(dm_parser_t *parser) {
-    if (parser == NULL) {
-        return NULL;
-    }
+// Parse a primary expression (literals, variables, grouping) without its position
+static dm_node_t* parse_primary_node(dm_parser_t *parser) {
     
     // Parse literals
     if (match(parser, DM_TOKEN_NUMBER)) {
-        double value = atof(parser->current.text);
-        
         dm_node_t* node = create_node(parser->ctx, DM_NODE_LITERAL);
         if (node == NULL) {
             return NULL;
         }
         
-        node->literal.type = DM_LITERAL_NUMBER;
-        node->literal.value.number = value;
+        if (set_number_literal(parser, node) != DM_SUCCESS) {
+            dm_free(parser->ctx, node);
+            return NULL;
+        }
         
         consume(parser);
         return node;
@@ -624,17 +650,13 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
     if (match(parser, DM_TOKEN_STRING)) {
         // Remove quotes from string literal
         size_t len = parser->current.length - 2;  // subtract 2 for quotes
-        char* value = dm_malloc(parser->ctx, len + 1);
+        const char* value = dm_intern(parser->ctx, parser->current.text + 1, len);
         if (value == NULL) {
             return NULL;
         }
         
-        strncpy(value, parser->current.text + 1, len);
-        value[len] = '\0';
-        
         dm_node_t* node = create_node(parser->ctx, DM_NODE_LITERAL);
         if (node == NULL) {
-            dm_free(parser->ctx, value);
             return NULL;
         }
         
@@ -646,7 +668,7 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
     }
     
     if (match_keyword(parser, "true") || match_keyword(parser, "false")) {
-        bool value = strcmp(parser->current.text, "true") == 0;
+        bool value = match_keyword(parser, "true");
         
         dm_node_t* node = create_node(parser->ctx, DM_NODE_LITERAL);
         if (node == NULL) {
@@ -672,22 +694,21 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
         return node;
     }
     
+    // A parallel for loop evaluates to the array of its iterations' values
+    if (match_parallel(parser)) {
+        return parse_parallel_for(parser);
+    }
+    
     // Parse variable reference or function call
     if (match(parser, DM_TOKEN_IDENTIFIER)) {
         // Get the identifier name
-        size_t name_len = parser->current.length;
-        char* name = dm_malloc(parser->ctx, name_len + 1);
+        const char* name = intern_token(parser);
         if (name == NULL) {
             return NULL;
         }
         
-        // Copy the identifier text
-        strncpy(name, parser->current.text, name_len);
-        name[name_len] = '\0';
-        
         // Consume the identifier
         if (consume(parser) != DM_SUCCESS) {
-            dm_free(parser->ctx, name);
             return NULL;
         }
         
@@ -695,7 +716,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
         if (match_symbol(parser, '(')) {
             // This is a function call
             if (consume(parser) != DM_SUCCESS) {
-                dm_free(parser->ctx, name);
                 return NULL;
             }
             
@@ -710,7 +730,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
                 if (argument_count > 0) {
                     if (!match_symbol(parser, ',')) {
                         report_error(parser, "Expected ',' between arguments");
-                        dm_free(parser->ctx, name);
                         for (size_t i = 0; i < argument_count; i++) {
                             dm_node_free(parser->ctx, arguments[i]);
                         }
@@ -719,7 +738,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
                     }
                     
                     if (consume(parser) != DM_SUCCESS) {
-                        dm_free(parser->ctx, name);
                         for (size_t i = 0; i < argument_count; i++) {
                             dm_node_free(parser->ctx, arguments[i]);
                         }
@@ -732,7 +750,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
                 dm_node_t* argument = parse_expression(parser);
                 if (argument == NULL) {
                     report_error(parser, "Expected expression for argument");
-                    dm_free(parser->ctx, name);
                     for (size_t i = 0; i < argument_count; i++) {
                         dm_node_free(parser->ctx, arguments[i]);
                     }
@@ -746,7 +763,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
                     dm_node_t** new_arguments = dm_realloc(parser->ctx, arguments, new_capacity * sizeof(dm_node_t*));
                     if (new_arguments == NULL) {
                         report_error(parser, "Failed to allocate memory for arguments");
-                        dm_free(parser->ctx, name);
                         dm_node_free(parser->ctx, argument);
                         for (size_t i = 0; i < argument_count; i++) {
                             dm_node_free(parser->ctx, arguments[i]);
@@ -765,7 +781,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
             
             // Consume closing parenthesis
             if (consume(parser) != DM_SUCCESS) {
-                dm_free(parser->ctx, name);
                 for (size_t i = 0; i < argument_count; i++) {
                     dm_node_free(parser->ctx, arguments[i]);
                 }
@@ -776,7 +791,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
             // Create call node
             dm_node_t* node = create_node(parser->ctx, DM_NODE_CALL);
             if (node == NULL) {
-                dm_free(parser->ctx, name);
                 for (size_t i = 0; i < argument_count; i++) {
                     dm_node_free(parser->ctx, arguments[i]);
                 }
@@ -793,7 +807,6 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
             // This is a variable reference
             dm_node_t* node = create_node(parser->ctx, DM_NODE_VARIABLE);
             if (node == NULL) {
-                dm_free(parser->ctx, name);
                 return NULL;
             }
             
@@ -831,29 +844,68 @@ static dm_node_t* parse_primary(dm_parser_t *parser) {
     return NULL;
 }
 
-// Get operator precedence
-static int get_binary_precedence(char op) {
-    switch (op) {
+// Parse a primary expression, recording where it starts
+static dm_node_t* parse_primary(dm_parser_t *parser) {
+    if (parser == NULL) {
+        return NULL;
+    }
+    
+    dm_token_t start = parser->current;
+    return place_node(parse_primary_node(parser), &start);
+}
+
+// Get operator precedence (0 means the token is not a binary operator)
+static int get_binary_precedence(const dm_token_t *token) {
+    const char *op = token->text;
+    
+    if (token->length == 2) {
+        if (op[0] == '|' && op[1] == '|') return 1;
+        if (op[0] == '&' && op[1] == '&') return 2;
+        if ((op[0] == '=' || op[0] == '!') && op[1] == '=') return 3;
+        if ((op[0] == '<' || op[0] == '>') && op[1] == '=') return 4;
+        return 0;
+    }
+    
+    switch (op[0]) {
+        case '<':
+        case '>':
+            return 4;
         case '+':
         case '-':
-            return 1;
+            return 5;
         case '*':
         case '/':
         case '%':
-            return 2;
+            return 6;
         default:
             return 0;
     }
 }
 
 // Get operator type
-static dm_operator_t get_binary_operator(char op) {
-    switch (op) {
+static dm_operator_t get_binary_operator(const dm_token_t *token) {
+    const char *op = token->text;
+    
+    if (token->length == 2) {
+        switch (op[0]) {
+            case '|': return DM_OP_OR;
+            case '&': return DM_OP_AND;
+            case '=': return DM_OP_EQ;
+            case '!': return DM_OP_NEQ;
+            case '<': return DM_OP_LTE;
+            case '>': return DM_OP_GTE;
+            default:  return (dm_operator_t)-1;
+        }
+    }
+    
+    switch (op[0]) {
         case '+': return DM_OP_ADD;
         case '-': return DM_OP_SUB;
         case '*': return DM_OP_MUL;
         case '/': return DM_OP_DIV;
         case '%': return DM_OP_MOD;
+        case '<': return DM_OP_LT;
+        case '>': return DM_OP_GT;
         default:  return (dm_operator_t)-1;
     }
 }
@@ -866,12 +918,12 @@ static dm_node_t* parse_binary(dm_parser_t *parser, int precedence) {
     }
     
     while (match(parser, DM_TOKEN_OPERATOR) && 
-           get_binary_precedence(parser->current.text[0]) >= precedence) {
+           get_binary_precedence(&parser->current) > 0 &&
+           get_binary_precedence(&parser->current) >= precedence) {
         
         // Get operator
-        char op_char = parser->current.text[0];
-        dm_operator_t op = get_binary_operator(op_char);
-        int next_precedence = get_binary_precedence(op_char) + 1;
+        dm_operator_t op = get_binary_operator(&parser->current);
+        int next_precedence = get_binary_precedence(&parser->current) + 1;
         
         // Consume operator
         if (consume(parser) != DM_SUCCESS) {
@@ -894,6 +946,9 @@ static dm_node_t* parse_binary(dm_parser_t *parser, int precedence) {
             return NULL;
         }
         
+        // A binary expression starts where its left operand does
+        binary->line = left->line;
+        binary->column = left->column;
         binary->binary.op = op;
         binary->binary.left = left;
         binary->binary.right = right;
@@ -910,6 +965,7 @@ static dm_node_t* parse_unary(dm_parser_t *parser) {
     if ((match(parser, DM_TOKEN_OPERATOR) && parser->current.text[0] == '-') || 
         (match(parser, DM_TOKEN_OPERATOR) && parser->current.text[0] == '!')) {
         dm_operator_t op = parser->current.text[0] == '-' ? DM_OP_NEG : DM_OP_NOT;
+        dm_token_t start = parser->current;
         
         // Consume operator
         if (consume(parser) != DM_SUCCESS) {
@@ -932,7 +988,7 @@ static dm_node_t* parse_unary(dm_parser_t *parser) {
         unary->unary.op = op;
         unary->unary.operand = operand;
         
-        return unary;
+        return place_node(unary, &start);
     }
     
     // Not a unary expression, try primary
@@ -1130,6 +1186,11 @@ static dm_node_t* parse_while(dm_parser_t *parser) {
         return NULL;
     }
     
+    // Consume the 'while' keyword
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
     // Expect opening parenthesis
     if (!match_symbol(parser, '(')) {
         report_error(parser, "Expected '(' after 'while'");
@@ -1181,19 +1242,257 @@ static dm_node_t* parse_while(dm_parser_t *parser) {
     return node;
 }
 
+// Parse the update clause of a for loop: `name = expr` or an expression
+static dm_node_t* parse_for_update(dm_parser_t *parser) {
+    if (match(parser, DM_TOKEN_IDENTIFIER)) {
+        // Back up if the identifier does not start an assignment
+        dm_lexer_t saved_lexer = parser->lexer;
+        dm_token_t saved_token = parser->current;
+        
+        const char *name = intern_token(parser);
+        if (name == NULL) {
+            return NULL;
+        }
+        
+        if (consume(parser) != DM_SUCCESS) {
+            return NULL;
+        }
+        
+        if (match(parser, DM_TOKEN_OPERATOR) && parser->current.length == 1 && parser->current.text[0] == '=') {
+            if (consume(parser) != DM_SUCCESS) {
+                return NULL;
+            }
+            
+            dm_node_t *value = parse_expression(parser);
+            if (value == NULL) {
+                return NULL;
+            }
+            
+            dm_node_t *node = create_node(parser->ctx, DM_NODE_ASSIGNMENT);
+            if (node == NULL) {
+                dm_node_free(parser->ctx, value);
+                return NULL;
+            }
+            
+            node->assignment.name = name;
+            node->assignment.is_declaration = false;
+            node->assignment.value = value;
+            return place_node(node, &saved_token);
+        }
+        
+        parser->lexer = saved_lexer;
+        parser->current = saved_token;
+    }
+    
+    return parse_expression(parser);
+}
+
+// Parse a for loop: for (init; condition; update) body. Every clause may be empty.
+static dm_node_t* parse_for(dm_parser_t *parser) {
+    if (parser == NULL) {
+        return NULL;
+    }
+    
+    // Consume the 'for' keyword
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
+    // Expect opening parenthesis
+    if (!match_symbol(parser, '(')) {
+        report_error(parser, "Expected '(' after 'for'");
+        return NULL;
+    }
+    
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
+    // `for (let name of iterable)` walks an iterable instead
+    if (match_keyword(parser, "let") || match_keyword(parser, "var") || match_keyword(parser, "const")) {
+        dm_lexer_t saved_lexer = parser->lexer;
+        dm_token_t saved_token = parser->current;
+        
+        if (consume(parser) == DM_SUCCESS && match(parser, DM_TOKEN_IDENTIFIER)) {
+            const char *name = intern_token(parser);
+            if (name != NULL && consume(parser) == DM_SUCCESS && match(parser, DM_TOKEN_IDENTIFIER) &&
+                parser->current.length == 2 && strncmp(parser->current.text, "of", 2) == 0) {
+                return parse_for_each(parser, name);
+            }
+        }
+        
+        parser->lexer = saved_lexer;
+        parser->current = saved_token;
+    }
+    
+    dm_node_t *node = create_node(parser->ctx, DM_NODE_FOR);
+    if (node == NULL) {
+        return NULL;
+    }
+    
+    // Initializer (a declaration, assignment or expression statement, which
+    // consumes its own ';')
+    if (match_symbol(parser, ';')) {
+        if (consume(parser) != DM_SUCCESS) {
+            dm_node_free(parser->ctx, node);
+            return NULL;
+        }
+    } else {
+        node->for_loop.init = parse_statement(parser);
+        if (node->for_loop.init == NULL) {
+            dm_node_free(parser->ctx, node);
+            return NULL;
+        }
+    }
+    
+    // Condition
+    if (!match_symbol(parser, ';')) {
+        node->for_loop.condition = parse_expression(parser);
+        if (node->for_loop.condition == NULL) {
+            report_error(parser, "Expected condition in for loop");
+            dm_node_free(parser->ctx, node);
+            return NULL;
+        }
+    }
+    
+    if (!match_symbol(parser, ';')) {
+        report_error(parser, "Expected ';' after for condition");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    if (consume(parser) != DM_SUCCESS) {
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    // Update
+    if (!match_symbol(parser, ')')) {
+        node->for_loop.increment = parse_for_update(parser);
+        if (node->for_loop.increment == NULL) {
+            report_error(parser, "Expected update clause in for loop");
+            dm_node_free(parser->ctx, node);
+            return NULL;
+        }
+    }
+    
+    if (!match_symbol(parser, ')')) {
+        report_error(parser, "Expected ')' after for clauses");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    if (consume(parser) != DM_SUCCESS) {
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    // Parse body
+    node->for_loop.body = parse_statement(parser);
+    if (node->for_loop.body == NULL) {
+        report_error(parser, "Expected body for for loop");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    return node;
+}
+
+// Check for `parallel for` and move to its `for` (`parallel` is only
+// special right before `for`, so it stays usable as a name)
+static bool match_parallel(dm_parser_t *parser) {
+    if (!match(parser, DM_TOKEN_IDENTIFIER) || parser->current.length != 8 ||
+        strncmp(parser->current.text, "parallel", 8) != 0) {
+        return false;
+    }
+    
+    dm_lexer_t saved_lexer = parser->lexer;
+    dm_token_t saved_token = parser->current;
+    if (consume(parser) == DM_SUCCESS && match_keyword(parser, "for")) {
+        return true;
+    }
+    
+    parser->lexer = saved_lexer;
+    parser->current = saved_token;
+    return false;
+}
+
+// Parse `parallel for (...) body` from `for`
+static dm_node_t* parse_parallel_for(dm_parser_t *parser) {
+    dm_node_t *node = parse_for(parser);
+    if (node == NULL) {
+        return NULL;
+    }
+    
+    if (node->type != DM_NODE_FOR) {
+        report_error(parser, "'parallel' needs a counting for loop");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    node->for_loop.parallel = true;
+    return node;
+}
+
+// Parse the rest of `for (let name of iterable) body` from `of`
+static dm_node_t* parse_for_each(dm_parser_t *parser, const char *name) {
+    // Consume 'of'
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
+    dm_node_t *node = create_node(parser->ctx, DM_NODE_FOR_EACH);
+    if (node == NULL) {
+        return NULL;
+    }
+    node->for_each.name = name;
+    
+    node->for_each.iterable = parse_expression(parser);
+    if (node->for_each.iterable == NULL) {
+        report_error(parser, "Expected expression after 'of'");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    if (!match_symbol(parser, ')')) {
+        report_error(parser, "Expected ')' after for-of clause");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    if (consume(parser) != DM_SUCCESS) {
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    node->for_each.body = parse_statement(parser);
+    if (node->for_each.body == NULL) {
+        report_error(parser, "Expected body for for loop");
+        dm_node_free(parser->ctx, node);
+        return NULL;
+    }
+    
+    return node;
+}
+
 // Parse a function
 static dm_node_t* parse_function(dm_parser_t *parser) {
     if (parser == NULL) {
         return NULL;
     }
     
+    // Consume the 'function' keyword
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
     // Get function name (identifier)
     if (!match(parser, DM_TOKEN_IDENTIFIER)) {
         report_error(parser, "Expected function name after 'function' keyword");
         return NULL;
     }
     
-    char *name = strdup(parser->current.text);
+    const char *name = intern_token(parser);
     if (name == NULL) {
         report_error(parser, "Failed to allocate memory for function name");
         return NULL;
@@ -1201,24 +1500,21 @@ static dm_node_t* parse_function(dm_parser_t *parser) {
     
     // Consume function name
     if (consume(parser) != DM_SUCCESS) {
-        free(name);
         return NULL;
     }
     
     // Expect opening parenthesis for parameters
     if (!match_symbol(parser, '(')) {
         report_error(parser, "Expected '(' after function name");
-        free(name);
         return NULL;
     }
     
     if (consume(parser) != DM_SUCCESS) {
-        free(name);
         return NULL;
     }
     
     // Parse parameters
-    char **parameters = NULL;
+    const char **parameters = NULL;
     size_t parameter_count = 0;
     size_t parameter_capacity = 0;
     
@@ -1228,20 +1524,12 @@ static dm_node_t* parse_function(dm_parser_t *parser) {
         if (parameter_count > 0) {
             if (!match_symbol(parser, ',')) {
                 report_error(parser, "Expected ',' between parameters");
-                free(name);
-                for (size_t i = 0; i < parameter_count; i++) {
-                    free(parameters[i]);
-                }
-                free(parameters);
+                dm_free(parser->ctx, parameters);
                 return NULL;
             }
             
             if (consume(parser) != DM_SUCCESS) {
-                free(name);
-                for (size_t i = 0; i < parameter_count; i++) {
-                    free(parameters[i]);
-                }
-                free(parameters);
+                dm_free(parser->ctx, parameters);
                 return NULL;
             }
         }
@@ -1249,25 +1537,17 @@ static dm_node_t* parse_function(dm_parser_t *parser) {
         // Get parameter name (identifier)
         if (!match(parser, DM_TOKEN_IDENTIFIER)) {
             report_error(parser, "Expected parameter name");
-            free(name);
-            for (size_t i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
-            }
-            free(parameters);
+            dm_free(parser->ctx, parameters);
             return NULL;
         }
         
         // Allocate or resize parameters array if needed
         if (parameter_count >= parameter_capacity) {
             size_t new_capacity = parameter_capacity == 0 ? 4 : parameter_capacity * 2;
-            char **new_parameters = realloc(parameters, new_capacity * sizeof(char *));
+            const char **new_parameters = dm_realloc(parser->ctx, parameters, new_capacity * sizeof(char *));
             if (new_parameters == NULL) {
                 report_error(parser, "Failed to allocate memory for parameters");
-                free(name);
-                for (size_t i = 0; i < parameter_count; i++) {
-                    free(parameters[i]);
-                }
-                free(parameters);
+                dm_free(parser->ctx, parameters);
                 return NULL;
             }
             parameters = new_parameters;
@@ -1275,59 +1555,46 @@ static dm_node_t* parse_function(dm_parser_t *parser) {
         }
         
         // Store parameter name
-        parameters[parameter_count] = strdup(parser->current.text);
+        parameters[parameter_count] = intern_token(parser);
         if (parameters[parameter_count] == NULL) {
             report_error(parser, "Failed to allocate memory for parameter name");
-            free(name);
-            for (size_t i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
-            }
-            free(parameters);
+            dm_free(parser->ctx, parameters);
             return NULL;
         }
         parameter_count++;
         
         // Consume parameter name
         if (consume(parser) != DM_SUCCESS) {
-            free(name);
-            for (size_t i = 0; i < parameter_count; i++) {
-                free(parameters[i]);
-            }
-            free(parameters);
+            dm_free(parser->ctx, parameters);
             return NULL;
         }
     }
     
     // Consume closing parenthesis
     if (consume(parser) != DM_SUCCESS) {
-        free(name);
-        for (size_t i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
-        }
-        free(parameters);
+        dm_free(parser->ctx, parameters);
         return NULL;
     }
     
-    // Parse function body
+    // Parse function body, noting whether it yields (yields of nested
+    // functions belong to those functions)
+    size_t outer_yields = parser->yield_count;
+    parser->yield_count = 0;
+    parser->function_depth++;
     dm_node_t *body = parse_statement(parser);
+    parser->function_depth--;
+    bool generator = parser->yield_count > 0;
+    parser->yield_count = outer_yields;
     if (body == NULL) {
         report_error(parser, "Expected function body");
-        free(name);
-        for (size_t i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
-        }
-        free(parameters);
+        dm_free(parser->ctx, parameters);
         return NULL;
     }
     
     // Create function node
     dm_node_t *node = create_node(parser->ctx, DM_NODE_FUNCTION);
     if (node == NULL) {
-        free(name);
-        for (size_t i = 0; i < parameter_count; i++) {
-            free(parameters[i]);
-        }
-        free(parameters);
+        dm_free(parser->ctx, parameters);
         dm_node_free(parser->ctx, body);
         return NULL;
     }
@@ -1336,6 +1603,7 @@ static dm_node_t* parse_function(dm_parser_t *parser) {
     node->function.params = parameters;
     node->function.param_count = parameter_count;
     node->function.body = body;
+    node->function.generator = generator;
     
     return node;
 }
@@ -1394,6 +1662,51 @@ static dm_node_t* parse_return(dm_parser_t *parser) {
     return node;
 }
 
+// Parse a yield statement
+static dm_node_t* parse_yield(dm_parser_t *parser) {
+    if (parser->function_depth == 0) {
+        report_error(parser, "'yield' outside a function");
+        return NULL;
+    }
+    
+    // Consume the 'yield' keyword
+    if (consume(parser) != DM_SUCCESS) {
+        return NULL;
+    }
+    
+    // `yield;` yields null
+    dm_node_t *value = NULL;
+    if (!match_symbol(parser, ';')) {
+        value = parse_expression(parser);
+        if (value == NULL) {
+            report_error(parser, "Expected expression after 'yield'");
+            return NULL;
+        }
+    }
+    
+    if (!match_symbol(parser, ';')) {
+        report_error(parser, "Expected ';' after yield statement");
+        dm_node_free(parser->ctx, value);
+        return NULL;
+    }
+    
+    if (consume(parser) != DM_SUCCESS) {
+        dm_node_free(parser->ctx, value);
+        return NULL;
+    }
+    
+    dm_node_t *node = create_node(parser->ctx, DM_NODE_YIELD);
+    if (node == NULL) {
+        dm_node_free(parser->ctx, value);
+        return NULL;
+    }
+    
+    node->yield_stmt.value = value;
+    parser->yield_count++;
+    
+    return node;
+}
+
 // Main parse function
 dm_error_t dm_parser_parse(dm_parser_t *parser, dm_node_t **result) {
     if (parser == NULL || result == NULL) {
@@ -1443,13 +1756,11 @@ void dm_node_free(dm_context_t *ctx, dm_node_t *node) {
             break;
             
         case DM_NODE_VARIABLE:
-            // Free variable name
-            dm_free(ctx, node->variable.name);
+            // The name is an atom owned by the context
             break;
             
         case DM_NODE_ASSIGNMENT:
-            // Free target and value
-            dm_free(ctx, node->assignment.name);
+            // Free value; the target name is an atom
             dm_node_free(ctx, node->assignment.value);
             break;
             
@@ -1465,8 +1776,7 @@ void dm_node_free(dm_context_t *ctx, dm_node_t *node) {
             break;
             
         case DM_NODE_CALL:
-            // Free callee and arguments
-            dm_free(ctx, node->call.name);
+            // Free arguments; the callee name is an atom
             for (size_t i = 0; i < node->call.arg_count; i++) {
                 dm_node_free(ctx, node->call.args[i]);
             }
@@ -1502,14 +1812,21 @@ void dm_node_free(dm_context_t *ctx, dm_node_t *node) {
             dm_node_free(ctx, node->for_loop.body);
             break;
             
+        case DM_NODE_FOR_EACH:
+            // Free the iterable and body; the loop variable is an atom
+            dm_node_free(ctx, node->for_each.iterable);
+            dm_node_free(ctx, node->for_each.body);
+            break;
+            
+        case DM_NODE_YIELD:
+            dm_node_free(ctx, node->yield_stmt.value);
+            break;
+            
         case DM_NODE_FUNCTION:
-            // Free name, parameters, and body
-            dm_free(ctx, node->function.name);
-            for (size_t i = 0; i < node->function.param_count; i++) {
-                dm_free(ctx, node->function.params[i]);
-            }
+            // Free the parameter list and body; names are atoms
             dm_free(ctx, node->function.params);
             dm_node_free(ctx, node->function.body);
+            dm_memo_free(ctx, node->function.memo);
             break;
             
         case DM_NODE_RETURN:
@@ -1525,10 +1842,7 @@ void dm_node_free(dm_context_t *ctx, dm_node_t *node) {
             break;
             
         case DM_NODE_LITERAL:
-            // Free string if needed
-            if (node->literal.type == DM_LITERAL_STRING && node->literal.value.string != NULL) {
-                dm_free(ctx, node->literal.value.string);
-            }
+            // String literals are atoms owned by the context
             break;
     }
     
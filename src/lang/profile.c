@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/profile.h"
+
+#define PROFILE_NO_FUNCTION ((size_t)-1)
+
+// Counters of one AST node. The position is copied so the report does not
+// depend on the node still being alive.
+typedef struct {
+    const dm_node_t *node;      // NULL for an empty table slot
+    dm_node_type_t type;
+    size_t line;
+    size_t column;
+    uint64_t count;
+    uint64_t total_ns;          // Including nested evaluations
+    uint64_t self_ns;
+} dm_profile_node_t;
+
+// Counters of one user function
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    uint64_t total_ns;          // Outermost activations only, so recursion is not counted twice
+    uint64_t self_ns;
+    size_t active;              // Activations currently on the stack
+    uint64_t entered;           // Start of the outermost activation
+} dm_profile_function_t;
+
+// Call tree: one frame per distinct stack of user functions
+typedef struct dm_profile_frame {
+    const char *name;
+    size_t function;            // Index into functions, PROFILE_NO_FUNCTION for the script
+    uint64_t self_ns;
+    struct dm_profile_frame *parent;
+    struct dm_profile_frame *first_child;
+    struct dm_profile_frame *next_sibling;
+} dm_profile_frame_t;
+
+// A node evaluation in progress
+typedef struct {
+    uint64_t start;
+    uint64_t child_ns;          // Time spent in nested evaluations
+} dm_profile_eval_t;
+
+struct dm_profiler {
+    dm_context_t *ctx;
+
+    dm_profile_node_t *nodes;   // Open-addressing table keyed by node pointer
+    size_t node_count;
+    size_t node_capacity;       // Power of two
+
+    dm_profile_function_t *functions;
+    size_t function_count;
+    size_t function_capacity;
+
+    dm_profile_frame_t root;
+    dm_profile_frame_t *current;
+
+    dm_profile_eval_t *evals;
+    size_t eval_depth;
+    size_t eval_capacity;
+
+    bool incomplete;            // Recording stopped after running out of memory
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t hash_pointer(const void *pointer) {
+    uint64_t hash = (uint64_t)(uintptr_t)pointer;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
+
+static void free_frames(dm_context_t *ctx, dm_profile_frame_t *frame) {
+    dm_profile_frame_t *child = frame->first_child;
+    while (child != NULL) {
+        dm_profile_frame_t *next = child->next_sibling;
+        free_frames(ctx, child);
+        dm_free(ctx, child);
+        child = next;
+    }
+}
+
+// Start profiling
+dm_error_t dm_profile_start(dm_context_t *ctx) {
+    if (ctx == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_profile_stop(ctx);
+
+    dm_profiler_t *profiler = dm_calloc(ctx, 1, sizeof(dm_profiler_t));
+    if (profiler == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    profiler->node_capacity = 256;
+    profiler->nodes = dm_calloc(ctx, profiler->node_capacity, sizeof(dm_profile_node_t));
+    if (profiler->nodes == NULL) {
+        dm_free(ctx, profiler);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    profiler->ctx = ctx;
+    profiler->root.name = "script";
+    profiler->root.function = PROFILE_NO_FUNCTION;
+    profiler->current = &profiler->root;
+
+    ctx->profiler = profiler;
+    return DM_SUCCESS;
+}
+
+// Stop profiling and free the profile
+void dm_profile_stop(dm_context_t *ctx) {
+    if (ctx == NULL || ctx->profiler == NULL) {
+        return;
+    }
+
+    dm_profiler_t *profiler = ctx->profiler;
+    free_frames(ctx, &profiler->root);
+    dm_free(ctx, profiler->nodes);
+    dm_free(ctx, profiler->functions);
+    dm_free(ctx, profiler->evals);
+    dm_free(ctx, profiler);
+    ctx->profiler = NULL;
+}
+
+// Find or add the counters of a node
+static dm_profile_node_t* node_entry(dm_profiler_t *profiler, const dm_node_t *node) {
+    // Keep the table at most half full
+    if (profiler->node_count * 2 >= profiler->node_capacity) {
+        size_t new_capacity = profiler->node_capacity * 2;
+        dm_profile_node_t *nodes = dm_calloc(profiler->ctx, new_capacity, sizeof(dm_profile_node_t));
+        if (nodes == NULL) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i < profiler->node_capacity; i++) {
+            if (profiler->nodes[i].node == NULL) {
+                continue;
+            }
+            size_t index = hash_pointer(profiler->nodes[i].node) & (new_capacity - 1);
+            while (nodes[index].node != NULL) {
+                index = (index + 1) & (new_capacity - 1);
+            }
+            nodes[index] = profiler->nodes[i];
+        }
+
+        dm_free(profiler->ctx, profiler->nodes);
+        profiler->nodes = nodes;
+        profiler->node_capacity = new_capacity;
+    }
+
+    size_t index = hash_pointer(node) & (profiler->node_capacity - 1);
+    while (profiler->nodes[index].node != NULL) {
+        if (profiler->nodes[index].node == node) {
+            return &profiler->nodes[index];
+        }
+        index = (index + 1) & (profiler->node_capacity - 1);
+    }
+
+    dm_profile_node_t *entry = &profiler->nodes[index];
+    entry->node = node;
+    entry->type = node->type;
+    entry->line = node->line;
+    entry->column = node->column;
+    profiler->node_count++;
+    return entry;
+}
+
+// Start timing a node evaluation
+uint64_t dm_profile_node_begin(dm_profiler_t *profiler) {
+    if (profiler->incomplete) {
+        return 0;
+    }
+
+    if (profiler->eval_depth >= profiler->eval_capacity) {
+        size_t new_capacity = profiler->eval_capacity == 0 ? 64 : profiler->eval_capacity * 2;
+        dm_profile_eval_t *evals = dm_realloc(profiler->ctx, profiler->evals,
+                                              new_capacity * sizeof(dm_profile_eval_t));
+        if (evals == NULL) {
+            profiler->incomplete = true;
+            return 0;
+        }
+        profiler->evals = evals;
+        profiler->eval_capacity = new_capacity;
+    }
+
+    dm_profile_eval_t *eval = &profiler->evals[profiler->eval_depth++];
+    eval->start = now_ns();
+    eval->child_ns = 0;
+    return eval->start;
+}
+
+// Charge a finished evaluation to its node, line, function and call stack
+void dm_profile_node_end(dm_profiler_t *profiler, const dm_node_t *node, uint64_t start) {
+    if (profiler->incomplete || profiler->eval_depth == 0) {
+        return;
+    }
+
+    uint64_t elapsed = now_ns() - start;
+    dm_profile_eval_t *eval = &profiler->evals[--profiler->eval_depth];
+    uint64_t self = elapsed > eval->child_ns ? elapsed - eval->child_ns : 0;
+    if (profiler->eval_depth > 0) {
+        profiler->evals[profiler->eval_depth - 1].child_ns += elapsed;
+    }
+
+    dm_profile_node_t *entry = node_entry(profiler, node);
+    if (entry == NULL) {
+        profiler->incomplete = true;
+        return;
+    }
+    entry->count++;
+    entry->total_ns += elapsed;
+    entry->self_ns += self;
+
+    profiler->current->self_ns += self;
+    if (profiler->current->function != PROFILE_NO_FUNCTION) {
+        profiler->functions[profiler->current->function].self_ns += self;
+    }
+}
+
+// Index of a function's counters, adding them on its first call
+static size_t function_index(dm_profiler_t *profiler, const char *name) {
+    // Names are atoms, so they compare by pointer
+    for (size_t i = 0; i < profiler->function_count; i++) {
+        if (profiler->functions[i].name == name) {
+            return i;
+        }
+    }
+
+    if (profiler->function_count >= profiler->function_capacity) {
+        size_t new_capacity = profiler->function_capacity == 0 ? 16 : profiler->function_capacity * 2;
+        dm_profile_function_t *functions = dm_realloc(profiler->ctx, profiler->functions,
+                                                      new_capacity * sizeof(dm_profile_function_t));
+        if (functions == NULL) {
+            return PROFILE_NO_FUNCTION;
+        }
+        profiler->functions = functions;
+        profiler->function_capacity = new_capacity;
+    }
+
+    dm_profile_function_t *function = &profiler->functions[profiler->function_count];
+    memset(function, 0, sizeof(*function));
+    function->name = name;
+    return profiler->function_count++;
+}
+
+// Enter a user function: descend into its frame of the call tree
+void dm_profile_call_begin(dm_profiler_t *profiler, const char *name) {
+    if (profiler->incomplete) {
+        return;
+    }
+
+    dm_profile_frame_t *frame = profiler->current->first_child;
+    while (frame != NULL && frame->name != name) {
+        frame = frame->next_sibling;
+    }
+
+    if (frame == NULL) {
+        size_t function = function_index(profiler, name);
+        frame = function != PROFILE_NO_FUNCTION ? dm_calloc(profiler->ctx, 1, sizeof(dm_profile_frame_t)) : NULL;
+        if (frame == NULL) {
+            profiler->incomplete = true;
+            return;
+        }
+        frame->name = name;
+        frame->function = function;
+        frame->parent = profiler->current;
+        frame->next_sibling = profiler->current->first_child;
+        profiler->current->first_child = frame;
+    }
+
+    dm_profile_function_t *function = &profiler->functions[frame->function];
+    function->calls++;
+    if (function->active++ == 0) {
+        function->entered = now_ns();
+    }
+
+    profiler->current = frame;
+}
+
+// Leave the innermost user function
+void dm_profile_call_end(dm_profiler_t *profiler) {
+    if (profiler->incomplete || profiler->current->parent == NULL) {
+        return;
+    }
+
+    dm_profile_function_t *function = &profiler->functions[profiler->current->function];
+    if (--function->active == 0) {
+        function->total_ns += now_ns() - function->entered;
+    }
+
+    profiler->current = profiler->current->parent;
+}
+
+// Sort orders for the report
+static int compare_functions(const void *a, const void *b) {
+    const dm_profile_function_t *left = a;
+    const dm_profile_function_t *right = b;
+    return (left->total_ns < right->total_ns) - (left->total_ns > right->total_ns);
+}
+
+static int compare_nodes_by_self(const void *a, const void *b) {
+    const dm_profile_node_t *left = a;
+    const dm_profile_node_t *right = b;
+    return (left->self_ns < right->self_ns) - (left->self_ns > right->self_ns);
+}
+
+static int compare_nodes_by_line(const void *a, const void *b) {
+    const dm_profile_node_t *left = a;
+    const dm_profile_node_t *right = b;
+    return (left->line > right->line) - (left->line < right->line);
+}
+
+static const char* node_type_name(dm_node_type_t type) {
+    switch (type) {
+        case DM_NODE_PROGRAM: return "program";
+        case DM_NODE_LITERAL: return "literal";
+        case DM_NODE_BINARY_OP: return "binary";
+        case DM_NODE_UNARY_OP: return "unary";
+        case DM_NODE_VARIABLE: return "variable";
+        case DM_NODE_ASSIGNMENT: return "assignment";
+        case DM_NODE_BLOCK: return "block";
+        case DM_NODE_IF: return "if";
+        case DM_NODE_WHILE: return "while";
+        case DM_NODE_FOR: return "for";
+        case DM_NODE_CALL: return "call";
+        case DM_NODE_FUNCTION: return "function";
+        case DM_NODE_RETURN: return "return";
+        case DM_NODE_IMPORT: return "import";
+        case DM_NODE_YIELD: return "yield";
+        case DM_NODE_FOR_EACH: return "for-of";
+        default: return "?";
+    }
+}
+
+static double to_ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+// Print the report
+dm_error_t dm_profile_report(dm_context_t *ctx, FILE *out, size_t rows) {
+    if (ctx == NULL || out == NULL || ctx->profiler == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_profiler_t *profiler = ctx->profiler;
+
+    // Gather the used node slots; self times add up to the profiled time
+    size_t count = profiler->node_count;
+    dm_profile_node_t *nodes = dm_malloc(ctx, (count > 0 ? count : 1) * sizeof(dm_profile_node_t));
+    dm_profile_function_t *functions = dm_malloc(ctx, (profiler->function_count > 0 ? profiler->function_count : 1) *
+                                                      sizeof(dm_profile_function_t));
+    if (nodes == NULL || functions == NULL) {
+        dm_free(ctx, nodes);
+        dm_free(ctx, functions);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    uint64_t total_ns = 0;
+    uint64_t evaluations = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < profiler->node_capacity; i++) {
+        if (profiler->nodes[i].node != NULL) {
+            nodes[n] = profiler->nodes[i];
+            total_ns += nodes[n].self_ns;
+            evaluations += nodes[n].count;
+            n++;
+        }
+    }
+
+    fprintf(out, "Profile: %.3f ms in %llu node evaluations\n", to_ms(total_ns), (unsigned long long)evaluations);
+    if (profiler->incomplete) {
+        fprintf(out, "(incomplete: ran out of memory while profiling)\n");
+    }
+
+    // Functions by inclusive time
+    if (profiler->function_count > 0) {
+        memcpy(functions, profiler->functions, profiler->function_count * sizeof(dm_profile_function_t));
+        qsort(functions, profiler->function_count, sizeof(dm_profile_function_t), compare_functions);
+
+        fprintf(out, "\nFunctions:\n");
+        fprintf(out, "  %10s %12s %12s  %s\n", "calls", "total ms", "self ms", "function");
+        for (size_t i = 0; i < profiler->function_count && i < rows; i++) {
+            fprintf(out, "  %10llu %12.3f %12.3f  %s\n", (unsigned long long)functions[i].calls,
+                    to_ms(functions[i].total_ns), to_ms(functions[i].self_ns), functions[i].name);
+        }
+    }
+
+    // Lines by self time: fold the nodes of each line into one row
+    qsort(nodes, n, sizeof(dm_profile_node_t), compare_nodes_by_line);
+    size_t lines = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (lines > 0 && nodes[lines - 1].line == nodes[i].line) {
+            nodes[lines - 1].count += nodes[i].count;
+            nodes[lines - 1].self_ns += nodes[i].self_ns;
+            continue;
+        }
+        nodes[lines++] = nodes[i];
+    }
+    qsort(nodes, lines, sizeof(dm_profile_node_t), compare_nodes_by_self);
+
+    fprintf(out, "\nLines:\n");
+    fprintf(out, "  %6s %12s %12s %7s\n", "line", "evals", "self ms", "self %");
+    for (size_t i = 0; i < lines && i < rows; i++) {
+        fprintf(out, "  %6zu %12llu %12.3f %6.1f%%\n", nodes[i].line, (unsigned long long)nodes[i].count,
+                to_ms(nodes[i].self_ns), total_ns > 0 ? 100.0 * (double)nodes[i].self_ns / (double)total_ns : 0.0);
+    }
+
+    // Individual nodes by self time
+    n = 0;
+    for (size_t i = 0; i < profiler->node_capacity; i++) {
+        if (profiler->nodes[i].node != NULL) {
+            nodes[n++] = profiler->nodes[i];
+        }
+    }
+    qsort(nodes, n, sizeof(dm_profile_node_t), compare_nodes_by_self);
+
+    fprintf(out, "\nNodes:\n");
+    fprintf(out, "  %-10s %-10s %12s %12s %12s\n", "line:col", "node", "evals", "total ms", "self ms");
+    for (size_t i = 0; i < n && i < rows; i++) {
+        char position[32];
+        snprintf(position, sizeof(position), "%zu:%zu", nodes[i].line, nodes[i].column);
+        fprintf(out, "  %-10s %-10s %12llu %12.3f %12.3f\n", position, node_type_name(nodes[i].type),
+                (unsigned long long)nodes[i].count, to_ms(nodes[i].total_ns), to_ms(nodes[i].self_ns));
+    }
+
+    dm_free(ctx, nodes);
+    dm_free(ctx, functions);
+    return DM_SUCCESS;
+}
+
+// Write the stacks of frame and its descendants
+static void write_frame(const dm_profile_frame_t *frame, char *path, size_t length, size_t size, FILE *out) {
+    int written = snprintf(path + length, size - length, "%s%s", length > 0 ? ";" : "", frame->name);
+    if (written < 0 || (size_t)written >= size - length) {
+        // Deeper stacks than the buffer holds are folded into this one
+        written = 0;
+    }
+    length += (size_t)written;
+
+    uint64_t us = frame->self_ns / 1000;
+    if (us > 0) {
+        fprintf(out, "%s %llu\n", path, (unsigned long long)us);
+    }
+
+    for (const dm_profile_frame_t *child = frame->first_child; child != NULL; child = child->next_sibling) {
+        write_frame(child, path, length, size, out);
+    }
+    path[length - (size_t)written] = '\0';
+}
+
+// Write the call tree as collapsed stacks
+dm_error_t dm_profile_write_collapsed(dm_context_t *ctx, FILE *out) {
+    if (ctx == NULL || out == NULL || ctx->profiler == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    char path[4096];
+    path[0] = '\0';
+    write_frame(&ctx->profiler->root, path, 0, sizeof(path), out);
+    return DM_SUCCESS;
+}
@@ -0,0 +1,416 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/resolver.h"
+
+// A reference resolved to a slot, kept so it can be switched back to a
+// name lookup
+typedef struct {
+    size_t slot;
+    dm_local_ref_t *local;
+} dm_resolver_use_t;
+
+// A lexical scope being resolved. Slot i holds names[i] (an atom, so
+// names are compared by pointer).
+typedef struct {
+    const char **names;
+    size_t count;
+    size_t capacity;
+    dm_resolver_use_t *uses;
+    size_t use_count;
+    size_t use_capacity;
+    size_t escape_mark;         // Escapes recorded before the scope opened
+    bool function_boundary;     // Lookups do not continue past a function's parameters
+} dm_resolver_scope_t;
+
+// A name read by a function body without being declared in it. Called
+// functions see the caller's variables by name, so a variable of an
+// enclosing scope with that name cannot live in an unnamed slot.
+typedef struct {
+    const char *name;
+    size_t boundary;            // Index of the function scope it escaped
+} dm_resolver_escape_t;
+
+// Resolver state
+typedef struct {
+    dm_context_t *ctx;
+    dm_resolver_scope_t *scopes;
+    size_t depth;
+    size_t capacity;
+    dm_resolver_escape_t *escapes;
+    size_t escape_count;
+    size_t escape_capacity;
+} dm_resolver_t;
+
+static dm_error_t resolve_node(dm_resolver_t *r, dm_node_t *node);
+
+static dm_error_t push_scope(dm_resolver_t *r, bool function_boundary) {
+    if (r->depth >= r->capacity) {
+        size_t new_capacity = r->capacity == 0 ? 16 : r->capacity * 2;
+        dm_resolver_scope_t *new_scopes = dm_realloc(r->ctx, r->scopes, new_capacity * sizeof(dm_resolver_scope_t));
+        if (new_scopes == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        r->scopes = new_scopes;
+        r->capacity = new_capacity;
+    }
+
+    dm_resolver_scope_t *scope = &r->scopes[r->depth++];
+    scope->names = NULL;
+    scope->count = 0;
+    scope->capacity = 0;
+    scope->uses = NULL;
+    scope->use_count = 0;
+    scope->use_capacity = 0;
+    scope->escape_mark = r->escape_count;
+    scope->function_boundary = function_boundary;
+    return DM_SUCCESS;
+}
+
+// Whether a function nested in the scope reads the variable of a slot
+static bool slot_escapes(const dm_resolver_t *r, size_t index, size_t slot) {
+    const dm_resolver_scope_t *scope = &r->scopes[index];
+    for (size_t i = scope->escape_mark; i < r->escape_count; i++) {
+        if (r->escapes[i].boundary > index && r->escapes[i].name == scope->names[slot]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pop the innermost scope and return its slot count. Slots read by nested
+// functions go back to name-based storage: in a block just those, in a
+// function all parameters, which are then bound by name (*named is set).
+static size_t pop_scope(dm_resolver_t *r, bool *named) {
+    size_t index = r->depth - 1;
+    dm_resolver_scope_t *scope = &r->scopes[index];
+
+    bool all = false;
+    for (size_t slot = 0; slot < scope->count && !all; slot++) {
+        if (!slot_escapes(r, index, slot)) {
+            continue;
+        }
+        if (scope->function_boundary) {
+            all = true;
+            continue;
+        }
+        for (size_t i = 0; i < scope->use_count; i++) {
+            if (scope->uses[i].slot == slot) {
+                scope->uses[i].local->resolved = false;
+            }
+        }
+    }
+    if (all) {
+        for (size_t i = 0; i < scope->use_count; i++) {
+            scope->uses[i].local->resolved = false;
+        }
+    }
+    if (named != NULL) {
+        *named = all;
+    }
+
+    size_t count = scope->count;
+    dm_free(r->ctx, scope->names);
+    dm_free(r->ctx, scope->uses);
+    r->depth--;
+    if (r->depth == 0) {
+        r->escape_count = 0;
+    }
+    return count;
+}
+
+// Remember a reference to a slot of the scope at the given index
+static dm_error_t add_use(dm_resolver_t *r, size_t index, size_t slot, dm_local_ref_t *local) {
+    dm_resolver_scope_t *scope = &r->scopes[index];
+
+    if (scope->use_count >= scope->use_capacity) {
+        size_t new_capacity = scope->use_capacity == 0 ? 8 : scope->use_capacity * 2;
+        dm_resolver_use_t *new_uses = dm_realloc(r->ctx, scope->uses, new_capacity * sizeof(dm_resolver_use_t));
+        if (new_uses == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        scope->uses = new_uses;
+        scope->use_capacity = new_capacity;
+    }
+
+    scope->uses[scope->use_count].slot = slot;
+    scope->uses[scope->use_count].local = local;
+    scope->use_count++;
+    return DM_SUCCESS;
+}
+
+// Record a name read past the function scope at the given index
+static dm_error_t add_escape(dm_resolver_t *r, const char *name, size_t boundary) {
+    if (r->escape_count >= r->escape_capacity) {
+        size_t new_capacity = r->escape_capacity == 0 ? 16 : r->escape_capacity * 2;
+        dm_resolver_escape_t *new_escapes = dm_realloc(r->ctx, r->escapes, new_capacity * sizeof(dm_resolver_escape_t));
+        if (new_escapes == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        r->escapes = new_escapes;
+        r->escape_capacity = new_capacity;
+    }
+
+    r->escapes[r->escape_count].name = name;
+    r->escapes[r->escape_count].boundary = boundary;
+    r->escape_count++;
+    return DM_SUCCESS;
+}
+
+// Add a slot to the innermost scope
+static dm_error_t add_slot(dm_resolver_t *r, const char *name, size_t *slot) {
+    dm_resolver_scope_t *scope = &r->scopes[r->depth - 1];
+
+    if (scope->count >= scope->capacity) {
+        size_t new_capacity = scope->capacity == 0 ? 8 : scope->capacity * 2;
+        const char **new_names = dm_realloc(r->ctx, scope->names, new_capacity * sizeof(char*));
+        if (new_names == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        scope->names = new_names;
+        scope->capacity = new_capacity;
+    }
+
+    *slot = scope->count;
+    scope->names[scope->count++] = name;
+    return DM_SUCCESS;
+}
+
+// Find the slot of a name in a scope (latest declaration wins)
+static bool find_slot(const dm_resolver_scope_t *scope, const char *name, size_t *slot) {
+    for (size_t i = scope->count; i > 0; i--) {
+        if (scope->names[i - 1] == name) {
+            *slot = i - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Resolve a reference against the enclosing scopes of the current function.
+// Names the function does not declare are looked up by name at run time.
+static dm_error_t resolve_reference(dm_resolver_t *r, const char *name, dm_local_ref_t *local) {
+    local->resolved = false;
+
+    for (size_t i = r->depth; i > 0; i--) {
+        const dm_resolver_scope_t *scope = &r->scopes[i - 1];
+
+        size_t slot = 0;
+        if (find_slot(scope, name, &slot)) {
+            local->resolved = true;
+            local->depth = r->depth - i;
+            local->slot = slot;
+            return add_use(r, i - 1, slot, local);
+        }
+
+        if (scope->function_boundary) {
+            return add_escape(r, name, i - 1);
+        }
+    }
+
+    return DM_SUCCESS;
+}
+
+// Declare a `let` local in the innermost scope (globals stay name-based)
+static dm_error_t declare_local(dm_resolver_t *r, const char *name, dm_local_ref_t *local) {
+    local->resolved = false;
+    if (r->depth == 0) {
+        return DM_SUCCESS;
+    }
+
+    size_t slot = 0;
+    if (!find_slot(&r->scopes[r->depth - 1], name, &slot)) {
+        dm_error_t err = add_slot(r, name, &slot);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    local->resolved = true;
+    local->depth = 0;
+    local->slot = slot;
+    return add_use(r, r->depth - 1, slot, local);
+}
+
+static dm_error_t resolve_list(dm_resolver_t *r, dm_node_t **nodes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dm_error_t err = resolve_node(r, nodes[i]);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+    return DM_SUCCESS;
+}
+
+static dm_error_t resolve_function(dm_resolver_t *r, dm_node_t *node) {
+    // Parameters occupy slots 0..n-1 of the function scope
+    dm_error_t err = push_scope(r, true);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    for (size_t i = 0; i < node->function.param_count && err == DM_SUCCESS; i++) {
+        size_t slot = 0;
+        err = add_slot(r, node->function.params[i], &slot);
+    }
+
+    if (err == DM_SUCCESS) {
+        err = resolve_node(r, node->function.body);
+    }
+
+    bool named = false;
+    pop_scope(r, &named);
+    node->function.resolved = (err == DM_SUCCESS && !named);
+    return err;
+}
+
+static dm_error_t resolve_node(dm_resolver_t *r, dm_node_t *node) {
+    if (node == NULL) {
+        return DM_SUCCESS;
+    }
+
+    dm_error_t err = DM_SUCCESS;
+
+    switch (node->type) {
+        case DM_NODE_PROGRAM:
+            // Top-level statements run in the global scope
+            return resolve_list(r, node->program.statements, node->program.count);
+
+        case DM_NODE_LITERAL:
+        case DM_NODE_IMPORT:
+            return DM_SUCCESS;
+
+        case DM_NODE_BINARY_OP:
+            err = resolve_node(r, node->binary.left);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return resolve_node(r, node->binary.right);
+
+        case DM_NODE_UNARY_OP:
+            return resolve_node(r, node->unary.operand);
+
+        case DM_NODE_VARIABLE:
+            return resolve_reference(r, node->variable.name, &node->variable.local);
+
+        case DM_NODE_ASSIGNMENT:
+            // The value is resolved first so `let x = x + 1` reads the outer x
+            err = resolve_node(r, node->assignment.value);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            if (node->assignment.is_declaration) {
+                return declare_local(r, node->assignment.name, &node->assignment.local);
+            }
+            return resolve_reference(r, node->assignment.name, &node->assignment.local);
+
+        case DM_NODE_BLOCK:
+            err = push_scope(r, false);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            err = resolve_list(r, node->block.statements, node->block.count);
+            node->block.slot_count = pop_scope(r, NULL);
+            return err;
+
+        case DM_NODE_IF:
+            err = resolve_node(r, node->if_stmt.condition);
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->if_stmt.then_branch);
+            }
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->if_stmt.else_branch);
+            }
+            return err;
+
+        case DM_NODE_WHILE:
+            err = resolve_node(r, node->while_loop.condition);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return resolve_node(r, node->while_loop.body);
+
+        case DM_NODE_FOR:
+            // The loop has its own scope, so `let` in the initializer gets a slot
+            err = push_scope(r, false);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            err = resolve_node(r, node->for_loop.init);
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->for_loop.condition);
+            }
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->for_loop.increment);
+            }
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->for_loop.body);
+            }
+            node->for_loop.slot_count = pop_scope(r, NULL);
+            return err;
+
+        case DM_NODE_FOR_EACH:
+            // The iterable is read outside the loop scope holding the variable
+            err = resolve_node(r, node->for_each.iterable);
+            if (err == DM_SUCCESS) {
+                err = push_scope(r, false);
+            }
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            err = declare_local(r, node->for_each.name, &node->for_each.local);
+            if (err == DM_SUCCESS) {
+                err = resolve_node(r, node->for_each.body);
+            }
+            node->for_each.slot_count = pop_scope(r, NULL);
+            return err;
+
+        case DM_NODE_CALL:
+            err = resolve_reference(r, node->call.name, &node->call.local);
+            if (err != DM_SUCCESS) {
+                return err;
+            }
+            return resolve_list(r, node->call.args, node->call.arg_count);
+
+        case DM_NODE_FUNCTION:
+            // The function itself is still defined by name
+            return resolve_function(r, node);
+
+        case DM_NODE_RETURN:
+            return resolve_node(r, node->return_stmt.value);
+
+        case DM_NODE_YIELD:
+            return resolve_node(r, node->yield_stmt.value);
+
+        default:
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+// Resolve local variables of a parsed program
+dm_error_t dm_resolve(dm_context_t *ctx, dm_node_t *root) {
+    if (ctx == NULL || root == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_resolver_t resolver;
+    resolver.ctx = ctx;
+    resolver.scopes = NULL;
+    resolver.depth = 0;
+    resolver.capacity = 0;
+    resolver.escapes = NULL;
+    resolver.escape_count = 0;
+    resolver.escape_capacity = 0;
+
+    dm_error_t err = resolve_node(&resolver, root);
+
+    // Release any scopes left open by an error
+    while (resolver.depth > 0) {
+        pop_scope(&resolver, NULL);
+    }
+    dm_free(ctx, resolver.scopes);
+    dm_free(ctx, resolver.escapes);
+
+    return err;
+}
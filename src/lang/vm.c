@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/dmkernel.h"
+#include "../../include/lang/bytecode.h"
+#include "../../include/lang/exec.h"
+
+// Call frame
+typedef struct {
+    dm_bc_function_t *function;
+    size_t ip;
+    size_t stack_base;          // Stack height below the frame's temporaries
+    dm_scope_t *saved_scope;    // Scope to restore on return
+} dm_vm_frame_t;
+
+// Machine state for one dm_vm_execute call. Frames may run functions of
+// modules from earlier runs; each function knows its own module.
+typedef struct {
+    dm_context_t *ctx;
+    dm_value_t result;          // Left on the stack by the top-level function
+    dm_value_t *stack;
+    size_t stack_size;
+    size_t stack_capacity;
+    dm_vm_frame_t *frames;
+    size_t frame_count;
+    size_t frame_capacity;
+} dm_vm_t;
+
+// Marker stored in the func slot of bytecode function values. It keeps them
+// apart from AST functions (func == NULL) and is never meant to be called.
+static dm_error_t vm_function_marker(dm_context_t *ctx, int argc, dm_value_t *argv, dm_value_t *result) {
+    (void)argc;
+    (void)argv;
+    (void)result;
+    dm_context_set_error(ctx, "Bytecode functions can only be called from the VM");
+    return DM_ERROR_NOT_SUPPORTED;
+}
+
+// Values each opcode pops or, for DUP, reads (CALL and CONCAT check their
+// counts separately)
+static const uint8_t vm_stack_effect[DM_BC_OPCODE_COUNT] = {
+    [DM_BC_POP] = 1, [DM_BC_PRINT] = 1, [DM_BC_SET] = 1, [DM_BC_DEFINE] = 1, [DM_BC_SET_LOCAL] = 1,
+    [DM_BC_ADD] = 2, [DM_BC_SUB] = 2, [DM_BC_MUL] = 2, [DM_BC_DIV] = 2, [DM_BC_MOD] = 2,
+    [DM_BC_EQ] = 2, [DM_BC_NEQ] = 2, [DM_BC_LT] = 2, [DM_BC_GT] = 2, [DM_BC_LTE] = 2, [DM_BC_GTE] = 2,
+    [DM_BC_AND] = 2, [DM_BC_OR] = 2, [DM_BC_NEG] = 1, [DM_BC_NOT] = 1,
+    [DM_BC_JUMP_IF_FALSE] = 1, [DM_BC_RETURN] = 1, [DM_BC_DUP] = 1
+};
+
+static uint16_t read_u16(const uint8_t *code) {
+    return (uint16_t)(code[0] | (code[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *code) {
+    return (uint32_t)code[0] | ((uint32_t)code[1] << 8) |
+           ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+}
+
+// Push a value, taking ownership of it
+static dm_error_t vm_push(dm_vm_t *vm, dm_value_t value) {
+    if (vm->stack_size >= vm->stack_capacity) {
+        size_t new_capacity = vm->stack_capacity == 0 ? 64 : vm->stack_capacity * 2;
+        dm_value_t *new_stack = dm_realloc(vm->ctx, vm->stack, new_capacity * sizeof(dm_value_t));
+        if (new_stack == NULL) {
+            dm_value_free(vm->ctx, &value);
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        vm->stack = new_stack;
+        vm->stack_capacity = new_capacity;
+    }
+
+    vm->stack[vm->stack_size++] = value;
+    return DM_SUCCESS;
+}
+
+// Pop a value, transferring ownership to the caller
+static dm_value_t vm_pop(dm_vm_t *vm) {
+    return vm->stack[--vm->stack_size];
+}
+
+// Drop values until the stack has the given height
+static void vm_truncate(dm_vm_t *vm, size_t height) {
+    while (vm->stack_size > height) {
+        dm_value_free(vm->ctx, &vm->stack[--vm->stack_size]);
+    }
+}
+
+// Leave scopes until the given one is current again
+static void vm_unwind_scopes(dm_vm_t *vm, dm_scope_t *target) {
+    while (vm->ctx->current_scope != target && vm->ctx->current_scope != NULL) {
+        dm_scope_t *scope = vm->ctx->current_scope;
+        vm->ctx->current_scope = scope->parent;
+        dm_scope_release(vm->ctx, scope);
+    }
+}
+
+static dm_error_t vm_push_frame(dm_vm_t *vm, dm_bc_function_t *function, size_t stack_base, dm_scope_t *saved_scope) {
+    if (vm->frame_count >= vm->frame_capacity) {
+        size_t new_capacity = vm->frame_capacity == 0 ? 16 : vm->frame_capacity * 2;
+        dm_vm_frame_t *new_frames = dm_realloc(vm->ctx, vm->frames, new_capacity * sizeof(dm_vm_frame_t));
+        if (new_frames == NULL) {
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+        vm->frames = new_frames;
+        vm->frame_capacity = new_capacity;
+    }
+
+    dm_vm_frame_t *frame = &vm->frames[vm->frame_count++];
+    frame->function = function;
+    frame->ip = 0;
+    frame->stack_base = stack_base;
+    frame->saved_scope = saved_scope;
+    return DM_SUCCESS;
+}
+
+// Bytecode function a value refers to. The value keeps the function's
+// module alive, and a module's functions are all decoded for threaded
+// dispatch before its run can create any function value.
+static dm_bc_function_t* vm_resolve_function(const dm_value_t *value) {
+    if (value->type != DM_TYPE_FUNCTION || value->as.function.func != vm_function_marker) {
+        return NULL;
+    }
+
+    return value->as.function.user_data;
+}
+
+// Whether the call about to run in frame is in tail position. The frame
+// cannot be dropped early if its scopes hold named symbols, since the
+// callee would otherwise see them through the scope chain.
+static bool vm_is_tail_call(dm_vm_t *vm, const dm_vm_frame_t *frame) {
+    if (vm->frame_count < 2 || frame->ip >= frame->function->code_length ||
+        frame->function->code[frame->ip] != DM_BC_RETURN) {
+        return false;
+    }
+
+    for (dm_scope_t *scope = vm->ctx->current_scope; scope != frame->saved_scope; scope = scope->parent) {
+        if (scope == NULL || scope->symbols != NULL) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Perform a call: arguments are the top argc stack values. A callee taken
+// from a local (from_stack) sits directly below them; name is for messages.
+static dm_error_t vm_call(dm_vm_t *vm, const char *name, bool from_stack, uint8_t argc) {
+    dm_context_t *ctx = vm->ctx;
+
+    // Named callees are borrowed from their scope rather than copied
+    dm_value_t callee;
+    dm_value_init(&callee);
+    const dm_value_t *target = &callee;
+    if (from_stack) {
+        callee = vm->stack[vm->stack_size - argc - 1];
+        dm_value_init(&vm->stack[vm->stack_size - argc - 1]);
+    } else if (dm_scope_lookup_ref(ctx, ctx->current_scope, name, &target) != DM_SUCCESS) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message), "Function '%s' is not defined", name);
+        return DM_ERROR_UNDEFINED_VARIABLE;
+    }
+
+    dm_bc_function_t *function = vm_resolve_function(target);
+    dm_value_type_t callee_type = target->type;
+    dm_value_free(ctx, &callee);
+
+    if (function == NULL) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                callee_type == DM_TYPE_FUNCTION ? "Invalid function definition for '%s'"
+                                                : "'%s' is not a function", name);
+        return DM_ERROR_TYPE_MISMATCH;
+    }
+
+    if (argc != function->param_count) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                "Function '%s' expects %zu arguments, but got %u", name, function->param_count, argc);
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // A call directly followed by RETURN replaces the caller's frame
+    dm_vm_frame_t *caller = &vm->frames[vm->frame_count - 1];
+    bool tail = vm_is_tail_call(vm, caller);
+    if (!tail && vm->frame_count > ctx->max_call_depth) {
+        snprintf(ctx->error_message, sizeof(ctx->error_message),
+                "Maximum call depth of %zu exceeded in '%s'", ctx->max_call_depth, name);
+        return DM_ERROR_STACK_OVERFLOW;
+    }
+
+    // Move arguments into the parameter slots of a fresh scope, or define
+    // them by name where nested functions read them
+    bool named = function->named_params;
+    dm_scope_t *function_scope = dm_scope_acquire(ctx, tail ? caller->saved_scope : ctx->current_scope,
+                                                  named ? 0 : argc);
+    if (function_scope == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    size_t base = vm->stack_size - argc;
+    if (named) {
+        for (size_t i = 0; i < argc; i++) {
+            dm_error_t err = dm_scope_define(ctx, function_scope, function->module->names[function->params[i]],
+                                             vm->stack[base + i]);
+            if (err != DM_SUCCESS) {
+                dm_scope_release(ctx, function_scope);
+                return err;
+            }
+        }
+        vm_truncate(vm, base);
+    } else if (argc > 0) {
+        memcpy(function_scope->slots, &vm->stack[base], argc * sizeof(dm_value_t));
+    }
+    vm->stack_size = base;
+
+    // Drop the (already released) callee slot
+    if (from_stack) {
+        vm->stack_size--;
+        base--;
+    }
+
+    if (tail) {
+        // Leave the caller's scopes and temporaries, then restart the frame
+        vm_unwind_scopes(vm, caller->saved_scope);
+        vm_truncate(vm, caller->stack_base);
+        caller->function = function;
+        caller->ip = 0;
+        ctx->current_scope = function_scope;
+        return DM_SUCCESS;
+    }
+
+    dm_error_t err = vm_push_frame(vm, function, base, ctx->current_scope);
+    if (err != DM_SUCCESS) {
+        dm_scope_release(ctx, function_scope);
+        return err;
+    }
+
+    ctx->current_scope = function_scope;
+    return DM_SUCCESS;
+}
+
+// Threaded dispatch jumps straight to pre-decoded handler addresses using
+// the labels-as-values extension; other compilers use the switch below.
+#if defined(__GNUC__) && !defined(DM_VM_NO_THREADING)
+#define DM_VM_THREADED 1
+#endif
+
+#ifdef DM_VM_THREADED
+// Pre-decoded instruction, stored at the offset of each instruction start
+typedef struct {
+    const void *handler;
+    uint32_t next;          // Offset of the following instruction
+    uint32_t min_stack;     // Values the instruction pops (underflow guard)
+} dm_vm_insn_t;
+
+// Decode a function into its threaded form (once per function)
+static dm_error_t vm_thread_function(dm_context_t *ctx, dm_bc_function_t *function,
+                                     const void *const *labels, const void *invalid) {
+    if (function->threaded != NULL) {
+        return DM_SUCCESS;
+    }
+
+    dm_vm_insn_t *insns = dm_calloc(ctx, function->code_length > 0 ? function->code_length : 1,
+                                    sizeof(dm_vm_insn_t));
+    if (insns == NULL) {
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+
+    size_t pc = 0;
+    while (pc < function->code_length) {
+        uint8_t op = function->code[pc];
+        size_t size = dm_bc_instruction_size(op);
+        bool valid = op < DM_BC_OPCODE_COUNT && labels[op] != NULL;
+
+        insns[pc].handler = valid ? labels[op] : invalid;
+        insns[pc].next = (uint32_t)(pc + size);
+        insns[pc].min_stack = valid ? vm_stack_effect[op] : 0;
+        pc += size > 0 ? size : 1;
+    }
+
+    function->threaded = insns;
+    return DM_SUCCESS;
+}
+
+#define VM_OP(opcode) L_##opcode:
+#define VM_INVALID L_invalid:
+#define VM_NEXT() do { \
+        if (err != DM_SUCCESS) { \
+            return err; \
+        } \
+        frame = &vm->frames[vm->frame_count - 1]; \
+        insn = &((const dm_vm_insn_t*)frame->function->threaded)[frame->ip]; \
+        ip = frame->function->code + frame->ip; \
+        op = *ip; \
+        frame->ip = insn->next; \
+        if (vm->stack_size - frame->stack_base < insn->min_stack) { \
+            goto underflow; \
+        } \
+        goto *insn->handler; \
+    } while (0)
+#else
+#define VM_OP(opcode) case opcode:
+#define VM_INVALID default:
+#define VM_NEXT() goto next
+#endif
+
+// Main interpreter loop
+static dm_error_t vm_run(dm_vm_t *vm) {
+    dm_context_t *ctx = vm->ctx;
+    dm_bc_module_t *module = vm->frames[0].function->module;    // Of the running frame
+    dm_vm_frame_t *frame = NULL;
+    const uint8_t *ip = NULL;
+    uint8_t op = DM_BC_NOP;
+    dm_error_t err = DM_SUCCESS;
+
+#ifdef DM_VM_THREADED
+    static const void *const labels[DM_BC_OPCODE_COUNT] = {
+        [DM_BC_NOP] = &&L_DM_BC_NOP, [DM_BC_CONST] = &&L_DM_BC_CONST,
+        [DM_BC_NULL] = &&L_DM_BC_NULL, [DM_BC_TRUE] = &&L_DM_BC_TRUE, [DM_BC_FALSE] = &&L_DM_BC_FALSE,
+        [DM_BC_POP] = &&L_DM_BC_POP, [DM_BC_PRINT] = &&L_DM_BC_PRINT,
+        [DM_BC_GET] = &&L_DM_BC_GET, [DM_BC_SET] = &&L_DM_BC_SET, [DM_BC_DEFINE] = &&L_DM_BC_DEFINE,
+        [DM_BC_GET_LOCAL] = &&L_DM_BC_GET_LOCAL, [DM_BC_SET_LOCAL] = &&L_DM_BC_SET_LOCAL,
+        [DM_BC_CONCAT] = &&L_DM_BC_CONCAT, [DM_BC_CONCAT_LOCAL] = &&L_DM_BC_CONCAT_LOCAL,
+        [DM_BC_ADD] = &&L_DM_BC_ADD, [DM_BC_SUB] = &&L_DM_BC_SUB, [DM_BC_MUL] = &&L_DM_BC_MUL,
+        [DM_BC_DIV] = &&L_DM_BC_DIV, [DM_BC_MOD] = &&L_DM_BC_MOD,
+        [DM_BC_EQ] = &&L_DM_BC_EQ, [DM_BC_NEQ] = &&L_DM_BC_NEQ, [DM_BC_LT] = &&L_DM_BC_LT,
+        [DM_BC_GT] = &&L_DM_BC_GT, [DM_BC_LTE] = &&L_DM_BC_LTE, [DM_BC_GTE] = &&L_DM_BC_GTE,
+        [DM_BC_AND] = &&L_DM_BC_AND, [DM_BC_OR] = &&L_DM_BC_OR,
+        [DM_BC_NEG] = &&L_DM_BC_NEG, [DM_BC_NOT] = &&L_DM_BC_NOT,
+        [DM_BC_JUMP] = &&L_DM_BC_JUMP, [DM_BC_JUMP_IF_FALSE] = &&L_DM_BC_JUMP_IF_FALSE,
+        [DM_BC_ENTER_SCOPE] = &&L_DM_BC_ENTER_SCOPE, [DM_BC_LEAVE_SCOPE] = &&L_DM_BC_LEAVE_SCOPE,
+        [DM_BC_FUNCTION] = &&L_DM_BC_FUNCTION, [DM_BC_CALL] = &&L_DM_BC_CALL,
+        [DM_BC_CALL_VALUE] = &&L_DM_BC_CALL_VALUE, [DM_BC_RETURN] = &&L_DM_BC_RETURN,
+        [DM_BC_HALT] = &&L_DM_BC_HALT, [DM_BC_DUP] = &&L_DM_BC_DUP
+    };
+    const dm_vm_insn_t *insn = NULL;
+
+    for (size_t i = 0; i < module->function_count; i++) {
+        err = vm_thread_function(ctx, module->functions[i], labels, &&L_invalid);
+        if (err != DM_SUCCESS) {
+            return err;
+        }
+    }
+
+    VM_NEXT();
+    {
+#else
+next:
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    frame = &vm->frames[vm->frame_count - 1];
+    ip = frame->function->code + frame->ip;
+    op = *ip;
+    frame->ip += dm_bc_instruction_size(op);
+
+    // Loaded files are only verified statically, so guard against underflow here
+    if (op < DM_BC_OPCODE_COUNT && vm->stack_size - frame->stack_base < vm_stack_effect[op]) {
+        goto underflow;
+    }
+
+    switch (op) {
+#endif
+        VM_OP(DM_BC_NOP)
+            VM_NEXT();
+
+        VM_OP(DM_BC_CONST) {
+            dm_value_t value;
+            dm_value_init(&value);
+            dm_value_copy(ctx, &value, &module->constants[read_u16(ip + 1)]);
+            err = vm_push(vm, value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_NULL)
+        VM_OP(DM_BC_TRUE)
+        VM_OP(DM_BC_FALSE) {
+            dm_value_t value;
+            dm_value_init(&value);
+            if (op != DM_BC_NULL) {
+                value.type = DM_TYPE_BOOLEAN;
+                value.as.boolean = (op == DM_BC_TRUE);
+            }
+            err = vm_push(vm, value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_POP)
+            vm_truncate(vm, vm->stack_size - 1);
+            VM_NEXT();
+
+        VM_OP(DM_BC_DUP) {
+            dm_value_t value;
+            dm_value_init(&value);
+            dm_value_copy(ctx, &value, &vm->stack[vm->stack_size - 1]);
+            err = vm_push(vm, value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_PRINT) {
+            dm_value_t value = vm_pop(vm);
+            char *text = NULL;
+            if (dm_value_to_string(ctx, &value, &text) == DM_SUCCESS && text != NULL) {
+                fprintf(ctx->output, "=> %s\n", text);
+                dm_free(ctx, text);
+            }
+            dm_value_free(ctx, &value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_GET) {
+            const char *name = module->names[read_u16(ip + 1)];
+            dm_value_t value;
+            dm_value_init(&value);
+            if (dm_scope_lookup(ctx, ctx->current_scope, name, &value) != DM_SUCCESS) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), "Undefined variable '%s'", name);
+                err = DM_ERROR_UNDEFINED_VARIABLE;
+                VM_NEXT();
+            }
+            err = vm_push(vm, value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_SET) {
+            const char *name = module->names[read_u16(ip + 1)];
+            if (dm_scope_assign(ctx, ctx->current_scope, name, vm->stack[vm->stack_size - 1]) != DM_SUCCESS) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message),
+                        "Cannot assign to undefined variable '%s'", name);
+                err = DM_ERROR_UNDEFINED_VARIABLE;
+            }
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_DEFINE) {
+            const char *name = module->names[read_u16(ip + 1)];
+            err = dm_scope_define(ctx, ctx->current_scope, name, vm->stack[vm->stack_size - 1]);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_GET_LOCAL)
+        VM_OP(DM_BC_SET_LOCAL) {
+            dm_value_t *slot = dm_scope_slot(ctx->current_scope, read_u16(ip + 1), read_u16(ip + 3));
+            if (slot == NULL) {
+                snprintf(ctx->error_message, sizeof(ctx->error_message), "Invalid local slot");
+                err = DM_ERROR_INVALID_ARGUMENT;
+                VM_NEXT();
+            }
+
+            if (op == DM_BC_SET_LOCAL) {
+                dm_value_copy(ctx, slot, &vm->stack[vm->stack_size - 1]);
+                VM_NEXT();
+            }
+
+            dm_value_t value;
+            dm_value_init(&value);
+            dm_value_copy(ctx, &value, slot);
+            err = vm_push(vm, value);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_CONCAT)
+        VM_OP(DM_BC_CONCAT_LOCAL) {
+            // The variable's old value and the parts are on the stack; the
+            // result is left for the SET or SET_LOCAL that follows
+            bool local = (op == DM_BC_CONCAT_LOCAL);
+            size_t count = ip[local ? 5 : 3];
+            if (vm->stack_size - frame->stack_base < count + 1) {
+                err = DM_ERROR_INVALID_ARGUMENT;
+                VM_NEXT();
+            }
+
+            // Only a string can be appended to in place
+            size_t base = vm->stack_size - count - 1;
+            dm_value_t *target = NULL;
+            if (vm->stack[base].type != DM_TYPE_STRING && count == 1) {
+                // Plain `x = x + a`, exactly as ADD
+                dm_value_t right = vm_pop(vm);
+                dm_value_t left = vm_pop(vm);
+                dm_value_t result;
+                err = dm_value_binary_op(ctx, DM_OP_ADD, &left, &right, &result);
+                dm_value_free(ctx, &left);
+                dm_value_free(ctx, &right);
+                if (err == DM_SUCCESS) {
+                    err = vm_push(vm, result);
+                }
+                VM_NEXT();
+            } else if (vm->stack[base].type != DM_TYPE_STRING) {
+                // Plain addition
+            } else if (local) {
+                target = dm_scope_slot(ctx->current_scope, read_u16(ip + 1), read_u16(ip + 3));
+            } else {
+                target = dm_scope_lookup_mutable(ctx, ctx->current_scope,
+                                                 module->names[read_u16(ip + 1)]);
+            }
+            dm_value_t result;
+            err = dm_value_concat(ctx, target, &vm->stack[base], &vm->stack[base + 1], count, &result);
+            vm_truncate(vm, base);
+            if (err == DM_SUCCESS) {
+                err = vm_push(vm, result);
+            }
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_ADD)
+        VM_OP(DM_BC_SUB)
+        VM_OP(DM_BC_MUL)
+        VM_OP(DM_BC_DIV)
+        VM_OP(DM_BC_MOD)
+        VM_OP(DM_BC_EQ)
+        VM_OP(DM_BC_NEQ)
+        VM_OP(DM_BC_LT)
+        VM_OP(DM_BC_GT)
+        VM_OP(DM_BC_LTE)
+        VM_OP(DM_BC_GTE)
+        VM_OP(DM_BC_AND)
+        VM_OP(DM_BC_OR) {
+            // Opcodes mirror dm_operator_t order
+            dm_operator_t operator = (dm_operator_t)(DM_OP_ADD + (op - DM_BC_ADD));
+            dm_value_t right = vm_pop(vm);
+            dm_value_t left = vm_pop(vm);
+            dm_value_t result;
+            if (operator == DM_OP_ADD && left.type == DM_TYPE_STRING && right.type == DM_TYPE_STRING &&
+                dm_value_refcount(&left) == 1) {
+                // A temporary string on the left (as in `a + b + c`) is extended in place
+                err = dm_value_string_append(ctx, &left, right.as.string.data, right.as.string.length);
+                result = left;
+                dm_value_init(&left);
+            } else {
+                err = dm_value_binary_op(ctx, operator, &left, &right, &result);
+            }
+            dm_value_free(ctx, &left);
+            dm_value_free(ctx, &right);
+            if (err == DM_SUCCESS) {
+                err = vm_push(vm, result);
+            } else {
+                dm_value_free(ctx, &result);
+            }
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_NEG)
+        VM_OP(DM_BC_NOT) {
+            dm_value_t operand = vm_pop(vm);
+            dm_value_t result;
+            err = dm_value_unary_op(ctx, op == DM_BC_NEG ? DM_OP_NEG : DM_OP_NOT, &operand, &result);
+            dm_value_free(ctx, &operand);
+            if (err == DM_SUCCESS) {
+                err = vm_push(vm, result);
+            }
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_JUMP) {
+            // Backward jumps close loops; count them as steps
+            uint32_t target = read_u32(ip + 1);
+            if (target <= (uint32_t)(ip - frame->function->code)) {
+                err = DM_KERNEL_STEP(ctx);
+            }
+            frame->ip = target;
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_JUMP_IF_FALSE) {
+            dm_value_t condition = vm_pop(vm);
+            if (!dm_value_is_truthy(&condition)) {
+                frame->ip = read_u32(ip + 1);
+            }
+            dm_value_free(ctx, &condition);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_ENTER_SCOPE) {
+            dm_scope_t *scope = dm_scope_acquire(ctx, ctx->current_scope, read_u16(ip + 1));
+            if (scope == NULL) {
+                err = DM_ERROR_MEMORY_ALLOCATION;
+                VM_NEXT();
+            }
+            ctx->current_scope = scope;
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_LEAVE_SCOPE) {
+            dm_scope_t *scope = ctx->current_scope;
+            if (scope == frame->saved_scope || scope->parent == NULL) {
+                err = DM_ERROR_INVALID_ARGUMENT;
+                VM_NEXT();
+            }
+            ctx->current_scope = scope->parent;
+            dm_scope_release(ctx, scope);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_FUNCTION) {
+            dm_bc_function_t *function = module->functions[read_u16(ip + 1)];
+            const dm_value_t *name = &module->constants[function->name];
+
+            dm_value_t function_value;
+            dm_value_init(&function_value);
+            function_value.type = DM_TYPE_FUNCTION;
+            function_value.as.function.func = vm_function_marker;
+            function_value.as.function.user_data = function;
+            function_value.as.function.owner = module->owner;   // Referenced by the stored copy
+
+            err = dm_scope_define(ctx, ctx->current_scope, module->names[function->name], function_value);
+            if (err != DM_SUCCESS) {
+                VM_NEXT();
+            }
+
+            // A declaration evaluates to the function's name
+            dm_value_t result;
+            dm_value_init(&result);
+            dm_value_copy(ctx, &result, name);
+            err = vm_push(vm, result);
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_CALL)
+        VM_OP(DM_BC_CALL_VALUE) {
+            uint8_t argc = ip[3];
+            bool from_stack = (op == DM_BC_CALL_VALUE);
+            if (vm->stack_size - frame->stack_base < (size_t)argc + from_stack) {
+                err = DM_ERROR_INVALID_ARGUMENT;
+                VM_NEXT();
+            }
+            err = DM_KERNEL_STEP(ctx);
+            if (err == DM_SUCCESS) {
+                err = vm_call(vm, module->names[read_u16(ip + 1)], from_stack, argc);
+            }
+            if (err == DM_SUCCESS) {
+                module = vm->frames[vm->frame_count - 1].function->module;
+            }
+            VM_NEXT();
+        }
+
+        VM_OP(DM_BC_RETURN)
+        VM_OP(DM_BC_HALT) {
+            // Returning from the top-level script ends the run with the
+            // value on top of the stack
+            if (op == DM_BC_HALT || vm->frame_count == 1) {
+                if (vm->stack_size > frame->stack_base) {
+                    vm->result = vm_pop(vm);
+                }
+                vm_unwind_scopes(vm, frame->saved_scope);
+                return DM_SUCCESS;
+            }
+
+            dm_value_t result = vm_pop(vm);
+            vm_unwind_scopes(vm, frame->saved_scope);
+            vm_truncate(vm, frame->stack_base);
+            vm->frame_count--;
+            module = vm->frames[vm->frame_count - 1].function->module;
+            err = vm_push(vm, result);
+            VM_NEXT();
+        }
+
+        VM_INVALID
+            snprintf(ctx->error_message, sizeof(ctx->error_message), "Invalid opcode %u", op);
+            return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+underflow:
+    snprintf(ctx->error_message, sizeof(ctx->error_message), "Bytecode stack underflow");
+    return DM_ERROR_INVALID_ARGUMENT;
+}
+
+static void release_module(dm_context_t *ctx, void *data) {
+    dm_bc_module_free(ctx, data);
+}
+
+// Run the top-level function of a module, taking ownership of it
+dm_error_t dm_vm_execute(dm_context_t *ctx, dm_bc_module_t *module, dm_value_t *result) {
+    if (result != NULL) {
+        dm_value_init(result);
+    }
+    if (ctx == NULL || module == NULL || module->function_count == 0) {
+        dm_bc_module_free(ctx, module);
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Functions the run defines refer to the module and keep it alive
+    module->owner = dm_code_create(ctx, module, release_module);
+    if (module->owner == NULL) {
+        dm_bc_module_free(ctx, module);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    dm_object_t *owner = module->owner;
+
+    // Symbols are keyed by atom, so intern the name constants once up front.
+    // They live with the module, as its functions can be called by later runs.
+    module->names = dm_calloc(ctx, module->constant_count > 0 ? module->constant_count : 1, sizeof(const char*));
+    if (module->names == NULL) {
+        dm_object_release(ctx, owner);
+        return DM_ERROR_MEMORY_ALLOCATION;
+    }
+    for (size_t i = 0; i < module->constant_count; i++) {
+        const dm_value_t *constant = &module->constants[i];
+        if (constant->type != DM_TYPE_STRING) {
+            continue;
+        }
+        module->names[i] = dm_intern(ctx, constant->as.string.data, constant->as.string.length);
+        if (module->names[i] == NULL) {
+            dm_object_release(ctx, owner);
+            return DM_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    dm_vm_t vm;
+    memset(&vm, 0, sizeof(vm));
+    vm.ctx = ctx;
+    dm_value_init(&vm.result);
+
+    dm_scope_t *entry_scope = ctx->current_scope;
+    dm_error_t err = dm_kernel_begin_run(ctx);
+    if (err == DM_SUCCESS) {
+        err = vm_push_frame(&vm, module->functions[0], 0, entry_scope);
+        if (err == DM_SUCCESS) {
+            err = vm_run(&vm);
+        }
+        dm_kernel_end_run(ctx);
+    }
+
+    // Leave every scope opened by the run, even after an error
+    vm_unwind_scopes(&vm, entry_scope);
+    vm_truncate(&vm, 0);
+
+    dm_free(ctx, vm.stack);
+    dm_free(ctx, vm.frames);
+
+    if (err == DM_SUCCESS && result != NULL) {
+        *result = vm.result;
+    } else {
+        dm_value_free(ctx, &vm.result);
+    }
+
+    // The module goes now unless functions it defined are still referenced
+    dm_object_release(ctx, owner);
+    return err;
+}
+
+// Load and run a serialized module
+dm_error_t dm_execute_bytecode(dm_context_t *ctx, const uint8_t *data, size_t length) {
+    if (ctx == NULL || data == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+
+    dm_bc_module_t *module = NULL;
+    dm_error_t err = dm_bc_deserialize(ctx, data, length, &module);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+
+    return dm_vm_execute(ctx, module, NULL);
+}
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "../include/dmkernel.h"
 #include "../include/core/filesystem.h"
 #include "../include/core/memory.h"
+#include "../include/lang/bytecode.h"
 
 // Global context
 static dm_context_t *g_ctx = NULL;
@@ -96,19 +98,13 @@ dm_error_t dm_execute(dm_context_t *ctx, const char *code) {
     }
     
     // Execute source code using the parser and evaluator
-    dm_node_t *result = NULL;
-    dm_error_t err = dm_execute_source(ctx, code, strlen(code), &result);
+    dm_error_t err = dm_execute_source(ctx, code, strlen(code), NULL);
     
     if (err != DM_SUCCESS) {
         fprintf(ctx->error, "Execution error: %s\n", dm_error_string(err));
         return err;
     }
     
-    // Free the result if available
-    if (result != NULL) {
-        dm_node_free(ctx, result);
-    }
-    
     return DM_SUCCESS;
 }
 
@@ -163,8 +159,12 @@ dm_error_t dm_execute_file(dm_context_t *ctx, const char *filename) {
     // Close file
     dm_file_close(ctx, file);
     
-    // Execute code
-    err = dm_execute(ctx, code);
+    // Execute code (compiled .dmk files run on the VM)
+    if (dm_bc_is_bytecode(code, bytes_read)) {
+        err = dm_execute_bytecode(ctx, (const uint8_t*)code, bytes_read);
+    } else {
+        err = dm_execute(ctx, code);
+    }
     
     // Clean up
     DM_FREE(ctx, code);
@@ -187,6 +187,14 @@ const char* dm_error_string(dm_error_t error) {
             return "Syntax error";
         case DM_ERROR_TYPE_MISMATCH:
             return "Runtime error (type mismatch)";
+        case DM_ERROR_STACK_OVERFLOW:
+            return "Stack overflow (call depth or stack limit exceeded)";
+        case DM_ERROR_TIMEOUT:
+            return "Timeout (step or time limit exceeded)";
+        case DM_ERROR_INTERRUPTED:
+            return "Execution interrupted";
+        case DM_ERROR_BUSY:
+            return "Resource busy";
         default:
             return "Unknown error";
     }
@@ -194,8 +202,14 @@ const char* dm_error_string(dm_error_t error) {
 
 #ifndef DMKERNEL_AS_LIBRARY
 // Parse command line arguments
-static int parse_args(int argc, char **argv, char **script_file) {
+static int parse_args(int argc, char **argv, char **script_file, bool *threaded, size_t *max_depth,
+                      uint64_t *max_steps, unsigned *time_limit_ms, size_t *threads) {
     *script_file = NULL;
+    *threaded = false;
+    *max_depth = DM_DEFAULT_MAX_CALL_DEPTH;
+    *max_steps = 0;
+    *time_limit_ms = 0;
+    *threads = 0;
     
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
@@ -205,6 +219,12 @@ static int parse_args(int argc, char **argv, char **script_file) {
                 printf("Options:\n");
                 printf("  -h, --help    Show this help message\n");
                 printf("  -v, --version Show version information\n");
+                printf("  -t, --threaded Run scripts on the threaded bytecode VM\n");
+                printf("  -d, --max-depth N Limit nested function calls to N (default %d)\n",
+                       DM_DEFAULT_MAX_CALL_DEPTH);
+                printf("  --max-steps N Stop each run after N loop iterations and calls\n");
+                printf("  --time-limit MS Stop each run after MS milliseconds\n");
+                printf("  --threads N   Run parallel for loops on N threads (default: one per CPU)\n");
                 return 0;
             } else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-v") == 0) {
                 printf("DMKernel %d.%d.%d\n", 
@@ -212,6 +232,44 @@ static int parse_args(int argc, char **argv, char **script_file) {
                        DM_KERNEL_VERSION_MINOR, 
                        DM_KERNEL_VERSION_PATCH);
                 return 0;
+            } else if (strcmp(argv[i], "--threaded") == 0 || strcmp(argv[i], "-t") == 0) {
+                *threaded = true;
+            } else if (strcmp(argv[i], "--max-depth") == 0 || strcmp(argv[i], "-d") == 0) {
+                char *end = NULL;
+                unsigned long depth = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+                if (end == NULL || *end != '\0' || depth == 0) {
+                    fprintf(stderr, "Option %s expects a positive number\n", argv[i]);
+                    return 1;
+                }
+                *max_depth = depth;
+                i++;
+            } else if (strcmp(argv[i], "--max-steps") == 0) {
+                char *end = NULL;
+                unsigned long long steps = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+                if (end == NULL || *end != '\0' || steps == 0) {
+                    fprintf(stderr, "Option %s expects a positive number\n", argv[i]);
+                    return 1;
+                }
+                *max_steps = steps;
+                i++;
+            } else if (strcmp(argv[i], "--time-limit") == 0) {
+                char *end = NULL;
+                unsigned long limit = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+                if (end == NULL || *end != '\0' || limit == 0 || limit > UINT_MAX) {
+                    fprintf(stderr, "Option %s expects a positive number\n", argv[i]);
+                    return 1;
+                }
+                *time_limit_ms = (unsigned)limit;
+                i++;
+            } else if (strcmp(argv[i], "--threads") == 0) {
+                char *end = NULL;
+                unsigned long count = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+                if (end == NULL || *end != '\0' || count == 0) {
+                    fprintf(stderr, "Option %s expects a positive number\n", argv[i]);
+                    return 1;
+                }
+                *threads = count;
+                i++;
             } else {
                 fprintf(stderr, "Unknown option: %s\n", argv[i]);
                 return 1;
@@ -228,9 +286,15 @@ static int parse_args(int argc, char **argv, char **script_file) {
 int main(int argc, char **argv) {
     int exit_code = 0;
     char *script_file = NULL;
+    bool threaded = false;
+    size_t max_depth = DM_DEFAULT_MAX_CALL_DEPTH;
+    uint64_t max_steps = 0;
+    unsigned time_limit_ms = 0;
+    size_t threads = 0;
     
     // Parse command line arguments
-    int arg_result = parse_args(argc, argv, &script_file);
+    int arg_result = parse_args(argc, argv, &script_file, &threaded, &max_depth,
+                                &max_steps, &time_limit_ms, &threads);
     if (arg_result <= 1) {
         return arg_result; // 0 for help/version, 1 for error
     }
@@ -242,6 +306,12 @@ int main(int argc, char **argv) {
         return 1;
     }
     
+    g_ctx->threaded = threaded;
+    g_ctx->max_call_depth = max_depth;
+    g_ctx->max_steps = max_steps;
+    g_ctx->time_limit_ms = time_limit_ms;
+    g_ctx->max_threads = threads;
+    
     // Print banner
     print_banner(g_ctx->output);
     
@@ -253,7 +323,8 @@ int main(int argc, char **argv) {
             exit_code = 1;
         }
     } else {
-        // Interactive mode
+        // Interactive mode; Ctrl+C stops the command being run
+        dm_kernel_catch_interrupts(g_ctx);
         dm_shell_t *shell = NULL;
         error = dm_shell_create(g_ctx, &shell);
         if (error != DM_SUCCESS) {
@@ -5,6 +5,8 @@
 #include "../../include/shell/shell.h"
 #include "../../include/core/filesystem.h"
 #include "../../include/lang/exec.h"
+#include "../../include/lang/bytecode.h"
+#include "../../include/lang/profile.h"
 
 // Command: parse <file>
 // Parse a file and display the AST
@@ -163,49 +165,50 @@ dm_error_t dm_cmd_compile(dm_context_t *ctx, int argc, char **argv) {
         return err;
     }
     
-    // TODO: Generate bytecode from AST
-    // For now, we'll just create a simple "bytecode" file with a header
+    // Generate bytecode from AST
+    dm_bc_module_t *module = NULL;
+    err = dm_bc_compile(ctx, root, &module);
+    
+    // The AST and source are no longer needed
+    dm_node_free(ctx, root);
+    dm_free(ctx, source);
+    
+    if (err != DM_SUCCESS) {
+        fprintf(ctx->error, "Compile error: %s\n", ctx->error_message);
+        return err;
+    }
+    
+    uint8_t *bytecode = NULL;
+    size_t bytecode_length = 0;
+    err = dm_bc_serialize(ctx, module, &bytecode, &bytecode_length);
+    dm_bc_module_free(ctx, module);
+    if (err != DM_SUCCESS) {
+        fprintf(ctx->error, "Failed to serialize bytecode\n");
+        return err;
+    }
     
     // Open output file
     dm_file_t *output = NULL;
     err = dm_file_open(ctx, output_file, DM_FILE_WRITE | DM_FILE_CREATE | DM_FILE_TRUNCATE, &output);
     if (err != DM_SUCCESS) {
         fprintf(ctx->error, "Failed to open output file: %s\n", output_file);
-        dm_node_free(ctx, root);
-        dm_free(ctx, source);
+        dm_free(ctx, bytecode);
         return err;
     }
     
-    // Write a simple header
-    const char *header = "DMK\0"; // Magic number for our format
+    // Write the module
     size_t bytes_written = 0;
-    err = dm_file_write(ctx, output, header, 4, &bytes_written);
-    if (err != DM_SUCCESS || bytes_written != 4) {
-        fprintf(ctx->error, "Failed to write to output file\n");
-        dm_file_close(ctx, output);
-        dm_node_free(ctx, root);
-        dm_free(ctx, source);
-        return DM_ERROR_FILE_IO;
-    }
-    
-    // Add a version number
-    uint16_t version = 1;
-    err = dm_file_write(ctx, output, &version, sizeof(version), &bytes_written);
-    if (err != DM_SUCCESS || bytes_written != sizeof(version)) {
+    err = dm_file_write(ctx, output, bytecode, bytecode_length, &bytes_written);
+    dm_free(ctx, bytecode);
+    if (err != DM_SUCCESS || bytes_written != bytecode_length) {
         fprintf(ctx->error, "Failed to write to output file\n");
         dm_file_close(ctx, output);
-        dm_node_free(ctx, root);
-        dm_free(ctx, source);
         return DM_ERROR_FILE_IO;
     }
     
     // Close output file
     dm_file_close(ctx, output);
     
-    // Free AST and source
-    dm_node_free(ctx, root);
-    dm_free(ctx, source);
-    
     fprintf(ctx->output, "Successfully compiled %s to %s\n", source_file, output_file);
     
     return DM_SUCCESS;
@@ -323,9 +326,13 @@ dm_error_t dm_cmd_run(dm_context_t *ctx, int argc, char **argv) {
     // Close the file
     dm_file_close(ctx, file);
     
-    // Execute the script
-    dm_node_t *result = NULL;
-    dm_error_t exec_err = dm_execute_source(ctx, content, bytes_read, &result);
+    // Execute the script (compiled .dmk files run on the VM)
+    dm_error_t exec_err;
+    if (dm_bc_is_bytecode(content, bytes_read)) {
+        exec_err = dm_execute_bytecode(ctx, (const uint8_t*)content, bytes_read);
+    } else {
+        exec_err = dm_execute_source(ctx, content, bytes_read, NULL);
+    }
     if (exec_err != DM_SUCCESS) {
         fprintf(ctx->output, "Error executing script: %s\n", dm_error_string(exec_err));
         dm_free(ctx, abs_path);
@@ -333,11 +340,6 @@ dm_error_t dm_cmd_run(dm_context_t *ctx, int argc, char **argv) {
         return exec_err;
     }
     
-    // Free the result if available
-    if (result != NULL) {
-        dm_node_free(ctx, result);
-    }
-    
     // Clean up
     dm_free(ctx, abs_path);
     dm_free(ctx, content);
@@ -345,6 +347,95 @@ dm_error_t dm_cmd_run(dm_context_t *ctx, int argc, char **argv) {
     return DM_SUCCESS;
 }
 
+// Command: memo [reset]
+// Show (or clear) the result cache counters of memo functions
+dm_error_t dm_cmd_memo(dm_context_t *ctx, int argc, char **argv) {
+    if (ctx == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (argc >= 2) {
+        if (strcmp(argv[1], "reset") != 0) {
+            fprintf(ctx->error, "Usage: memo [reset]\n");
+            return DM_ERROR_INVALID_ARGUMENT;
+        }
+        
+        ctx->memo_hits = 0;
+        ctx->memo_misses = 0;
+        return DM_SUCCESS;
+    }
+    
+    size_t calls = ctx->memo_hits + ctx->memo_misses;
+    fprintf(ctx->output, "Memo cache hits:   %zu\n", ctx->memo_hits);
+    fprintf(ctx->output, "Memo cache misses: %zu\n", ctx->memo_misses);
+    fprintf(ctx->output, "Hit rate:          %.1f%%\n",
+            calls > 0 ? 100.0 * (double)ctx->memo_hits / (double)calls : 0.0);
+    
+    return DM_SUCCESS;
+}
+
+// Command: profile <file> [--collapsed <output>]
+// Run a script with the evaluator profiler and print where the time went
+dm_error_t dm_cmd_profile(dm_context_t *ctx, int argc, char **argv) {
+    if (ctx == NULL) {
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    const char *filename = NULL;
+    const char *collapsed_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--collapsed") == 0 && i + 1 < argc) {
+            collapsed_file = argv[++i];
+        } else if (filename == NULL) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+    
+    if (filename == NULL) {
+        fprintf(ctx->error, "Usage: profile <file> [--collapsed <output>]\n");
+        return DM_ERROR_INVALID_ARGUMENT;
+    }
+    
+    dm_error_t err = dm_profile_start(ctx);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    // Profiles come from the tree-walking evaluator, so bypass the VM
+    bool threaded = ctx->threaded;
+    ctx->threaded = false;
+    dm_error_t run_err = dm_execute_file(ctx, filename);
+    ctx->threaded = threaded;
+    
+    if (run_err != DM_SUCCESS) {
+        fprintf(ctx->error, "Error executing file: %s (profile covers the partial run)\n",
+                dm_error_string(run_err));
+    }
+    
+    // Report what ran, even when the script failed part way
+    err = dm_profile_report(ctx, ctx->output, DM_PROFILE_REPORT_ROWS);
+    
+    if (err == DM_SUCCESS && collapsed_file != NULL) {
+        dm_file_t *output = NULL;
+        err = dm_file_open(ctx, collapsed_file, DM_FILE_WRITE | DM_FILE_CREATE | DM_FILE_TRUNCATE, &output);
+        if (err != DM_SUCCESS) {
+            fprintf(ctx->error, "Failed to open output file: %s\n", collapsed_file);
+        } else {
+            err = dm_profile_write_collapsed(ctx, output->handle);
+            dm_file_close(ctx, output);
+            if (err == DM_SUCCESS) {
+                fprintf(ctx->output, "\nCollapsed stacks written to %s\n", collapsed_file);
+            }
+        }
+    }
+    
+    dm_profile_stop(ctx);
+    return run_err != DM_SUCCESS ? run_err : err;
+}
+
 // Register language commands with the shell
 dm_error_t dm_register_lang_commands(dm_shell_t *shell) {
     if (shell == NULL) {
@@ -369,5 +460,16 @@ dm_error_t dm_register_lang_commands(dm_shell_t *shell) {
         return err;
     }
     
+    err = dm_shell_register_command(shell, "memo", "Show memo function cache hits and misses", dm_cmd_memo);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
+    err = dm_shell_register_command(shell, "profile", "Run a script file and report time per function, line and node",
+                                    dm_cmd_profile);
+    if (err != DM_SUCCESS) {
+        return err;
+    }
+    
     return DM_SUCCESS;
 } 
\ No newline at end of file
@@ -283,7 +283,11 @@ dm_error_t dm_cmd_help(dm_context_t *ctx, int argc, char **argv) {
     fprintf(ctx->output, "  exit                 - Exit the shell\n");
     fprintf(ctx->output, "  version              - Display kernel version\n");
     fprintf(ctx->output, "  run <filename>       - Run a script file\n");
+    fprintf(ctx->output, "  compile <src> <out>  - Compile a script to bytecode\n");
     fprintf(ctx->output, "  exec <code>          - Execute a code snippet\n");
+    fprintf(ctx->output, "  memo [reset]         - Show or clear memo function cache hits and misses\n");
+    fprintf(ctx->output, "  profile <file> [--collapsed <output>]\n");
+    fprintf(ctx->output, "                       - Run a script and report time per function, line and node\n");
     
     return DM_SUCCESS;
 }
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/dmkernel.h"
+
+static int failures = 0;
+
+// Run source and check that it evaluates to the expected integer
+static void expect_integer(dm_context_t *ctx, const char *source, int64_t expected) {
+    dm_value_t result;
+    dm_error_t error = dm_execute_source(ctx, source, strlen(source), &result);
+    if (error != DM_SUCCESS) {
+        printf("FAIL: %s -> %s (%s)\n", source, dm_error_string(error), ctx->error_message);
+        failures++;
+        return;
+    }
+
+    if (result.type != DM_TYPE_INTEGER || result.as.integer != expected) {
+        printf("FAIL: %s -> expected %lld\n", source, (long long)expected);
+        failures++;
+    } else {
+        printf("ok: %s\n", source);
+    }
+    dm_value_free(ctx, &result);
+}
+
+// Run source that only defines things
+static void run(dm_context_t *ctx, const char *source) {
+    dm_error_t error = dm_execute_source(ctx, source, strlen(source), NULL);
+    if (error != DM_SUCCESS) {
+        printf("FAIL: %s -> %s (%s)\n", source, dm_error_string(error), ctx->error_message);
+        failures++;
+    }
+}
+
+// Functions must stay callable after the run that declared them
+static void test_define_then_call(dm_context_t *ctx) {
+    run(ctx, "function f(x) { return x + 1; }");
+    expect_integer(ctx, "f(2);", 3);
+
+    // Unrelated runs in between reuse the memory of freed programs
+    expect_integer(ctx, "let a = 40; a + 2;", 42);
+    expect_integer(ctx, "f(41);", 42);
+
+    // Call-site caches of kept functions must stay valid too
+    run(ctx, "function g(n) { return f(n) * 2; }");
+    expect_integer(ctx, "g(1) + g(2);", 10);
+}
+
+// Functions see the variables of the scope they are called from by name,
+// including locals of the enclosing block or function
+static void test_nested_functions(dm_context_t *ctx) {
+    expect_integer(ctx, "{ let y = 5; function f() { return y; } f(); }", 5);
+    expect_integer(ctx, "{ function g() { return z + 1; } let z = 9; g(); }", 10);
+    expect_integer(ctx, "{ let a = 1; let b = 2; function h() { return b; } a + h(); }", 3);
+    run(ctx, "function outer(p) { function inner() { return p * 2; } return inner(); }");
+    expect_integer(ctx, "outer(21);", 42);
+}
+
+int main(void) {
+    dm_context_t *ctx = NULL;
+
+    // Initialize kernel
+    dm_error_t error = dm_init(&ctx);
+    if (error != DM_SUCCESS) {
+        fprintf(stderr, "Failed to initialize kernel: %s\n", dm_error_string(error));
+        return 1;
+    }
+
+    printf("Testing functions across runs...\n");
+    test_define_then_call(ctx);
+    test_nested_functions(ctx);
+
+    // The same in threaded mode, where each run compiles its own module
+    ctx->threaded = true;
+    printf("Testing functions across runs in threaded mode...\n");
+    test_define_then_call(ctx);
+    test_nested_functions(ctx);
+
+    // Clean up
+    dm_cleanup(ctx);
+
+    printf("\n%s\n", failures == 0 ? "All tests passed." : "Some tests failed.");
+    return failures == 0 ? 0 : 1;
+}
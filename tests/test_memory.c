@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../include/dmkernel.h"
+
+#define ITEM_SIZE 32            // The first word holds the free-list link
+#define MANY_ITEMS 500          // Several blocks for 32-byte items
+#define THREADS 4
+#define ROUNDS 2000
+#define HELD 16                 // Items each thread holds at once
+
+static int failures = 0;
+
+static void check(int condition, const char *what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    } else {
+        printf("ok: %s\n", what);
+    }
+}
+
+// Stamp stored after the link word, to spot items handed out twice
+static uint64_t *stamp_of(void *item) {
+    return (uint64_t*)((char*)item + 8);
+}
+
+// Freed items come back first, most recently freed first
+static void test_free_list_reuse(dm_context_t *ctx, int concurrent) {
+    dm_memory_pool_t *pool = concurrent ? dm_pool_create_concurrent(ctx, ITEM_SIZE)
+                                        : dm_pool_create(ctx, ITEM_SIZE);
+    if (pool == NULL) {
+        check(0, "create pool");
+        return;
+    }
+
+    void *a = dm_pool_alloc(pool);
+    void *b = dm_pool_alloc(pool);
+    check(a != NULL && b != NULL && a != b, "distinct items");
+
+    dm_pool_free(pool, a);
+    check(dm_pool_alloc(pool) == a, "freed item is reused");
+
+    dm_pool_free(pool, b);
+    dm_pool_free(pool, a);
+    void *first = dm_pool_alloc(pool);
+    void *second = dm_pool_alloc(pool);
+    check(first == a && second == b, "free list is last in, first out");
+    check(dm_pool_alloc(pool) != a, "fresh item once the free list is empty");
+
+    dm_pool_destroy(pool);
+}
+
+// A reset hands out the items of every block again, in the same order
+static void test_reset_blocks(dm_context_t *ctx) {
+    dm_memory_pool_t *pool = dm_pool_create(ctx, ITEM_SIZE);
+    void **items = malloc(MANY_ITEMS * sizeof(void*));
+    if (pool == NULL || items == NULL) {
+        check(0, "create pool");
+        dm_pool_destroy(pool);
+        free(items);
+        return;
+    }
+
+    int all = 1;
+    for (size_t i = 0; i < MANY_ITEMS; i++) {
+        items[i] = dm_pool_alloc(pool);
+        all = all && items[i] != NULL;
+    }
+    check(all, "allocate across several blocks");
+
+    // Free some first: the reset drops the free list along with the rest
+    for (size_t i = 0; i < MANY_ITEMS; i += 7) {
+        dm_pool_free(pool, items[i]);
+    }
+    dm_pool_reset(pool);
+
+    int same = 1;
+    for (size_t i = 0; i < MANY_ITEMS; i++) {
+        same = same && dm_pool_alloc(pool) == items[i];
+    }
+    check(same, "reset reuses every block");
+
+    dm_pool_destroy(pool);
+    free(items);
+}
+
+typedef struct {
+    dm_memory_pool_t *pool;
+    uint64_t id;
+    int bad;                    // Items lost or handed out twice
+} worker_t;
+
+static void *concurrent_worker(void *arg) {
+    worker_t *worker = arg;
+    void *held[HELD];
+
+    for (uint64_t round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < HELD; i++) {
+            held[i] = dm_pool_alloc(worker->pool);
+            if (held[i] == NULL) {
+                worker->bad++;
+                continue;
+            }
+            *stamp_of(held[i]) = worker->id << 48 | round << 8 | i;
+        }
+
+        // Another thread writing the same item would change its stamp
+        for (size_t i = 0; i < HELD; i++) {
+            if (held[i] == NULL) {
+                continue;
+            }
+            if (*stamp_of(held[i]) != (worker->id << 48 | round << 8 | i)) {
+                worker->bad++;
+            }
+            dm_pool_free(worker->pool, held[i]);
+        }
+    }
+
+    return NULL;
+}
+
+// Several threads allocating and freeing at once never share an item
+static void test_concurrent(dm_context_t *ctx) {
+    dm_memory_pool_t *pool = dm_pool_create_concurrent(ctx, ITEM_SIZE);
+    if (pool == NULL) {
+        check(0, "create concurrent pool");
+        return;
+    }
+
+    pthread_t threads[THREADS];
+    worker_t workers[THREADS];
+    for (size_t t = 0; t < THREADS; t++) {
+        workers[t].pool = pool;
+        workers[t].id = t + 1;
+        workers[t].bad = 0;
+        pthread_create(&threads[t], NULL, concurrent_worker, &workers[t]);
+    }
+
+    int bad = 0;
+    for (size_t t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        bad += workers[t].bad;
+    }
+    check(bad == 0, "concurrent alloc and free hand out each item once");
+
+    // Everything was freed; the free list must still be well formed
+    void *items[THREADS * HELD];
+    int distinct = 1;
+    for (size_t i = 0; i < THREADS * HELD; i++) {
+        items[i] = dm_pool_alloc(pool);
+        distinct = distinct && items[i] != NULL;
+        for (size_t j = 0; j < i && distinct; j++) {
+            distinct = items[j] != items[i];
+        }
+    }
+    check(distinct, "free list intact after the threads");
+
+    dm_pool_destroy(pool);
+}
+
+int main(void) {
+    dm_context_t *ctx = NULL;
+
+    // Initialize kernel
+    dm_error_t error = dm_init(&ctx);
+    if (error != DM_SUCCESS) {
+        fprintf(stderr, "Failed to initialize kernel: %s\n", dm_error_string(error));
+        return 1;
+    }
+
+    printf("Testing pool free list...\n");
+    test_free_list_reuse(ctx, 0);
+    printf("Testing concurrent pool free list...\n");
+    test_free_list_reuse(ctx, 1);
+    printf("Testing pool reset...\n");
+    test_reset_blocks(ctx);
+    printf("Testing concurrent pool from %d threads...\n", THREADS);
+    test_concurrent(ctx);
+
+    // Clean up
+    dm_cleanup(ctx);
+
+    printf("\n%s\n", failures == 0 ? "All tests passed." : "Some tests failed.");
+    return failures == 0 ? 0 : 1;
+}